@@ -0,0 +1,213 @@
+/*
+ * Filename:  async.c
+ *
+ * Description:  Contains the asynchronous load.
+ *
+ * Copyright (c) 2017 Erwann Miriel, erwann.miriel@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+#include "include/async.h"
+#include "include/utils.h"
+#include "include/logging.h"
+
+#define NOTIFY_READ     0
+#define NOTIFY_WRITE    1
+
+struct _properties_load {
+    char *filename;
+    properties_load_opts_t opts;
+    pthread_t thread;
+    int notify_fds[2];
+    int status;
+    properties_t *properties;
+    int nb_diagnostics;
+    lexer_diagnostic_t *diagnostics;
+};
+
+/**
+ * Opens the descriptors signaling the end of the load : one eventfd, or both ends of a pipe.
+ * @return 0 if succeeded, -1 otherwise
+ */
+static int notify_open(properties_load_t *load) {
+#ifdef __linux__
+  load->notify_fds[NOTIFY_READ] = eventfd(0, EFD_CLOEXEC);
+  load->notify_fds[NOTIFY_WRITE] = load->notify_fds[NOTIFY_READ];
+  return load->notify_fds[NOTIFY_READ] == -1 ? FUNC_FAILURE : FUNC_SUCCESS;
+#else
+  if(pipe(load->notify_fds) == -1) {
+    return FUNC_FAILURE;
+  }
+  fcntl(load->notify_fds[NOTIFY_READ], F_SETFD, FD_CLOEXEC);
+  fcntl(load->notify_fds[NOTIFY_WRITE], F_SETFD, FD_CLOEXEC);
+  return FUNC_SUCCESS;
+#endif
+}
+
+static void notify_signal(properties_load_t *load) {
+#ifdef __linux__
+  unsigned long long one = 1;
+  ssize_t written = write(load->notify_fds[NOTIFY_WRITE], &one, sizeof(one));
+#else
+  char one = 1;
+  ssize_t written = write(load->notify_fds[NOTIFY_WRITE], &one, sizeof(one));
+#endif
+  if(written == -1) {
+    log_error("properties_load_async : cannot signal the end of the load");
+  }
+}
+
+static void notify_close(properties_load_t *load) {
+  close(load->notify_fds[NOTIFY_READ]);
+  if(load->notify_fds[NOTIFY_WRITE] != load->notify_fds[NOTIFY_READ]) {
+    close(load->notify_fds[NOTIFY_WRITE]);
+  }
+}
+
+/**
+ * Keeps a copy of the diagnostics of the lexer, which are freed with it.
+ * @return 0 if succeeded, -1 otherwise
+ */
+static int copy_diagnostics(properties_load_t *load, lexer_t *lexer) {
+  lexer_diagnostic_t *diagnostics;
+  int i, nb_diagnostics;
+
+  nb_diagnostics = lexer_get_diagnostics(lexer, &diagnostics);
+  if(nb_diagnostics == 0) {
+    return FUNC_SUCCESS;
+  }
+  load->diagnostics = malloc(nb_diagnostics * sizeof(*diagnostics));
+  if(load->diagnostics == NULL) {
+    return FUNC_FAILURE;
+  }
+  memcpy(load->diagnostics, diagnostics, nb_diagnostics * sizeof(*diagnostics));
+  for(i = 0; i < nb_diagnostics; i++) {
+    load->diagnostics[i].filename = load->filename;
+  }
+  load->nb_diagnostics = nb_diagnostics;
+  return FUNC_SUCCESS;
+}
+
+static void *load_worker(void *arg) {
+  properties_load_t *load = arg;
+  lexer_t *lexer;
+
+  load->properties = properties_new_with_allocator(load->opts.allocator);
+  if(load->properties == NULL) {
+    goto signal;
+  }
+  lexer = lexer_new(load->filename, load->properties);
+  if(lexer == NULL) {
+    properties_free(load->properties);
+    load->properties = NULL;
+    goto signal;
+  }
+
+  lexer_set_recovery(lexer, load->opts.recover);
+  load->status = lexer_analyze(lexer);
+  if(copy_diagnostics(load, lexer) != FUNC_SUCCESS) {
+    load->status = FUNC_FAILURE;
+  }
+  lexer_free(lexer);
+
+signal:
+  notify_signal(load);
+  return NULL;
+}
+
+int properties_load_async(char *path, properties_load_opts_t *opts, properties_load_t **p_handle) {
+  properties_load_t *load;
+
+  load = malloc(sizeof(*load));
+  if(load == NULL) {
+    goto exit_error;
+  }
+  load->filename = malloc(strlen(path) + NULL_CHAR_OFFSET);
+  if(load->filename == NULL) {
+    goto free_load;
+  }
+  strcpy(load->filename, path);
+  if(opts != NULL) {
+    load->opts = *opts;
+  } else {
+    load->opts.recover = 0;
+    load->opts.allocator = NULL;
+  }
+  load->status = FUNC_FAILURE;
+  load->properties = NULL;
+  load->nb_diagnostics = 0;
+  load->diagnostics = NULL;
+
+  if(notify_open(load) != FUNC_SUCCESS) {
+    goto free_filename;
+  }
+  if(pthread_create(&(load->thread), NULL, load_worker, load) != 0) {
+    goto close_notify;
+  }
+
+  *p_handle = load;
+  return FUNC_SUCCESS;
+
+close_notify:
+  notify_close(load);
+free_filename:
+  free(load->filename);
+free_load:
+  free(load);
+exit_error:
+  log_error("properties_load_async : cannot start loading %s", path);
+  return FUNC_FAILURE;
+}
+
+int properties_load_async_fd(properties_load_t *handle) {
+  return handle->notify_fds[NOTIFY_READ];
+}
+
+int properties_load_async_finish(properties_load_t *handle, properties_load_result_t *result) {
+  int status;
+
+  pthread_join(handle->thread, NULL);
+  notify_close(handle);
+
+  result->properties = handle->properties;
+  result->nb_diagnostics = handle->nb_diagnostics;
+  result->diagnostics = handle->diagnostics;
+  result->filename = handle->filename;
+  status = handle->status;
+  free(handle);
+  return status;
+}
+
+void properties_load_result_free(properties_load_result_t *result) {
+  if(result->properties != NULL) {
+    properties_free(result->properties);
+  }
+  free(result->diagnostics);
+  free(result->filename);
+  result->properties = NULL;
+  result->diagnostics = NULL;
+  result->filename = NULL;
+  result->nb_diagnostics = 0;
+}
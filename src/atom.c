@@ -0,0 +1,72 @@
+/*
+ * Filename:  atom.c
+ *
+ * Description:  Contains the process-wide table of key atoms.
+ *
+ * Copyright (c) 2017 Erwann Miriel, erwann.miriel@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+
+#include "include/atom.h"
+#include "include/intern.h"
+#include "include/utils.h"
+#include "include/logging.h"
+
+/* allocated with the default allocator on first use, and kept for the life of the process */
+static _intern_table_t *atoms = NULL;
+static pthread_mutex_t atoms_lock = PTHREAD_MUTEX_INITIALIZER;
+
+char *properties_atom_acquire(char *key, int key_len) {
+  unsigned int hash = hash_bytes(key, key_len);
+  char *atom = NULL;
+
+  pthread_mutex_lock(&atoms_lock);
+  if(atoms == NULL) {
+    atoms = intern_new(NULL);
+  }
+  if(atoms != NULL) {
+    atom = intern_acquire(atoms, key, key_len, hash);
+  }
+  pthread_mutex_unlock(&atoms_lock);
+  if(atom == NULL) {
+    log_error("properties_atom_acquire");
+  }
+  return atom;
+}
+
+void properties_atom_release(char *atom) {
+  pthread_mutex_lock(&atoms_lock);
+  intern_release(atoms, atom);
+  pthread_mutex_unlock(&atoms_lock);
+}
+
+unsigned int properties_atom_hash(char *atom) {
+  return INTERN_ENTRY(atom)->hash;
+}
+
+int properties_atom_len(char *atom) {
+  return INTERN_ENTRY(atom)->len;
+}
+
+int properties_atom_count() {
+  int count;
+
+  pthread_mutex_lock(&atoms_lock);
+  count = atoms == NULL ? 0 : atoms->size;
+  pthread_mutex_unlock(&atoms_lock);
+  return count;
+}
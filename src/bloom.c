@@ -0,0 +1,131 @@
+/*
+ * Filename:  bloom.c
+ *
+ * Description:  Contains the bloom filter of the properties holders.
+ *
+ * Copyright (c) 2017 Erwann Miriel, erwann.miriel@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "include/bloom.h"
+#include "include/utils.h"
+#include "include/logging.h"
+
+#define BLOOM_BLOCK_WORDS   (CACHE_LINE / sizeof(unsigned long long))
+#define BLOOM_BLOCK_BITS    (8 * CACHE_LINE)
+#define BLOOM_MAX_HASHES    16
+
+/* false positive rate of one bit per key, the best rate being 0.6185 ^ (bits per key) */
+#define BLOOM_RATE_PER_BIT  0.6185
+
+/**
+ * Derives the second hash of a key, locating its bits inside its block.
+ */
+static unsigned int bloom_rehash(unsigned int hash) {
+  hash ^= hash >> 16;
+  hash *= 0x85EBCA6B;
+  hash ^= hash >> 13;
+  return hash;
+}
+
+_bloom_t *bloom_new(_memctx_t *mem, int capacity, double fp_rate) {
+  _bloom_t *bloom;
+  unsigned long long nb_bits;
+  unsigned int nb_blocks = 1;
+  double rate = BLOOM_RATE_PER_BIT;
+  int bits_per_key = 1;
+
+  if(capacity < 1) {
+    capacity = 1;
+  }
+  while(rate > fp_rate && bits_per_key < 64) {
+    rate *= BLOOM_RATE_PER_BIT;
+    bits_per_key++;
+  }
+  nb_bits = (unsigned long long) bits_per_key * capacity;
+  while((unsigned long long) nb_blocks * BLOOM_BLOCK_BITS < nb_bits) {
+    nb_blocks *= 2;
+  }
+
+  bloom = mem_malloc(mem, sizeof(*bloom));
+  if(bloom == NULL) {
+    goto exit_error;
+  }
+  bloom->blocks_mem = mem_malloc(mem, (nb_blocks + 1) * CACHE_LINE);
+  if(bloom->blocks_mem == NULL) {
+    mem_free(mem, bloom);
+    goto exit_error;
+  }
+  bloom->blocks = ALIGN_UP(bloom->blocks_mem, CACHE_LINE);
+  memset(bloom->blocks, 0, nb_blocks * CACHE_LINE);
+  bloom->block_mask = nb_blocks - 1;
+  /* ln(2) hashes per bit per key */
+  bloom->nb_hashes = (bits_per_key * 69 + 50) / 100;
+  if(bloom->nb_hashes < 1) {
+    bloom->nb_hashes = 1;
+  } else if(bloom->nb_hashes > BLOOM_MAX_HASHES) {
+    bloom->nb_hashes = BLOOM_MAX_HASHES;
+  }
+  bloom->capacity = capacity;
+  bloom->count = 0;
+  bloom->fp_rate = fp_rate;
+  return bloom;
+
+exit_error:
+  log_error("bloom_new");
+  return NULL;
+}
+
+void bloom_free(_memctx_t *mem, _bloom_t *bloom) {
+  mem_free(mem, bloom->blocks_mem);
+  mem_free(mem, bloom);
+}
+
+size_t bloom_memory(_bloom_t *bloom) {
+  /* one more line to align the blocks */
+  return sizeof(*bloom) + ((size_t) bloom->block_mask + 2) * CACHE_LINE;
+}
+
+void bloom_add(_bloom_t *bloom, unsigned int hash) {
+  unsigned long long *block = bloom->blocks + (hash & bloom->block_mask) * BLOOM_BLOCK_WORDS;
+  unsigned int bit = bloom_rehash(hash), step = (bit >> 16) | 1;
+  int i;
+
+  for(i = 0; i < bloom->nb_hashes; i++) {
+    block[(bit % BLOOM_BLOCK_BITS) / 64] |= 1ULL << (bit % 64);
+    bit += step;
+  }
+  bloom->count++;
+}
+
+int bloom_may_contain(_bloom_t *bloom, unsigned int hash) {
+  unsigned long long *block = bloom->blocks + (hash & bloom->block_mask) * BLOOM_BLOCK_WORDS;
+  unsigned int bit = bloom_rehash(hash), step = (bit >> 16) | 1;
+  int i;
+
+  for(i = 0; i < bloom->nb_hashes; i++) {
+    if(!(block[(bit % BLOOM_BLOCK_BITS) / 64] & (1ULL << (bit % 64)))) {
+      return 0;
+    }
+    bit += step;
+  }
+  return 1;
+}
+
+void bloom_prefetch(_bloom_t *bloom, unsigned int hash) {
+  PREFETCH(bloom->blocks + (hash & bloom->block_mask) * BLOOM_BLOCK_WORDS);
+}
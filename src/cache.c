@@ -0,0 +1,252 @@
+/*
+ * Filename:  cache.c
+ *
+ * Description:  Contains the process-wide cache of parsed files.
+ *
+ * Copyright (c) 2017 Erwann Miriel, erwann.miriel@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "include/cache.h"
+#include "include/lexer.h"
+#include "include/utils.h"
+#include "include/logging.h"
+
+/**
+ * Snapshot of a version of a file.
+ * refs counts the references of the users, plus one while the cache holds the snapshot (cached is then set).
+ * A snapshot no longer cached stays in the list until its last reference is released.
+ */
+typedef struct _cache_entry _cache_entry_t;
+
+struct _cache_entry {
+    char *filename;
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+    properties_t *properties;
+    int refs;
+    int cached;
+    _cache_entry_t *next;
+};
+
+/* allocated with the default allocator, guarded by cache_lock */
+static _cache_entry_t *entries = NULL;
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int same_file(_cache_entry_t *entry, dev_t dev, ino_t ino) {
+  return entry->dev == dev && entry->ino == ino;
+}
+
+static int same_version(_cache_entry_t *entry, struct stat *st) {
+  return same_file(entry, st->st_dev, st->st_ino) && entry->size == st->st_size && entry->mtime.tv_sec == st->st_mtim.tv_sec
+         && entry->mtime.tv_nsec == st->st_mtim.tv_nsec;
+}
+
+/**
+ * Finds the cached snapshot of a version of a file. The lock must be held.
+ * @return the entry if found, NULL otherwise
+ */
+static _cache_entry_t *cache_find(struct stat *st) {
+  _cache_entry_t *entry;
+
+  for(entry = entries; entry != NULL; entry = entry->next) {
+    if(entry->cached && same_version(entry, st)) {
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Drops a reference on an entry, unlinking and freeing it with the last one. The lock must be held.
+ */
+static void cache_unref(_cache_entry_t *entry) {
+  _cache_entry_t **p_entry = &entries;
+
+  if(--entry->refs > 0) {
+    return;
+  }
+  while(*p_entry != entry) {
+    p_entry = &((*p_entry)->next);
+  }
+  *p_entry = entry->next;
+  properties_free(entry->properties);
+  mem_free(NULL, entry->filename);
+  mem_free(NULL, entry);
+}
+
+/**
+ * Drops the references of the cache on the snapshots of other versions of a file,
+ * found by their identity or by their path. The lock must be held.
+ */
+static void cache_drop_versions(_cache_entry_t *entry) {
+  _cache_entry_t *other, *next;
+
+  for(other = entries; other != NULL; other = next) {
+    next = other->next;
+    if(other->cached
+       && (same_file(other, entry->dev, entry->ino) || strcmp(other->filename, entry->filename) == 0)) {
+      other->cached = 0;
+      cache_unref(other);
+    }
+  }
+}
+
+/**
+ * Parses a file into a compacted and frozen properties holder.
+ * @return the properties holder if succeeded, NULL otherwise
+ */
+static properties_t *cache_parse(char *filename) {
+  properties_t *properties;
+  lexer_t *lexer;
+  int status = FUNC_FAILURE;
+
+  properties = properties_new();
+  if(properties == NULL) {
+    return NULL;
+  }
+  lexer = lexer_new(filename, properties);
+  if(lexer != NULL) {
+    status = lexer_analyze(lexer);
+    lexer_free(lexer);
+  }
+  if(status == FUNC_SUCCESS) {
+    status = properties_compact(properties);
+  }
+  if(status == FUNC_SUCCESS) {
+    status = properties_freeze(properties);
+  }
+  if(status != FUNC_SUCCESS) {
+    properties_free(properties);
+    return NULL;
+  }
+  return properties;
+}
+
+properties_t *properties_cache_load(char *filename) {
+  struct stat before, after;
+  _cache_entry_t *entry, *other;
+  properties_t *properties;
+  int len, keep;
+
+  if(stat(filename, &before) != 0) {
+    log_error("properties_cache_load : %s", filename);
+    return NULL;
+  }
+  pthread_mutex_lock(&cache_lock);
+  entry = cache_find(&before);
+  if(entry != NULL) {
+    entry->refs++;
+  }
+  pthread_mutex_unlock(&cache_lock);
+  if(entry != NULL) {
+    return entry->properties;
+  }
+
+  /* parsed out of the lock, so that the loads of other files go on */
+  properties = cache_parse(filename);
+  if(properties == NULL) {
+    return NULL;
+  }
+  len = (int) strlen(filename);
+  entry = mem_malloc(NULL, sizeof(*entry));
+  if(entry == NULL || (entry->filename = mem_malloc(NULL, len + NULL_CHAR_OFFSET)) == NULL) {
+    mem_free(NULL, entry);
+    properties_free(properties);
+    log_error("properties_cache_load");
+    return NULL;
+  }
+  memcpy(entry->filename, filename, len + NULL_CHAR_OFFSET);
+  entry->dev = before.st_dev;
+  entry->ino = before.st_ino;
+  entry->size = before.st_size;
+  entry->mtime = before.st_mtim;
+  entry->properties = properties;
+  entry->refs = 1;
+  entry->cached = 0;
+
+  /* a file modified while being parsed is not cached */
+  keep = stat(filename, &after) == 0 && same_version(entry, &after);
+  pthread_mutex_lock(&cache_lock);
+  other = keep ? cache_find(&before) : NULL;
+  if(other != NULL) {
+    /* parsed meanwhile by another thread */
+    other->refs++;
+    pthread_mutex_unlock(&cache_lock);
+    properties_free(properties);
+    mem_free(NULL, entry->filename);
+    mem_free(NULL, entry);
+    return other->properties;
+  }
+  if(keep) {
+    cache_drop_versions(entry);
+    entry->cached = 1;
+    entry->refs++;
+  }
+  entry->next = entries;
+  entries = entry;
+  pthread_mutex_unlock(&cache_lock);
+  return properties;
+}
+
+void properties_cache_release(properties_t *properties) {
+  _cache_entry_t *entry;
+
+  pthread_mutex_lock(&cache_lock);
+  for(entry = entries; entry != NULL && entry->properties != properties; entry = entry->next) {
+  }
+  if(entry != NULL) {
+    cache_unref(entry);
+  }
+  pthread_mutex_unlock(&cache_lock);
+  if(entry == NULL) {
+    log_error("properties_cache_release : unknown snapshot");
+  }
+}
+
+void properties_cache_clear() {
+  _cache_entry_t *entry, *next;
+
+  pthread_mutex_lock(&cache_lock);
+  for(entry = entries; entry != NULL; entry = next) {
+    next = entry->next;
+    if(entry->cached) {
+      entry->cached = 0;
+      cache_unref(entry);
+    }
+  }
+  pthread_mutex_unlock(&cache_lock);
+}
+
+int properties_cache_count() {
+  _cache_entry_t *entry;
+  int count = 0;
+
+  pthread_mutex_lock(&cache_lock);
+  for(entry = entries; entry != NULL; entry = entry->next) {
+    count += entry->cached;
+  }
+  pthread_mutex_unlock(&cache_lock);
+  return count;
+}
@@ -0,0 +1,325 @@
+/*
+ * Filename:  diff.c
+ *
+ * Description:  Contains the comparison of properties holders and the change subscriptions.
+ *
+ * Copyright (c) 2017 Erwann Miriel, erwann.miriel@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "include/diff.h"
+#include "include/utils.h"
+#include "include/logging.h"
+
+/* keys of the new version whose index entry in the old one is prefetched ahead */
+#define DIFF_AHEAD          8
+
+#define WORD_BITS           64
+
+#define SUBSCRIPTIONS_MIN   8
+
+typedef struct _subscription _subscription_t;
+
+struct _subscription {
+    char *pattern;
+    int len;
+    unsigned int hash;
+    int prefix;
+    int active;
+    properties_change_handler_t *handler;
+    void *ctx;
+};
+
+/**
+ * Subscriptions, by id, and an open addressing table of id + 1 (0 when empty) on the hashes of their patterns.
+ * A key matches the prefixes of each length in prefix_lens, found by hashing the first bytes of the key.
+ */
+struct _properties_subscriptions {
+    int size;
+    int capacity;
+    _subscription_t *subscriptions;
+    int *table;
+    unsigned int table_mask;
+    int *prefix_lens;
+    int nb_prefix_lens;
+};
+
+/**
+ * Compares the values of two slots : as strings if both are strings, by pointer otherwise.
+ * @return 1 if they differ, 0 otherwise
+ */
+static int values_differ(properties_t *old_props, int old_slot, properties_t *new_props, int new_slot) {
+  void *old_value = old_props->values[old_slot], *new_value = new_props->values[new_slot];
+
+  if(old_value == new_value) {
+    return 0;
+  }
+  if(old_value == NULL || new_value == NULL || !properties_property_is_string(old_props->contents[old_slot])
+     || !properties_property_is_string(new_props->contents[new_slot])) {
+    return 1;
+  }
+  return strcmp(old_value, new_value) != 0;
+}
+
+/**
+ * Calls a handler, if any.
+ * @return 0 if succeeded or no handler, -1 if the handler stops the comparison
+ */
+static int report(properties_change_handler_t *handler, char *key, void *old_value, void *new_value, void *ctx) {
+  if(handler != NULL && handler(key, old_value, new_value, ctx) == FUNC_FAILURE) {
+    return FUNC_FAILURE;
+  }
+  return FUNC_SUCCESS;
+}
+
+int properties_diff(properties_t *old_props, properties_t *new_props, properties_change_handler_t *on_added,
+                    properties_change_handler_t *on_removed, properties_change_handler_t *on_changed, void *ctx) {
+  unsigned long long *matched;
+  int i, slot, nb_changes = 0;
+
+  /* one bit per old slot, set when a new key joins it */
+  matched = mem_malloc(NULL, ((old_props->size + WORD_BITS - 1) / WORD_BITS + 1) * sizeof(*matched));
+  if(matched == NULL) {
+    log_error("properties_diff");
+    return FUNC_FAILURE;
+  }
+  memset(matched, 0, ((old_props->size + WORD_BITS - 1) / WORD_BITS + 1) * sizeof(*matched));
+
+  for(i = 0; i < new_props->size; i++) {
+    if(old_props->index != NULL && i + DIFF_AHEAD < new_props->size) {
+      PREFETCH(&(old_props->index[new_props->hashes[i + DIFF_AHEAD] & old_props->index_mask]));
+    }
+    /* a later duplicate is never looked up : only the first occurrence of a key counts */
+    if(properties_find_slot(new_props->keys[i], new_props->key_lens[i], new_props->hashes[i], new_props) != i) {
+      continue;
+    }
+    slot = properties_find_slot(new_props->keys[i], new_props->key_lens[i], new_props->hashes[i], old_props);
+    if(slot == -1) {
+      nb_changes++;
+      if(report(on_added, new_props->keys[i], NULL, new_props->values[i], ctx) != FUNC_SUCCESS) {
+        goto stopped;
+      }
+      continue;
+    }
+    matched[slot / WORD_BITS] |= 1ULL << (slot % WORD_BITS);
+    if(values_differ(old_props, slot, new_props, i)) {
+      nb_changes++;
+      if(report(on_changed, new_props->keys[i], old_props->values[slot], new_props->values[i], ctx) != FUNC_SUCCESS) {
+        goto stopped;
+      }
+    }
+  }
+
+  for(i = 0; i < old_props->size; i++) {
+    if(!(matched[i / WORD_BITS] & 1ULL << (i % WORD_BITS))
+       && properties_find_slot(old_props->keys[i], old_props->key_lens[i], old_props->hashes[i], old_props) == i) {
+      nb_changes++;
+      if(report(on_removed, old_props->keys[i], old_props->values[i], NULL, ctx) != FUNC_SUCCESS) {
+        goto stopped;
+      }
+    }
+  }
+
+  mem_free(NULL, matched);
+  return nb_changes;
+
+stopped:
+  mem_free(NULL, matched);
+  return FUNC_FAILURE;
+}
+
+properties_subscriptions_t *properties_subscriptions_new() {
+  properties_subscriptions_t *subs;
+
+  subs = mem_malloc(NULL, sizeof(*subs));
+  if(subs == NULL) {
+    log_error("properties_subscriptions_new");
+    return NULL;
+  }
+  memset(subs, 0, sizeof(*subs));
+  return subs;
+}
+
+static void table_insert(properties_subscriptions_t *subs, int id) {
+  unsigned int pos = subs->subscriptions[id].hash & subs->table_mask;
+
+  while(subs->table[pos] != 0) {
+    pos = (pos + 1) & subs->table_mask;
+  }
+  subs->table[pos] = id + 1;
+}
+
+/**
+ * Makes room for one more subscription, growing the arrays and rebuilding the table if needed.
+ * @return 0 if succeeded, -1 otherwise
+ */
+static int subscriptions_grow(properties_subscriptions_t *subs) {
+  _subscription_t *subscriptions;
+  int capacity, *table, id;
+
+  if(subs->size < subs->capacity) {
+    return FUNC_SUCCESS;
+  }
+  capacity = subs->capacity == 0 ? SUBSCRIPTIONS_MIN : 2 * subs->capacity;
+  subscriptions = mem_realloc(NULL, subs->subscriptions, capacity * sizeof(*subscriptions));
+  if(subscriptions == NULL) {
+    return FUNC_FAILURE;
+  }
+  subs->subscriptions = subscriptions;
+  /* the table keeps at least half of its entries empty */
+  table = mem_malloc(NULL, 2 * capacity * sizeof(*table));
+  if(table == NULL) {
+    return FUNC_FAILURE;
+  }
+  memset(table, 0, 2 * capacity * sizeof(*table));
+  mem_free(NULL, subs->table);
+  subs->table = table;
+  subs->table_mask = 2 * capacity - 1;
+  subs->capacity = capacity;
+  for(id = 0; id < subs->size; id++) {
+    table_insert(subs, id);
+  }
+  return FUNC_SUCCESS;
+}
+
+/**
+ * Adds the length of a prefix to the lengths to match, if new.
+ * @return 0 if succeeded, -1 otherwise
+ */
+static int prefix_len_add(properties_subscriptions_t *subs, int len) {
+  int i, *prefix_lens;
+
+  for(i = 0; i < subs->nb_prefix_lens; i++) {
+    if(subs->prefix_lens[i] == len) {
+      return FUNC_SUCCESS;
+    }
+  }
+  prefix_lens = mem_realloc(NULL, subs->prefix_lens, (subs->nb_prefix_lens + 1) * sizeof(*prefix_lens));
+  if(prefix_lens == NULL) {
+    return FUNC_FAILURE;
+  }
+  prefix_lens[subs->nb_prefix_lens] = len;
+  subs->prefix_lens = prefix_lens;
+  subs->nb_prefix_lens++;
+  return FUNC_SUCCESS;
+}
+
+static int subscribe(char *pattern, int prefix, properties_change_handler_t *handler, void *ctx,
+                     properties_subscriptions_t *subs) {
+  _subscription_t *sub;
+  int len;
+
+  if(pattern == NULL || handler == NULL || subscriptions_grow(subs) != FUNC_SUCCESS) {
+    goto error;
+  }
+  sub = &(subs->subscriptions[subs->size]);
+  sub->hash = hash_string(pattern, &len);
+  sub->pattern = mem_malloc(NULL, len + NULL_CHAR_OFFSET);
+  if(sub->pattern == NULL) {
+    goto error;
+  }
+  if(prefix && prefix_len_add(subs, len) != FUNC_SUCCESS) {
+    mem_free(NULL, sub->pattern);
+    goto error;
+  }
+  memcpy(sub->pattern, pattern, len + NULL_CHAR_OFFSET);
+  sub->len = len;
+  sub->prefix = prefix;
+  sub->active = 1;
+  sub->handler = handler;
+  sub->ctx = ctx;
+  table_insert(subs, subs->size);
+  return subs->size++;
+
+error:
+  log_error("properties_subscribe");
+  return FUNC_FAILURE;
+}
+
+int properties_subscribe(char *key, properties_change_handler_t *handler, void *ctx,
+                         properties_subscriptions_t *subs) {
+  return subscribe(key, 0, handler, ctx, subs);
+}
+
+int properties_subscribe_prefix(char *prefix, properties_change_handler_t *handler, void *ctx,
+                                properties_subscriptions_t *subs) {
+  return subscribe(prefix, 1, handler, ctx, subs);
+}
+
+int properties_unsubscribe(int id, properties_subscriptions_t *subs) {
+  if(id < 0 || id >= subs->size || !subs->subscriptions[id].active) {
+    log_error("properties_unsubscribe : no subscription %d", id);
+    return FUNC_FAILURE;
+  }
+  /* the subscription stays in the table, inactive */
+  subs->subscriptions[id].active = 0;
+  return FUNC_SUCCESS;
+}
+
+/**
+ * Calls the active subscriptions of a pattern : the first len bytes of the key, whose hash is given.
+ */
+static void dispatch_pattern(properties_subscriptions_t *subs, int prefix, char *key, int len, unsigned int hash,
+                             void *old_value, void *new_value) {
+  _subscription_t *sub;
+  unsigned int pos = hash & subs->table_mask;
+  int id;
+
+  while((id = subs->table[pos]) != 0) {
+    sub = &(subs->subscriptions[id - 1]);
+    if(sub->active && sub->prefix == prefix && sub->hash == hash && sub->len == len
+       && memcmp(sub->pattern, key, len) == 0 && sub->handler(key, old_value, new_value, sub->ctx) == FUNC_FAILURE) {
+      log_error("properties_notify : subscription %d failed on %s", id - 1, key);
+    }
+    pos = (pos + 1) & subs->table_mask;
+  }
+}
+
+static int dispatch(char *key, void *old_value, void *new_value, void *ctx) {
+  properties_subscriptions_t *subs = ctx;
+  unsigned int hash;
+  int len, i;
+
+  hash = hash_string(key, &len);
+  dispatch_pattern(subs, 0, key, len, hash, old_value, new_value);
+  for(i = 0; i < subs->nb_prefix_lens; i++) {
+    if(subs->prefix_lens[i] <= len) {
+      dispatch_pattern(subs, 1, key, subs->prefix_lens[i], hash_bytes(key, subs->prefix_lens[i]), old_value,
+                       new_value);
+    }
+  }
+  return FUNC_SUCCESS;
+}
+
+int properties_notify(properties_t *old_props, properties_t *new_props, properties_subscriptions_t *subs) {
+  if(subs->size == 0) {
+    return properties_diff(old_props, new_props, NULL, NULL, NULL, NULL);
+  }
+  return properties_diff(old_props, new_props, dispatch, dispatch, dispatch, subs);
+}
+
+void properties_subscriptions_free(properties_subscriptions_t *subs) {
+  int id;
+
+  for(id = 0; id < subs->size; id++) {
+    mem_free(NULL, subs->subscriptions[id].pattern);
+  }
+  mem_free(NULL, subs->subscriptions);
+  mem_free(NULL, subs->table);
+  mem_free(NULL, subs->prefix_lens);
+  mem_free(NULL, subs);
+}
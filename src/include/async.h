@@ -0,0 +1,101 @@
+/*
+ * Filename:  async.h
+ *
+ * Description:  Header file where the asynchronous load functions are declared.
+ * A file is read and analysed by a worker thread, and the end of the load is signaled through a file descriptor
+ * (an eventfd on Linux, a pipe elsewhere) which becomes readable, so that an event loop can wait for it
+ * with poll, epoll or select along with its other descriptors, without ever blocking on the analysis.
+ *
+ * Copyright (c) 2017 Erwann Miriel, erwann.miriel@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROPERTIES_ASYNC_H
+#define PROPERTIES_ASYNC_H
+
+#include "lexer.h"
+
+/**
+ * @brief Options of an asynchronous load.
+ * recover enables the recovery mode of the analysis, allocator is the allocator of the properties holder
+ * (NULL for the default allocator).
+ */
+typedef struct _properties_load_opts properties_load_opts_t;
+
+struct _properties_load_opts {
+    int recover;
+    properties_allocator_t *allocator;
+};
+
+/**
+ * @brief Result of an asynchronous load.
+ * properties is the filled properties holder (NULL if the file could not be opened), now owned by the caller.
+ * diagnostics is an array of nb_diagnostics diagnostics, owned by the caller (to be freed with free),
+ * whose filename is the path given to properties_load_async and must be freed with it.
+ */
+typedef struct _properties_load_result properties_load_result_t;
+
+struct _properties_load_result {
+    properties_t *properties;
+    int nb_diagnostics;
+    lexer_diagnostic_t *diagnostics;
+    char *filename;
+};
+
+/**
+ * @brief Pending asynchronous load.
+ */
+typedef struct _properties_load properties_load_t;
+
+/**
+ * @brief Starts loading a file on a worker thread.
+ *
+ * @param path the path of the file (copied)
+ * @param opts the options, NULL for the defaults
+ * @param p_handle filled with the handle of the load
+ *
+ * @return 0 if the load started, -1 otherwise
+ */
+int properties_load_async(char *path, properties_load_opts_t *opts, properties_load_t **p_handle);
+
+/**
+ * @brief Gets the file descriptor which becomes readable once the load is over.
+ * It stays owned by the handle : it must not be read nor closed, only watched.
+ *
+ * @param handle the handle of the load
+ *
+ * @return the file descriptor
+ */
+int properties_load_async_fd(properties_load_t *handle);
+
+/**
+ * @brief Collects the result of a load and frees its handle.
+ * Meant to be called once the descriptor is readable : called before, it waits for the end of the load.
+ *
+ * @param handle the handle of the load
+ * @param result filled with the result
+ *
+ * @return 0 if the file was loaded without error, -1 otherwise
+ */
+int properties_load_async_finish(properties_load_t *handle, properties_load_result_t *result);
+
+/**
+ * @brief Frees the result of a load : the properties holder, the diagnostics and the filename.
+ *
+ * @param result the result
+ */
+void properties_load_result_free(properties_load_result_t *result);
+
+#endif
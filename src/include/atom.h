@@ -0,0 +1,70 @@
+/*
+ * Filename:  atom.h
+ *
+ * Description:  Header file where the key atoms are declared.
+ * An atom is the single copy of a key shared by the whole process : the properties holders storing their keys
+ * as atoms pay their memory once, and compare them by pointer.
+ *
+ * Copyright (c) 2017 Erwann Miriel, erwann.miriel@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROPERTIES_ATOM_H
+#define PROPERTIES_ATOM_H
+
+/**
+ * @brief Gets the atom of a key, and takes a reference on it. Thread-safe.
+ * The atom is the key itself, as a string, and stays valid until its last reference is released.
+ *
+ * @param key the key
+ * @param key_len the length of the key
+ *
+ * @return the atom if succeeded, NULL otherwise
+ */
+char *properties_atom_acquire(char *key, int key_len);
+
+/**
+ * @brief Releases a reference on an atom. Thread-safe.
+ *
+ * @param atom the atom
+ */
+void properties_atom_release(char *atom);
+
+/**
+ * @brief Gets the hash of an atom, computed once when it was created.
+ *
+ * @param atom the atom
+ *
+ * @return the hash (see hash_bytes)
+ */
+unsigned int properties_atom_hash(char *atom);
+
+/**
+ * @brief Gets the length of an atom.
+ *
+ * @param atom the atom
+ *
+ * @return the length
+ */
+int properties_atom_len(char *atom);
+
+/**
+ * @brief Gets the number of atoms of the process.
+ *
+ * @return the number of atoms
+ */
+int properties_atom_count();
+
+#endif
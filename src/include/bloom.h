@@ -0,0 +1,99 @@
+/*
+ * Filename:  bloom.h
+ *
+ * Description:  Header file where the bloom filter functions are declared.
+ * The filter is blocked : all the bits of a key are set in one block of a cache line,
+ * so that a lookup of an absent key is rejected after a single cache line access.
+ *
+ * Copyright (c) 2017 Erwann Miriel, erwann.miriel@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROPERTIES_BLOOM_H
+#define PROPERTIES_BLOOM_H
+
+#include "memctx.h"
+
+/**
+ * Blocked bloom filter, sized for capacity keys at the false positive rate fp_rate.
+ * blocks is aligned on cache lines inside blocks_mem, each block holding BLOOM_BLOCK_WORDS words.
+ */
+typedef struct _bloom _bloom_t;
+
+struct _bloom {
+    unsigned long long *blocks;
+    void *blocks_mem;
+    unsigned int block_mask;
+    int nb_hashes;
+    int capacity;
+    int count;
+    double fp_rate;
+};
+
+/**
+ * Creates a filter.
+ *
+ * @param mem the memory context
+ * @param capacity the number of keys the filter is sized for
+ * @param fp_rate the false positive rate, between 0 and 1 (excluded)
+ *
+ * @return the filter if succeeded, NULL otherwise
+ */
+_bloom_t *bloom_new(_memctx_t *mem, int capacity, double fp_rate);
+
+/**
+ * Frees a filter.
+ *
+ * @param mem the memory context the filter was created with
+ * @param bloom the filter
+ */
+void bloom_free(_memctx_t *mem, _bloom_t *bloom);
+
+/**
+ * Gets the memory used by a filter.
+ *
+ * @param bloom the filter
+ *
+ * @return the number of bytes allocated for the filter
+ */
+size_t bloom_memory(_bloom_t *bloom);
+
+/**
+ * Adds a key to a filter.
+ *
+ * @param bloom the filter
+ * @param hash the hash of the key
+ */
+void bloom_add(_bloom_t *bloom, unsigned int hash);
+
+/**
+ * Tests a key.
+ *
+ * @param bloom the filter
+ * @param hash the hash of the key
+ *
+ * @return 0 if the key is absent, 1 if it may be present
+ */
+int bloom_may_contain(_bloom_t *bloom, unsigned int hash);
+
+/**
+ * Prefetches the block of a key.
+ *
+ * @param bloom the filter
+ * @param hash the hash of the key
+ */
+void bloom_prefetch(_bloom_t *bloom, unsigned int hash);
+
+#endif
@@ -0,0 +1,61 @@
+/*
+ * Filename:  cache.h
+ *
+ * Description:  Header file where the process-wide cache of parsed files is declared.
+ * The cache keeps one frozen snapshot per file, identified by its device, inode, size and modification time :
+ * loading an unchanged file again shares the snapshot instead of parsing the file once more.
+ *
+ * Copyright (c) 2017 Erwann Miriel, erwann.miriel@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROPERTIES_CACHE_H
+#define PROPERTIES_CACHE_H
+
+#include "properties.h"
+
+/**
+ * @brief Gets the snapshot of a file, parsing it only if the cache has no snapshot of its current version,
+ * and takes a reference on it. Thread-safe.
+ * The snapshot is compacted and frozen : it must not be modified, nor freed but with properties_cache_release.
+ *
+ * @param filename path to the file
+ *
+ * @return the snapshot if succeeded, NULL if the file cannot be read or parsed
+ */
+properties_t *properties_cache_load(char *filename);
+
+/**
+ * @brief Releases a reference on a snapshot. Thread-safe.
+ * The snapshot is freed with its last reference, once the cache no longer holds it.
+ *
+ * @param properties the snapshot, as returned by properties_cache_load
+ */
+void properties_cache_release(properties_t *properties);
+
+/**
+ * @brief Drops the snapshots held by the cache. Thread-safe.
+ * The snapshots still referenced stay valid until released, the next loads parse their file again.
+ */
+void properties_cache_clear();
+
+/**
+ * @brief Gets the number of snapshots held by the cache.
+ *
+ * @return the number of snapshots
+ */
+int properties_cache_count();
+
+#endif
@@ -0,0 +1,121 @@
+/*
+ * Filename:  diff.h
+ *
+ * Description:  Header file where the comparison of properties holders and the change subscriptions are declared.
+ *
+ * Copyright (c) 2017 Erwann Miriel, erwann.miriel@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROPERTIES_DIFF_H
+#define PROPERTIES_DIFF_H
+
+#include "properties.h"
+
+/**
+ * @brief Function called for a changed property.
+ * old_value is NULL for an added property, new_value is NULL for a removed one.
+ * Returning -1 stops the comparison.
+ */
+typedef int (properties_change_handler_t)(char *key, void *old_value, void *new_value, void *ctx);
+
+/**
+ * @brief Set of subscriptions to the changes of keys or of key prefixes.
+ */
+typedef struct _properties_subscriptions properties_subscriptions_t;
+
+/**
+ * @brief Compares two versions of properties.
+ * Each key of the new version is looked up by its hash in the old one, and the old keys not met are the removed ones,
+ * so the comparison runs in linear time. String values are compared as strings, and the other ones
+ * (added by properties_property_put or properties_property_add) by pointer.
+ * The added and changed properties are reported in the order of the new version, then the removed ones
+ * in the order of the old version. A NULL handler skips its kind of change.
+ *
+ * @param old_props the old version
+ * @param new_props the new version
+ * @param on_added called for each key only in the new version
+ * @param on_removed called for each key only in the old version
+ * @param on_changed called for each key whose value differs
+ * @param ctx given to the handlers
+ *
+ * @return the number of changes if succeeded, -1 otherwise (or if a handler stopped the comparison)
+ */
+int properties_diff(properties_t *old_props, properties_t *new_props, properties_change_handler_t *on_added,
+                    properties_change_handler_t *on_removed, properties_change_handler_t *on_changed, void *ctx);
+
+/**
+ * @brief Creates an empty set of subscriptions.
+ *
+ * @return the subscriptions if succeeded, NULL otherwise
+ */
+properties_subscriptions_t *properties_subscriptions_new();
+
+/**
+ * @brief Subscribes to the changes of a key.
+ *
+ * @param key the key, copied
+ * @param handler called for each change of the key (added, removed or changed)
+ * @param ctx given to the handler
+ * @param subscriptions the subscriptions
+ *
+ * @return the id of the subscription if succeeded, -1 otherwise
+ */
+int properties_subscribe(char *key, properties_change_handler_t *handler, void *ctx,
+                         properties_subscriptions_t *subscriptions);
+
+/**
+ * @brief Subscribes to the changes of the keys starting with a prefix.
+ *
+ * @param prefix the prefix, copied
+ * @param handler called for each change of a key starting with the prefix
+ * @param ctx given to the handler
+ * @param subscriptions the subscriptions
+ *
+ * @return the id of the subscription if succeeded, -1 otherwise
+ */
+int properties_subscribe_prefix(char *prefix, properties_change_handler_t *handler, void *ctx,
+                                properties_subscriptions_t *subscriptions);
+
+/**
+ * @brief Cancels a subscription.
+ *
+ * @param id the id of the subscription
+ * @param subscriptions the subscriptions
+ *
+ * @return 0 if succeeded, -1 otherwise
+ */
+int properties_unsubscribe(int id, properties_subscriptions_t *subscriptions);
+
+/**
+ * @brief Compares two versions of properties, and calls the subscriptions of the changed keys only.
+ * A change matching several subscriptions is given to each of them ; a handler returning -1 is only logged.
+ *
+ * @param old_props the old version
+ * @param new_props the new version
+ * @param subscriptions the subscriptions
+ *
+ * @return the number of changes if succeeded, -1 otherwise
+ */
+int properties_notify(properties_t *old_props, properties_t *new_props, properties_subscriptions_t *subscriptions);
+
+/**
+ * @brief Frees a set of subscriptions.
+ *
+ * @param subscriptions the subscriptions
+ */
+void properties_subscriptions_free(properties_subscriptions_t *subscriptions);
+
+#endif
@@ -0,0 +1,117 @@
+/*
+ * Filename:  intern.h
+ *
+ * Description:  Header file where the string interning functions are declared.
+ * An interning table keeps a single reference counted copy of each string it is given,
+ * so that equal strings share their memory and can be compared by pointer.
+ *
+ * Copyright (c) 2017 Erwann Miriel, erwann.miriel@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROPERTIES_INTERN_H
+#define PROPERTIES_INTERN_H
+
+#include <stddef.h>
+
+#include "memctx.h"
+
+/**
+ * Interned string : its hash, length and number of references, followed by the string itself.
+ */
+typedef struct _intern_entry _intern_entry_t;
+
+struct _intern_entry {
+    unsigned int hash;
+    int len;
+    int refs;
+    char str[];
+};
+
+/* entry of an interned string */
+#define INTERN_ENTRY(interned)  ((_intern_entry_t *) ((char *) (interned) - offsetof(_intern_entry_t, str)))
+
+/**
+ * Open addressing table of the entries, located by hash.
+ * hashes repeats the hash of each slot, so that probing does not read the entries.
+ */
+typedef struct _intern_table _intern_table_t;
+
+struct _intern_table {
+    _memctx_t *mem;
+    unsigned int *hashes;
+    _intern_entry_t **entries;
+    unsigned int mask;
+    int size;
+};
+
+/**
+ * Creates an empty table.
+ *
+ * @param mem the memory context of the table and of its strings
+ *
+ * @return the table if succeeded, NULL otherwise
+ */
+_intern_table_t *intern_new(_memctx_t *mem);
+
+/**
+ * Frees a table and all its strings, whatever their references.
+ *
+ * @param table the table
+ */
+void intern_free(_intern_table_t *table);
+
+/**
+ * Gets the memory used by a table.
+ *
+ * @param table the table
+ *
+ * @return the number of bytes allocated for the table and its strings
+ */
+size_t intern_memory(_intern_table_t *table);
+
+/**
+ * Gets the interned copy of a string, adding it if needed, and takes a reference on it.
+ *
+ * @param table the table
+ * @param str the string
+ * @param len the length of the string
+ * @param hash the hash of the string (see hash_bytes)
+ *
+ * @return the interned copy if succeeded, NULL otherwise
+ */
+char *intern_acquire(_intern_table_t *table, char *str, int len, unsigned int hash);
+
+/**
+ * Finds the interned copy of a string, without taking a reference.
+ *
+ * @param table the table
+ * @param str the string
+ * @param len the length of the string
+ * @param hash the hash of the string
+ *
+ * @return the interned copy if found, NULL otherwise
+ */
+char *intern_find(_intern_table_t *table, char *str, int len, unsigned int hash);
+
+/**
+ * Drops a reference on an interned string, removing it from the table with its last reference.
+ *
+ * @param table the table
+ * @param str the interned string, as returned by intern_acquire
+ */
+void intern_release(_intern_table_t *table, char *str);
+
+#endif
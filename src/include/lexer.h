@@ -39,6 +39,33 @@
  */
 typedef struct _lexer lexer_t;
 
+/**
+ * @brief Size of the token excerpt kept in a diagnostic (including the null char).
+ */
+#define LEXER_DIAGNOSTIC_TOKEN_SIZE 40
+
+/**
+ * @brief Describes a syntax error met during the analysis.
+ * The filename is owned by the lexer and stays valid until lexer_free.
+ */
+typedef struct _lexer_diagnostic lexer_diagnostic_t;
+
+struct _lexer_diagnostic {
+    char *filename;
+    int line;
+    int column;
+    char token[LEXER_DIAGNOSTIC_TOKEN_SIZE];
+    char *message;
+};
+
+/**
+ * @brief Function receiving each property found by the analysis, instead of the properties holder.
+ * The key and the value are NUL terminated, and only valid during the call.
+ *
+ * @return 0 to go on with the analysis, -1 to stop it with an error
+ */
+typedef int (lexer_property_handler_t) (char *key, int key_len, char *value, int value_len, void *ctx);
+
 /**
  * @brief Inits the lexer.
  * Opens the file from filename,
@@ -53,6 +80,19 @@ typedef struct _lexer lexer_t;
  */
 lexer_t *lexer_new(char *filename, properties_t *properties);
 
+/**
+ * @brief Inits the lexer, allocating its working memory (states, tokens, buffers) with an allocator.
+ * Keys and values are always allocated with the allocator of the properties holder.
+ * lexer_new uses the allocator of the properties holder.
+ *
+ * @param filename the filename to analyse
+ * @param properties the properties structure to fill
+ * @param allocator the allocator, NULL for the default allocator
+ *
+ * @return the newly created lexer if succeeded, NULL otherwise
+ */
+lexer_t *lexer_new_with_allocator(char *filename, properties_t *properties, properties_allocator_t *allocator);
+
 /**
  * @brief Deletes the lexer from memory.
  *
@@ -62,6 +102,7 @@ void lexer_free(lexer_t *lexer);
 
 /**
  * @brief Analyses the file and builds the properties found in the file.
+ * A lexer analyses its file once : a second analysis only gives the result of the first one.
  *
  * @param lexer the lexer which will launch the analysis
  *
@@ -70,4 +111,70 @@ void lexer_free(lexer_t *lexer);
  */
 int lexer_analyze(lexer_t *lexer);
 
+/**
+ * @brief Analyses the next part of the file, so that the analysis can be interleaved with other work.
+ * The step stops at the end of the line or token during which max_bytes more bytes have been read,
+ * so a step reads a little more than max_bytes. Once the analysis is over, the statistics are added
+ * to the properties holder as by lexer_analyze ; stepping the lexer again, or analysing the file with it,
+ * gives the same result without reading nor counting anything more.
+ *
+ * @param lexer the lexer
+ * @param max_bytes the number of bytes to read in this step, 0 to analyse the whole file (as lexer_analyze)
+ *
+ * @return 1 if the analysis is not over, 0 if it is over and succeeded, -1 otherwise
+ */
+int lexer_analyze_step(lexer_t *lexer, long max_bytes);
+
+/**
+ * @brief Enables or disables the recovery mode.
+ * In recovery mode, the analysis does not stop at the first error :
+ * the error is recorded as a diagnostic, the rest of the logical line is skipped
+ * and the analysis goes on with the next line. Errors are not logged.
+ *
+ * @param lexer the lexer
+ * @param recover 0 to stop at the first error (default), any other value to recover
+ */
+void lexer_set_recovery(lexer_t *lexer, int recover);
+
+/**
+ * @brief Enables or disables the timing of the analysis : the times spent scanning, lexing and inserting.
+ * Timing reads the clock several times per token, so it is disabled by default and these times are then 0.
+ * The other statistics are always counted.
+ *
+ * @param lexer the lexer
+ * @param enabled 1 to time the analysis, 0 not to
+ */
+void lexer_set_timing(lexer_t *lexer, int enabled);
+
+/**
+ * @brief Sets a handler receiving the properties found, which are then no longer added to the properties holder.
+ * The statistics are still added to the holder.
+ *
+ * @param lexer the lexer
+ * @param handler the handler, NULL to fill the properties holder again
+ * @param ctx the context given to the handler
+ */
+void lexer_set_property_handler(lexer_t *lexer, lexer_property_handler_t *handler, void *ctx);
+
+/**
+ * @brief Gets the diagnostics recorded during the last analysis.
+ *
+ * @param lexer the lexer
+ * @param p_diagnostics filled with the array of diagnostics (owned by the lexer)
+ *
+ * @return the number of diagnostics
+ */
+int lexer_get_diagnostics(lexer_t *lexer, lexer_diagnostic_t **p_diagnostics);
+
+/**
+ * @brief Gets the statistics of the analysis : bytes read, tokens by type, lines, continuation lines,
+ * escape sequences, allocations, peak stringbuilder size and, if timed (see lexer_set_timing),
+ * time spent scanning, lexing and inserting.
+ * Once the analysis is over, they are also added to the statistics of the properties holder.
+ *
+ * @param lexer the lexer
+ * @param stats the statistics to fill
+ */
+void lexer_get_stats(lexer_t *lexer, properties_stats_t *stats);
+
 #endif
@@ -0,0 +1,111 @@
+/*
+ * Filename:  memctx.h
+ *
+ * Description:  Header file where the allocators, the memory context and its allocation functions are declared.
+ * Every allocation of the library goes through a memory context, which counts them
+ * and forwards them to its allocator.
+ *
+ * Copyright (c) 2017 Erwann Miriel, erwann.miriel@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROPERTIES_MEMCTX_H
+#define PROPERTIES_MEMCTX_H
+
+#include <stddef.h>
+
+/**
+ * @brief Allocation functions, given the user context ctx on each call.
+ * Allows to route the memory of the library to pools or arenas.
+ */
+typedef struct _properties_allocator properties_allocator_t;
+
+struct _properties_allocator {
+    void *(*alloc)(size_t size, void *ctx);
+    void *(*realloc)(void *ptr, size_t size, void *ctx);
+    void (*free)(void *ptr, void *ctx);
+    void *ctx;
+};
+
+/**
+ * @brief Sets the default allocator, used by the holders and lexers created without allocator.
+ * The allocator must outlive every holder and lexer using it.
+ * Intended to be called once, before creating any holder.
+ *
+ * @param allocator the allocator, NULL to restore the standard allocator (malloc, realloc, free)
+ */
+void properties_allocator_set_default(properties_allocator_t *allocator);
+
+/**
+ * @brief Gets the default allocator.
+ *
+ * @return the default allocator
+ */
+properties_allocator_t *properties_allocator_get_default();
+
+/**
+ * Counts the allocations made through it and forwards them to its allocator.
+ */
+typedef struct _memctx _memctx_t;
+
+struct _memctx {
+    properties_allocator_t *allocator;
+    unsigned long long nb_malloc;
+    unsigned long long nb_realloc;
+};
+
+/**
+ * Inits a memory context.
+ *
+ * @param mem the memory context
+ * @param allocator the allocator, NULL for the current default allocator
+ */
+void mem_init(_memctx_t *mem, properties_allocator_t *allocator);
+
+/**
+ * Allocates memory.
+ *
+ * @param mem the memory context (NULL for the default allocator, uncounted)
+ * @param size the size to allocate
+ *
+ * @return the allocated memory if succeeded, NULL otherwise
+ */
+void *mem_malloc(_memctx_t *mem, size_t size);
+
+/**
+ * Reallocates memory. Reallocating NULL counts as an allocation.
+ *
+ * @param mem the memory context (can be NULL)
+ * @param ptr the memory to reallocate
+ * @param size the new size
+ *
+ * @return the reallocated memory if succeeded, NULL otherwise
+ */
+void *mem_realloc(_memctx_t *mem, void *ptr, size_t size);
+
+/**
+ * Frees memory.
+ *
+ * @param mem the memory context (can be NULL)
+ * @param ptr the memory to free
+ */
+void mem_free(_memctx_t *mem, void *ptr);
+
+/**
+ * Same as manage_size, reallocating through a memory context.
+ */
+int mem_manage_size(_memctx_t *mem, void **inflatable, int cur_size, int *p_max_size, int step, size_t ptrsize);
+
+#endif
@@ -0,0 +1,135 @@
+/*
+ * Filename:  profile.h
+ *
+ * Description:  Header file where all public Profiling functions are declared.
+ * The profiler is an opt-in mode measuring each phase of a load (scanning, lexing, insertion)
+ * and of the lookups, with hardware performance counters when the system provides them
+ * and with wall-clock time otherwise.
+ *
+ * Copyright (c) 2017 Erwann Miriel, erwann.miriel@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROPERTIES_PROFILE_H
+#define PROPERTIES_PROFILE_H
+
+/**
+ * @brief Measured phases.
+ */
+typedef enum {
+    PROFILE_SCAN        = 0,
+    PROFILE_LEX         = 1,
+    PROFILE_INSERT      = 2,
+    PROFILE_LOOKUP      = 3,
+    PROFILE_NB_PHASES   = 4
+} properties_profile_phase;
+
+/**
+ * @brief Hardware counters flags, telling which counters could be opened.
+ */
+typedef enum {
+    PROFILE_HW_CYCLES           = 1,
+    PROFILE_HW_INSTRUCTIONS     = 2,
+    PROFILE_HW_BRANCH_MISSES    = 4,
+    PROFILE_HW_LLC_MISSES       = 8
+} properties_profile_hw;
+
+/**
+ * @brief Counters accumulated for one phase.
+ */
+typedef struct _properties_phase_counters properties_phase_counters_t;
+
+struct _properties_phase_counters {
+    unsigned long long calls;
+    unsigned long long wall_ns;
+    unsigned long long cycles;
+    unsigned long long instructions;
+    unsigned long long branch_misses;
+    unsigned long long llc_misses;
+};
+
+/**
+ * @brief Profiling report.
+ * hardware is a combination of properties_profile_hw flags, 0 if only wall-clock time is available.
+ */
+typedef struct _properties_profile properties_profile_t;
+
+struct _properties_profile {
+    int hardware;
+    properties_phase_counters_t phases[PROFILE_NB_PHASES];
+};
+
+/**
+ * @brief Starts profiling.
+ * Counters follow the calling thread : phases run by other threads are not measured.
+ * If no hardware counter can be opened (unsupported system, restricted perf_event_paranoid...),
+ * only wall-clock time and calls are recorded.
+ *
+ * @return 0 if succeeded, -1 otherwise (profiling already started)
+ */
+int properties_profile_start();
+
+/**
+ * @brief Stops profiling and releases the counters. The last report stays readable.
+ */
+void properties_profile_stop();
+
+/**
+ * @brief Resets the accumulated counters.
+ */
+void properties_profile_reset();
+
+/**
+ * @brief Reads the counters accumulated since the start (or the last reset).
+ *
+ * @param profile the report to fill
+ */
+void properties_profile_read(properties_profile_t *profile);
+
+/**
+ * @brief Gets the printable name of a phase.
+ *
+ * @param phase the phase
+ *
+ * @return the name of the phase
+ */
+char *properties_profile_phase_name(properties_profile_phase phase);
+
+/**
+ * Internal hooks, used by the library to delimit phases.
+ */
+
+extern int profile_enabled;
+
+/**
+ * @brief Enters a phase, pausing the current one.
+ *
+ * @param phase the entered phase
+ *
+ * @return the paused phase, to give back to profile_leave
+ */
+int profile_enter(properties_profile_phase phase);
+
+/**
+ * @brief Leaves the current phase and resumes the paused one.
+ *
+ * @param previous the phase returned by profile_enter
+ */
+void profile_leave(int previous);
+
+#define PROFILE_ENTER(phase)        (profile_enabled ? profile_enter(phase) : -1)
+#define PROFILE_LEAVE(previous)     do { if(profile_enabled) { profile_leave(previous); } } while(0)
+
+#endif
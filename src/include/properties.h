@@ -24,6 +24,13 @@
 #ifndef PROPERTIES_H
 #define PROPERTIES_H
 
+#include "memctx.h"
+
+/**
+ * @brief Number of token types counted in the statistics.
+ */
+#define PROPERTIES_STATS_TOKEN_TYPES 12
+
 /**
  * @brief Function pointer to delete a valueholder's value from memory.
  */
@@ -39,15 +46,129 @@ typedef struct _valueholder valueholder_t;
  */
 typedef struct _property property_t;
 
+/**
+ * @brief Parsing statistics.
+ * tokens[i] counts the tokens of type (1 << i), lines counts the line terminators
+ * (continuation lines included), simple_lines the lines read at once without tokens,
+ * and the times are given in nanoseconds, 0 unless the analysis was timed (see lexer_set_timing).
+ */
+typedef struct _properties_stats properties_stats_t;
+
+struct _properties_stats {
+    unsigned long long loads;
+    unsigned long long bytes_read;
+    unsigned long long tokens[PROPERTIES_STATS_TOKEN_TYPES];
+    unsigned long long lines;
+    unsigned long long continuation_lines;
+    unsigned long long escapes_decoded;
+    unsigned long long simple_lines;
+    unsigned long long nb_malloc;
+    unsigned long long nb_realloc;
+    unsigned long long peak_builder_size;
+    unsigned long long scanner_ns;
+    unsigned long long lexer_ns;
+    unsigned long long insertion_ns;
+};
+
+/**
+ * @brief Memory used by a properties holder, in bytes.
+ * index counts the holder, its parallel arrays up to its size, and its hash index, sorted index and bloom filter.
+ * nodes counts the property nodes, keys and values the strings stored by the holder, inline or apart
+ * (the interned values with their table). The atoms are shared by the process, and the values not given as strings
+ * are opaque : they are not counted.
+ * slack counts the memory allocated but not used : the capacity of the arrays past the size
+ * and, once compacted, the padding and the room left by the removed properties.
+ */
+typedef struct _properties_memory properties_memory_t;
+
+struct _properties_memory {
+    size_t index;
+    size_t nodes;
+    size_t keys;
+    size_t values;
+    size_t slack;
+    size_t total;
+};
+
+/**
+ * @brief Resolved key, giving the value of a property without searching for it again.
+ * Its fields are private : the key it was resolved with, the hash and length of the key,
+ * the slot of the property (-1 if absent) and the generation of the properties holder it was resolved in.
+ */
+typedef struct _properties_handle properties_handle_t;
+
+struct _properties_handle {
+    char *key;
+    int key_len;
+    unsigned int hash;
+    int slot;
+    unsigned int generation;
+};
+
+/**
+ * @brief Cursor over the properties of a holder, in slot order.
+ * Its fields are private : the next slot, and the generation of the properties holder when the iteration began.
+ */
+typedef struct _properties_iter properties_iter_t;
+
+struct _properties_iter {
+    int slot;
+    unsigned int generation;
+};
+
+/**
+ * @brief Estimated number of lookups of a property (see properties_set_access_sampling).
+ */
+typedef struct _properties_access properties_access_t;
+
+struct _properties_access {
+    char *key;
+    unsigned int count;
+};
+
 /**
  * @brief Contains the list of properties.
  */
 typedef struct _properties properties_t;
 
+/*
+ * The properties are stored as parallel arrays (structure of arrays), in insertion order :
+ * the nodes (contents), and for the lookups, the 32 bits hashes of the keys, their lengths,
+ * the keys and the values. Lookups compare the hashes first and only read a key when its hash matches.
+ * Over a few properties, an open addressing index (slot + 1, 0 when empty) locates the hashes.
+ * A frozen holder also has a sorted index, used for its lookups and for the ordered queries.
+ * An optional bloom filter rejects most of the absent keys before the lookup.
+ * The generation changes whenever properties are added or removed, telling the handles to resolve their key again.
+ * When intern_values is set, the string values share their copies through values_table.
+ * When atom_keys is set, the keys are atoms of the process (see atom.h).
+ * Once compacted, the nodes, with their keys and string values, lie in the packed block of packed_size bytes,
+ * and so do the arrays while packed_arrays is set (until they have to grow).
+ * While the lookups are sampled, access_counts holds the estimated number of lookups of each slot,
+ * one lookup in access_period being counted.
+ */
 struct _properties {
     int size;
     int capacity;
     property_t **contents;
+    unsigned int *hashes;
+    int *key_lens;
+    char **keys;
+    void **values;
+    int *index;
+    unsigned int index_mask;
+    struct _sorted_index *sorted;
+    struct _bloom *bloom;
+    unsigned int generation;
+    struct _intern_table *values_table;
+    int intern_values;
+    int atom_keys;
+    char *packed;
+    size_t packed_size;
+    int packed_arrays;
+    unsigned int *access_counts;
+    unsigned int access_period;
+    _memctx_t mem;
+    properties_stats_t stats;
 };
 
 /**
@@ -57,8 +178,18 @@ struct _properties {
  */
 properties_t *properties_new();
 
+/**
+ * @brief creates a new properties holder, allocating all its memory with an allocator
+ *
+ * @param allocator the allocator, NULL for the default allocator
+ *
+ * @return the new properties holder if succeeded, NULL otherwise
+ */
+properties_t *properties_new_with_allocator(properties_allocator_t *allocator);
+
 /**
  * @brief Creates a new property.
+ * The key, and the value if dealloc is NULL, are freed with the default allocator.
  *
  * @param key the name of the property
  * @param value the value of the property
@@ -74,12 +205,51 @@ property_t *properties_property_new(char *key, void *value, _free_func_t *deallo
  * @param properties the property
  * @param property the properties holder
  *
- * @return 0 if succeeded, -1 otherwise
+ * @return 0 if succeeded, -1 otherwise : the property is then not in the holder, and still the caller's
  */
 int properties_property_add(property_t *property, properties_t *properties);
 
+/**
+ * @brief Tells whether the value of a property is a string, like the ones of a loaded file or of put_string.
+ *
+ * @param property the property
+ *
+ * @return 1 if the value is a string, 0 otherwise
+ */
+int properties_property_is_string(property_t *property);
+
+/**
+ * @brief Creates a new property and adds it to the properties holder.
+ * The property is allocated with the allocator of the properties holder.
+ * The key, and the value if dealloc is NULL, must come from the same allocator.
+ *
+ * @param key the name of the property
+ * @param value the value of the property
+ * @param dealloc the deallocation function of the value
+ * @param properties the properties holder
+ *
+ * @return 0 if succeeded, -1 otherwise : the key and the value are then still the caller's
+ */
+int properties_property_put(char *key, void *value, _free_func_t *dealloc, properties_t *properties);
+
+/**
+ * @brief Adds a copy of a string property to the properties holder.
+ * Short keys and values are stored inside the property itself, longer ones are allocated apart,
+ * with the allocator of the properties holder.
+ *
+ * @param key the name of the property
+ * @param key_len the length of the name
+ * @param value the string value of the property
+ * @param value_len the length of the value
+ * @param properties the properties holder
+ *
+ * @return 0 if succeeded, -1 otherwise
+ */
+int properties_property_put_string(char *key, int key_len, char *value, int value_len, properties_t *properties);
+
 /**
  * @brief fills an array of char containing all properties' names from the properties holder
+ * The array is allocated with malloc, to be freed by the caller (properties_iter_next allocates nothing).
  *
  * @param properties the properties holder
  * @param propertiesNames the array of names to fill
@@ -99,6 +269,100 @@ int properties_get_keys(char ***p_keys, properties_t *properties);
  */
 void* properties_get_value(char *key, properties_t *properties);
 
+/**
+ * @brief Gets property by name and length in the properties holder : the name needs no terminating NUL,
+ * and is not measured again. Frozen holders are searched through their hashes rather than their sorted index.
+ *
+ * @param key the name of the property to find
+ * @param key_len the length of the name
+ * @param properties the properties holder
+ *
+ * @return property if found, NULL otherwise
+ */
+void *properties_get_value_len(const char *key, int key_len, properties_t *properties);
+
+/**
+ * @brief Gets property by the atom of its name (see properties_atom_acquire), without hashing the name again.
+ *
+ * @param atom the atom of the name of the property
+ * @param properties the properties holder
+ *
+ * @return the value if found, NULL otherwise
+ */
+void *properties_get_by_atom(char *atom, properties_t *properties);
+
+/**
+ * @brief Resolves a key once, for the repeated lookups of properties_get_by_handle.
+ *
+ * @param key the name of the property, which must outlive the handle
+ * @param properties the properties holder
+ *
+ * @return the handle
+ */
+properties_handle_t properties_resolve(char *key, properties_t *properties);
+
+/**
+ * @brief Gets the value of a property by its handle : a slot and a generation check.
+ * If properties were added or removed since the key was resolved, the handle is resolved again first.
+ *
+ * @param handle the handle
+ * @param properties the properties holder the handle was resolved in
+ *
+ * @return the value if found, NULL otherwise
+ */
+void *properties_get_by_handle(properties_handle_t *handle, properties_t *properties);
+
+/**
+ * @brief Gets the values of several properties at once.
+ * All the keys are hashed and their index entries prefetched before any of them is resolved,
+ * so that the cache misses of the lookups overlap.
+ *
+ * @param keys the names of the properties to find
+ * @param nb_keys the number of names
+ * @param values filled with the value of each property, NULL for the absent ones
+ * @param properties the properties holder
+ *
+ * @return the number of properties found
+ */
+int properties_get_values(char **keys, int nb_keys, void **values, properties_t *properties);
+
+/**
+ * @brief Starts an iteration over the properties of a holder. Nothing is allocated.
+ *
+ * @param iter the cursor to initialize
+ * @param properties the properties holder
+ */
+void properties_iter_begin(properties_iter_t *iter, properties_t *properties);
+
+/**
+ * @brief Gets the next property of an iteration, reading the arrays of the holder in order.
+ * The holder must not be modified during the iteration.
+ *
+ * @param iter the cursor
+ * @param p_key filled with the key (can be NULL)
+ * @param p_key_len filled with the length of the key (can be NULL)
+ * @param p_value filled with the value (can be NULL)
+ * @param properties the properties holder
+ *
+ * @return 1 if a property was given, 0 at the end of the properties, -1 if the holder was modified
+ */
+int properties_iter_next(properties_iter_t *iter, char **p_key, int *p_key_len, void **p_value,
+                         properties_t *properties);
+
+/**
+ * @brief Finds the slot of a property whose key is already hashed (32 bits FNV-1a, see hash_bytes).
+ * The slots go from 0 to the size of the properties holder, in insertion order,
+ * until properties are removed or the layout is optimized.
+ *
+ * @param key the name of the property
+ * @param key_len the length of the name
+ * @param hash the hash of the name
+ * @param properties the properties holder
+ *
+ * @return the slot if found, -1 otherwise
+ */
+int properties_find_slot(char *key, int key_len, unsigned int hash, properties_t *properties);
+
 /**
  * @brief Finds and removes property from the properties holder (the property is freed).
  *
@@ -110,6 +374,165 @@ void* properties_get_value(char *key, properties_t *properties);
  */
 int properties_property_free(char *key, properties_t *properties);
 
+/**
+ * @brief Enables the bloom filter of the properties holder, or disables it.
+ * Lookups of absent keys are then rejected after a single cache line access, except for a rate of false positives.
+ * The filter is sized from the number of properties and grows with them.
+ *
+ * @param properties the properties holder
+ * @param fp_rate the false positive rate, between 0 and 1, or 0 to disable the filter
+ *
+ * @return 0 if succeeded, -1 otherwise
+ */
+int properties_set_bloom_filter(properties_t *properties, double fp_rate);
+
+/**
+ * @brief Makes the properties holder store the keys of its string properties as atoms of the process, or not.
+ * The holders sharing key names then share the memory of their keys, and properties_get_by_atom compares keys by pointer.
+ * The keys of the properties added with properties_property_put or properties_property_add are stored as atoms too :
+ * the key given is then freed as the property would have freed it.
+ * Only an empty holder can change the way it stores its keys.
+ *
+ * @param properties the properties holder
+ * @param enabled 1 to store the keys as atoms, 0 to copy them
+ *
+ * @return 0 if succeeded, -1 otherwise
+ */
+int properties_set_key_atoms(properties_t *properties, int enabled);
+
+/**
+ * @brief Enables the interning of the string values added from now on, or disables it.
+ * Equal values then share a single reference counted copy, and can be compared by pointer.
+ * Values added before keep their own copies.
+ *
+ * @param properties the properties holder
+ * @param enabled 1 to intern the values, 0 to copy them
+ *
+ * @return 0 if succeeded, -1 otherwise
+ */
+int properties_set_value_interning(properties_t *properties, int enabled);
+
+/**
+ * @brief Enables the sampled counting of the lookups by key, atom or handle, or disables it.
+ * A lookup is drawn with a probability of 1 / period by a generator of the calling thread, and adds period
+ * to the count of its property : unsampled lookups only pay for a few instructions, and concurrent lookups
+ * add their counts atomically. The counts are kept when the period changes.
+ *
+ * @param properties the properties holder
+ * @param period the sampling period, a power of 2 (1 to count every lookup), or 0 to disable the counting and drop the counts
+ *
+ * @return 0 if succeeded, -1 otherwise
+ */
+int properties_set_access_sampling(properties_t *properties, unsigned int period);
+
+/**
+ * @brief Gets the most looked up properties, by decreasing count, typically to find the configuration reads
+ * made on a hot path.
+ *
+ * @param accesses filled with the keys and their counts
+ * @param nb the size of accesses, the size of the properties holder to get every count
+ * @param properties the properties holder
+ *
+ * @return the number of accesses filled, -1 if the lookups are not counted
+ */
+int properties_hot_keys(properties_access_t *accesses, int nb, properties_t *properties);
+
+/**
+ * @brief Reorders the slots of a properties holder by decreasing count, so that the most looked up properties
+ * share the first cache lines of the arrays and take the first places of the hash index.
+ * A compacted holder is compacted again in this order, its hot nodes, keys and string values then lying together
+ * at the start of the block : as with properties_compact, the string values move.
+ * Duplicate keys keep their order. The handles resolve their key again.
+ *
+ * @param properties the properties holder, not frozen, whose lookups are counted
+ *
+ * @return 0 if succeeded, -1 otherwise
+ */
+int properties_optimize_layout(properties_t *properties);
+
+/**
+ * @brief Freezes the properties holder : the keys are sorted once, and until the holder is unfrozen,
+ * lookups search the sorted keys and the ordered queries are available. A frozen holder cannot be modified.
+ *
+ * @param properties the properties holder
+ *
+ * @return 0 if succeeded, -1 otherwise
+ */
+int properties_freeze(properties_t *properties);
+
+/**
+ * @brief Unfreezes the properties holder, dropping its sorted index.
+ *
+ * @param properties the properties holder
+ */
+void properties_unfreeze(properties_t *properties);
+
+/**
+ * @brief Finds the first key, in byte order, greater than or equal to a key.
+ * With properties_sorted_key and properties_sorted_value, iterates the keys in order from there.
+ *
+ * @param key the key
+ * @param properties the frozen properties holder
+ *
+ * @return the rank of the first key not lower than key (the size if there is none), -1 if not frozen
+ */
+int properties_lower_bound(char *key, properties_t *properties);
+
+/**
+ * @brief Gets a key by its rank in byte order.
+ *
+ * @param rank the rank, from 0 to the size of the properties holder
+ * @param properties the frozen properties holder
+ *
+ * @return the key if found, NULL otherwise
+ */
+char *properties_sorted_key(int rank, properties_t *properties);
+
+/**
+ * @brief Gets a value by the rank of its key in byte order.
+ *
+ * @param rank the rank, from 0 to the size of the properties holder
+ * @param properties the frozen properties holder
+ *
+ * @return the value if found, NULL otherwise
+ */
+void *properties_sorted_value(int rank, properties_t *properties);
+
+/**
+ * @brief Gets the statistics accumulated by all the analyses which filled the properties holder.
+ *
+ * @param properties the properties holder
+ * @param stats the statistics to fill
+ */
+void properties_stats(properties_t *properties, properties_stats_t *stats);
+
+/**
+ * @brief Adds statistics to others.
+ *
+ * @param total the statistics to add to
+ * @param stats the statistics to add
+ */
+void properties_stats_add(properties_stats_t *total, properties_stats_t *stats);
+
+/**
+ * @brief Measures the memory used by a properties holder.
+ *
+ * @param properties the properties holder
+ * @param report the report to fill
+ */
+void properties_memory_usage(properties_t *properties, properties_memory_t *report);
+
+/**
+ * @brief Repacks the arrays, the nodes, and the keys and string values of a properties holder into a single block
+ * of the exact size, typically once loaded. The hash index and the bloom filter are rebuilt to fit,
+ * and the handles resolve their key again. The holder can still be modified afterwards.
+ *
+ * @param properties the properties holder
+ *
+ * @return 0 if succeeded, -1 otherwise
+ */
+int properties_compact(properties_t *properties);
+
 /**
  * @brief frees the properties holder from memory
  *
@@ -0,0 +1,359 @@
+/*
+ * Filename:  properties.hpp
+ *
+ * Description:  C++17 interface of the library.
+ * Properties and Lexer own a properties holder and a lexer, and free them when destroyed : they can be moved,
+ * not copied. The lookups take a std::string_view and go through properties_get_value_len,
+ * so a key is neither copied nor measured. Nothing throws : a failed creation leaves an empty object.
+ *
+ * Copyright (c) 2017 Erwann Miriel, erwann.miriel@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROPERTIES_HPP
+#define PROPERTIES_HPP
+
+#include <cerrno>
+#include <charconv>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+extern "C" {
+#include "properties.h"
+#include "lexer.h"
+}
+
+namespace props {
+
+/**
+ * @brief Converts the string value of a property.
+ * Supported types : std::string_view and const char * (no copy), std::string, bool ("true", "false", "1", "0"),
+ * the integer types and the floating point types, the whole value having to be converted.
+ *
+ * @param value the value, NUL terminated
+ *
+ * @return the converted value, std::nullopt if value is NULL or cannot be converted
+ */
+template <typename T>
+std::optional<T> convert(const char *value) noexcept {
+  if(value == nullptr) {
+    return std::nullopt;
+  }
+  if constexpr (std::is_same_v<T, const char *>) {
+    return value;
+  } else if constexpr (std::is_same_v<T, std::string_view>) {
+    return std::string_view(value);
+  } else if constexpr (std::is_same_v<T, std::string>) {
+    return std::string(value);
+  } else if constexpr (std::is_same_v<T, bool>) {
+    std::string_view str(value);
+    if(str == "true" || str == "1") {
+      return true;
+    }
+    if(str == "false" || str == "0") {
+      return false;
+    }
+    return std::nullopt;
+  } else if constexpr (std::is_integral_v<T>) {
+    std::size_t len = std::strlen(value);
+    T result;
+    auto [end, error] = std::from_chars(value, value + len, result);
+    if(error != std::errc() || end != value + len) {
+      return std::nullopt;
+    }
+    return result;
+  } else if constexpr (std::is_floating_point_v<T>) {
+    char *end;
+    long double result;
+    errno = 0;
+    result = std::strtold(value, &end);
+    if(end == value || *end != '\0' || errno == ERANGE) {
+      return std::nullopt;
+    }
+    return static_cast<T>(result);
+  } else {
+    static_assert(!std::is_same_v<T, T>, "props::convert : unsupported type");
+  }
+}
+
+/**
+ * @brief Owner of a properties holder.
+ * The values are taken as strings : the ones given by the lexer or by put.
+ */
+class Properties {
+public:
+    /**
+     * @brief Input iterator over the properties, in slot order, yielding (key, value) pairs.
+     * It reads the arrays of the holder through properties_iter_next : nothing is allocated,
+     * and it ends early if the holder is modified.
+     */
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = std::pair<std::string_view, const char *>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type *;
+        using reference = const value_type &;
+
+        iterator() noexcept = default;
+
+        explicit iterator(properties_t *properties) noexcept : properties_(properties) {
+          properties_iter_begin(&iter_, properties_);
+          ++*this;
+        }
+
+        reference operator*() const noexcept {
+          return current_;
+        }
+
+        pointer operator->() const noexcept {
+          return &current_;
+        }
+
+        iterator &operator++() noexcept {
+          char *key;
+          int key_len;
+          void *value;
+
+          if(properties_iter_next(&iter_, &key, &key_len, &value, properties_) == 1) {
+            current_ = value_type(std::string_view(key, key_len), static_cast<const char *>(value));
+          } else {
+            properties_ = nullptr;
+          }
+          return *this;
+        }
+
+        iterator operator++(int) noexcept {
+          iterator previous = *this;
+          ++*this;
+          return previous;
+        }
+
+        bool operator==(const iterator &other) const noexcept {
+          return properties_ == other.properties_ && (properties_ == nullptr || iter_.slot == other.iter_.slot);
+        }
+
+        bool operator!=(const iterator &other) const noexcept {
+          return !(*this == other);
+        }
+
+    private:
+        properties_t *properties_ = nullptr;
+        properties_iter_t iter_ = {0, 0};
+        value_type current_;
+    };
+
+    Properties() noexcept : properties_(properties_new()) {
+    }
+
+    explicit Properties(properties_allocator_t *allocator) noexcept
+        : properties_(properties_new_with_allocator(allocator)) {
+    }
+
+    /**
+     * @brief Takes the ownership of a properties holder.
+     */
+    explicit Properties(properties_t *properties) noexcept : properties_(properties) {
+    }
+
+    Properties(const Properties &) = delete;
+    Properties &operator=(const Properties &) = delete;
+
+    Properties(Properties &&other) noexcept : properties_(std::exchange(other.properties_, nullptr)) {
+    }
+
+    Properties &operator=(Properties &&other) noexcept {
+      if(this != &other) {
+        reset(std::exchange(other.properties_, nullptr));
+      }
+      return *this;
+    }
+
+    ~Properties() {
+      reset(nullptr);
+    }
+
+    explicit operator bool() const noexcept {
+      return properties_ != nullptr;
+    }
+
+    properties_t *get() const noexcept {
+      return properties_;
+    }
+
+    /**
+     * @brief Gives up the ownership of the properties holder.
+     */
+    properties_t *release() noexcept {
+      return std::exchange(properties_, nullptr);
+    }
+
+    void reset(properties_t *properties) noexcept {
+      if(properties_ != nullptr) {
+        properties_free(properties_);
+      }
+      properties_ = properties;
+    }
+
+    int size() const noexcept {
+      return properties_->size;
+    }
+
+    /**
+     * @brief Loads a file into the properties holder.
+     * @return true if the whole file was loaded, false otherwise
+     */
+    bool load(const char *filename) noexcept;
+
+    /**
+     * @brief Adds a copy of a string property.
+     * @return true if succeeded, false otherwise
+     */
+    bool put(std::string_view key, std::string_view value) noexcept {
+      return properties_property_put_string(const_cast<char *>(key.data()), static_cast<int>(key.size()),
+                                            const_cast<char *>(value.data()), static_cast<int>(value.size()),
+                                            properties_) == 0;
+    }
+
+    /**
+     * @brief Gets the value of a property, without copying nor measuring the key.
+     * @return the value if found, nullptr otherwise
+     */
+    const char *find(std::string_view key) const noexcept {
+      return static_cast<const char *>(properties_get_value_len(key.data(), static_cast<int>(key.size()),
+                                                                properties_));
+    }
+
+    bool contains(std::string_view key) const noexcept {
+      return find(key) != nullptr;
+    }
+
+    /**
+     * @brief Gets the value of a property, converted (see convert).
+     * @return the value if found and converted, std::nullopt otherwise
+     */
+    template <typename T>
+    std::optional<T> get(std::string_view key) const noexcept {
+      return convert<T>(find(key));
+    }
+
+    /**
+     * @brief Gets the value of a property, converted (see convert), or a fallback.
+     */
+    template <typename T>
+    T get(std::string_view key, T fallback) const noexcept {
+      return convert<T>(find(key)).value_or(fallback);
+    }
+
+    iterator begin() const noexcept {
+      return iterator(properties_);
+    }
+
+    iterator end() const noexcept {
+      return iterator();
+    }
+
+private:
+    properties_t *properties_;
+};
+
+/**
+ * @brief Owner of a lexer.
+ */
+class Lexer {
+public:
+    Lexer(const char *filename, Properties &properties) noexcept
+        : lexer_(lexer_new(const_cast<char *>(filename), properties.get())) {
+    }
+
+    Lexer(const Lexer &) = delete;
+    Lexer &operator=(const Lexer &) = delete;
+
+    Lexer(Lexer &&other) noexcept : lexer_(std::exchange(other.lexer_, nullptr)) {
+    }
+
+    Lexer &operator=(Lexer &&other) noexcept {
+      if(this != &other) {
+        if(lexer_ != nullptr) {
+          lexer_free(lexer_);
+        }
+        lexer_ = std::exchange(other.lexer_, nullptr);
+      }
+      return *this;
+    }
+
+    ~Lexer() {
+      if(lexer_ != nullptr) {
+        lexer_free(lexer_);
+      }
+    }
+
+    explicit operator bool() const noexcept {
+      return lexer_ != nullptr;
+    }
+
+    lexer_t *get() const noexcept {
+      return lexer_;
+    }
+
+    void set_recovery(bool recover) noexcept {
+      lexer_set_recovery(lexer_, recover ? 1 : 0);
+    }
+
+    void set_timing(bool enabled) noexcept {
+      lexer_set_timing(lexer_, enabled ? 1 : 0);
+    }
+
+    /**
+     * @brief Analyzes the file.
+     * @return true if the whole file was analyzed, false otherwise (see lexer_get_diagnostics)
+     */
+    bool analyze() noexcept {
+      return lexer_analyze(lexer_) == 0;
+    }
+
+    /**
+     * @brief Analyzes the next part of the file (see lexer_analyze_step).
+     * @return 1 if the analysis is not over, 0 if it is over and succeeded, -1 otherwise
+     */
+    int analyze_step(long max_bytes) noexcept {
+      return lexer_analyze_step(lexer_, max_bytes);
+    }
+
+    properties_stats_t stats() const noexcept {
+      properties_stats_t stats;
+      lexer_get_stats(lexer_, &stats);
+      return stats;
+    }
+
+private:
+    lexer_t *lexer_;
+};
+
+inline bool Properties::load(const char *filename) noexcept {
+  Lexer lexer(filename, *this);
+  return lexer && lexer.analyze();
+}
+
+}
+
+#endif
@@ -0,0 +1,223 @@
+/*
+ * Filename:  properties_async.hpp
+ *
+ * Description:  C++20 coroutine interface of the load.
+ * props::load_async is a coroutine analysing a file by steps of a few blocks (lexer_analyze_step),
+ * and giving control back to the caller's executor between two steps : co_awaited from a coroutine,
+ * many files load concurrently on the executor's threads, without any thread of their own.
+ * The executor is reached through its schedule() function, whose result is co_awaited between two steps.
+ *
+ * Copyright (c) 2017 Erwann Miriel, erwann.miriel@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROPERTIES_ASYNC_HPP
+#define PROPERTIES_ASYNC_HPP
+
+#if __cplusplus < 202002L
+#error "properties_async.hpp needs C++20"
+#endif
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <utility>
+
+#include "properties.hpp"
+
+extern "C" {
+#include "reader.h"
+}
+
+namespace props {
+
+/**
+ * @brief Lazy coroutine giving a T, started when co_awaited, and resuming its awaiter when over.
+ * As nothing throws in the library, an exception escaping the coroutine terminates the program.
+ */
+template <typename T>
+class Task {
+public:
+    struct promise_type {
+        std::optional<T> value;
+        std::coroutine_handle<> continuation = std::noop_coroutine();
+
+        struct final_awaiter {
+            bool await_ready() const noexcept {
+              return false;
+            }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+              return handle.promise().continuation;
+            }
+
+            void await_resume() const noexcept {
+            }
+        };
+
+        Task get_return_object() noexcept {
+          return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() const noexcept {
+          return {};
+        }
+
+        final_awaiter final_suspend() const noexcept {
+          return {};
+        }
+
+        void return_value(T result) noexcept {
+          value.emplace(std::move(result));
+        }
+
+        void unhandled_exception() const noexcept {
+          std::terminate();
+        }
+    };
+
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+
+    Task(Task &&other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {
+    }
+
+    Task &operator=(Task &&other) noexcept {
+      if(this != &other) {
+        if(handle_) {
+          handle_.destroy();
+        }
+        handle_ = std::exchange(other.handle_, nullptr);
+      }
+      return *this;
+    }
+
+    /**
+     * @brief Destroys the coroutine, which must not be scheduled on an executor : the executor would resume it.
+     * A task is thus destroyed before being co_awaited or once over ; a load is cancelled through load_options::stop.
+     */
+    ~Task() {
+      if(handle_) {
+        handle_.destroy();
+      }
+    }
+
+    bool await_ready() const noexcept {
+      return false;
+    }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept {
+      handle_.promise().continuation = awaiter;
+      return handle_;
+    }
+
+    T await_resume() noexcept {
+      return std::move(*handle_.promise().value);
+    }
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> handle) noexcept : handle_(handle) {
+    }
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+/**
+ * @brief Executor reachable from a coroutine : co_await executor.schedule() resumes the coroutine on it, later.
+ */
+template <typename E>
+concept executor = requires(E &e) {
+  e.schedule();
+};
+
+enum class load_status {
+    loaded,
+    failed,
+    cancelled
+};
+
+/**
+ * @brief Options of load_async.
+ * step_size is the number of bytes analysed before giving control back, stop cancels the load between two steps
+ * (the only way to cancel a started load),
+ * allocator is the allocator of the properties holder (nullptr for the default allocator).
+ */
+struct load_options {
+    long step_size = READER_BLOCK_SIZE;
+    bool recover = false;
+    std::stop_token stop;
+    properties_allocator_t *allocator = nullptr;
+};
+
+/**
+ * @brief Result of load_async.
+ * properties holds what was analysed when failed (everything but the wrong lines in recovery mode),
+ * nothing when cancelled.
+ */
+struct load_result {
+    Properties properties{static_cast<properties_t *>(nullptr)};
+    load_status status = load_status::failed;
+
+    explicit operator bool() const noexcept {
+      return status == load_status::loaded;
+    }
+};
+
+/**
+ * @brief Loads a file, giving control back to an executor between two steps of the analysis.
+ * The task starts when co_awaited, and ends on the executor's thread. Once started, it must not be destroyed
+ * before it is over : it is cancelled through options.stop, and then ends at its next step.
+ *
+ * @param filename the path of the file
+ * @param executor the executor, which must outlive the load
+ * @param options the options
+ *
+ * @return the task giving the loaded properties
+ */
+template <executor Executor>
+Task<load_result> load_async(std::string filename, Executor &executor, load_options options = {}) {
+  load_result result;
+  int status;
+
+  result.properties = Properties(options.allocator);
+  if(!result.properties) {
+    co_return result;
+  }
+  Lexer lexer(filename.c_str(), result.properties);
+  if(!lexer) {
+    co_return result;
+  }
+  lexer.set_recovery(options.recover);
+
+  for(;;) {
+    if(options.stop.stop_requested()) {
+      result.properties.reset(nullptr);
+      result.status = load_status::cancelled;
+      co_return result;
+    }
+    status = lexer.analyze_step(options.step_size);
+    if(status != 1) {
+      result.status = status == 0 ? load_status::loaded : load_status::failed;
+      co_return result;
+    }
+    co_await executor.schedule();
+  }
+}
+
+}
+
+#endif
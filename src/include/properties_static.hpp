@@ -0,0 +1,552 @@
+/*
+ * Filename:  properties_static.hpp
+ *
+ * Description:  C++20 compile-time parsing of embedded properties.
+ * props::parse<"text">() parses a string literal while compiling, with the grammar of the scanner and the lexer,
+ * into a static_properties table : the keys and values, and a perfect hash of the keys. Declared constexpr,
+ * the table sits in read-only data and costs nothing at startup. A syntax error stops the compilation
+ * on a call to the function naming it (see the syntax errors below).
+ *
+ * Copyright (c) 2017 Erwann Miriel, erwann.miriel@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROPERTIES_STATIC_HPP
+#define PROPERTIES_STATIC_HPP
+
+#if __cplusplus < 202002L
+#error "properties_static.hpp needs C++20"
+#endif
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+#include "properties.hpp"
+
+namespace props {
+
+/**
+ * @brief String literal given as a template argument.
+ */
+template <std::size_t N>
+struct fixed_string {
+    char data[N] = {};
+
+    constexpr fixed_string(const char (&str)[N]) {
+      for(std::size_t i = 0; i < N; i++) {
+        data[i] = str[i];
+      }
+    }
+
+    constexpr std::string_view view() const {
+      return std::string_view(data, N - 1);
+    }
+};
+
+namespace detail {
+
+/*
+ * Syntax errors. They are not constexpr : reached while parsing at compile time, they stop the compilation,
+ * their name giving the reason (the messages of lexer_analyze) and their argument the line.
+ */
+inline void expected_a_parameter_name(int) {}
+inline void parameter_name_without_assignment(int) {}
+inline void unauthorized_character_in_parameter_name(int) {}
+inline void parameter_without_value(int) {}
+inline void escape_at_end_of_input(int) {}
+inline void perfect_hash_not_found(int) {}
+
+/* attempts to place a bucket of keys before giving up */
+constexpr std::uint32_t MAX_SEEDS = 1u << 20;
+
+constexpr bool is_ws(char c) {
+  return c == ' ' || c == '\t';
+}
+
+constexpr bool is_newline(char c) {
+  return c == '\r' || c == '\n';
+}
+
+constexpr bool is_alnum(char c) {
+  return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+constexpr bool is_xdigit(char c) {
+  return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+constexpr bool is_ponct(char c) {
+  return c == '-' || c == '_' || c == '.';
+}
+
+constexpr bool is_assign(char c) {
+  return c == '=' || c == ':';
+}
+
+constexpr bool is_comment(char c) {
+  return c == '#' || c == '!';
+}
+
+/* the token types of the scanner */
+enum class token_type {
+    eof, ws, escaped_char, unicode_char, newline, alnum, ponct, assign, other, comment
+};
+
+/**
+ * A token : its value is text[begin, end), which drops the backslash of an escaped newline
+ * and the leading character of a comment, as the scanner does. next is the position after the token.
+ */
+struct token {
+    token_type type;
+    std::size_t begin;
+    std::size_t end;
+    std::size_t next;
+};
+
+constexpr std::size_t skip(std::string_view text, std::size_t pos, bool (*checker)(char)) {
+  while(pos < text.size() && checker(text[pos])) {
+    pos++;
+  }
+  return pos;
+}
+
+constexpr bool not_newline(char c) {
+  return !is_newline(c);
+}
+
+constexpr token next_token(std::string_view text, std::size_t pos, int line) {
+  std::size_t end;
+  char c;
+
+  if(pos >= text.size()) {
+    return {token_type::eof, pos, pos, pos};
+  }
+  c = text[pos];
+  if(is_ws(c)) {
+    end = skip(text, pos, is_ws);
+    return {token_type::ws, pos, end, end};
+  }
+  if(c == '\\') {
+    if(pos + 1 >= text.size()) {
+      escape_at_end_of_input(line);
+    }
+    c = text[pos + 1];
+    if(c == 'u') {
+      /* at most 6 digits, as in scanUnicodeChar */
+      end = pos + 2;
+      while(end < text.size() && end < pos + 8 && is_xdigit(text[end])) {
+        end++;
+      }
+      return {token_type::unicode_char, pos, end, end};
+    }
+    if(c == '\r' && pos + 2 < text.size() && text[pos + 2] == '\n') {
+      return {token_type::escaped_char, pos + 1, pos + 3, pos + 3};
+    }
+    if(is_newline(c)) {
+      return {token_type::escaped_char, pos + 1, pos + 2, pos + 2};
+    }
+    return {token_type::escaped_char, pos, pos + 2, pos + 2};
+  }
+  if(is_newline(c)) {
+    return {token_type::newline, pos, pos + 1, pos + 1};
+  }
+  if(is_alnum(c)) {
+    end = skip(text, pos, is_alnum);
+    return {token_type::alnum, pos, end, end};
+  }
+  if(is_ponct(c)) {
+    end = skip(text, pos, is_ponct);
+    return {token_type::ponct, pos, end, end};
+  }
+  if(is_assign(c)) {
+    return {token_type::assign, pos, pos + 1, pos + 1};
+  }
+  if(is_comment(c)) {
+    end = skip(text, pos + 1, not_newline);
+    return {token_type::comment, pos + 1, end, end};
+  }
+  return {token_type::other, pos, pos + 1, pos + 1};
+}
+
+/**
+ * Runs the states of the lexer over a text, giving the properties to a sink :
+ * begin with the key, value for each piece of the value, then end.
+ */
+template <typename Sink>
+constexpr void parse_text(std::string_view text, Sink &sink) {
+  enum { START, PARAM_NAME, ASSIGN, PARAM_VALUE } state = START;
+  std::size_t pos = 0, key_begin = 0, key_end = 0;
+  int line = 1;
+  token tok;
+
+  for(;;) {
+    tok = next_token(text, pos, line);
+    pos = tok.next;
+    if(tok.type == token_type::newline
+       || (tok.type == token_type::escaped_char && is_newline(text[tok.begin]))) {
+      line++;
+    }
+    switch(state) {
+      case START:
+        if(tok.type == token_type::alnum || tok.type == token_type::ponct) {
+          key_begin = tok.begin;
+          key_end = tok.end;
+          state = PARAM_NAME;
+        } else if(tok.type == token_type::eof) {
+          return;
+        } else if(tok.type != token_type::comment && tok.type != token_type::newline && tok.type != token_type::ws) {
+          expected_a_parameter_name(line);
+        }
+        break;
+      case PARAM_NAME:
+        if(tok.type == token_type::alnum || tok.type == token_type::ponct) {
+          key_end = tok.end;
+        } else if(tok.type == token_type::ws || tok.type == token_type::assign) {
+          state = ASSIGN;
+        } else if(tok.type == token_type::newline || tok.type == token_type::eof) {
+          parameter_name_without_assignment(line);
+        } else {
+          unauthorized_character_in_parameter_name(line);
+        }
+        break;
+      case ASSIGN:
+        if(tok.type == token_type::newline || tok.type == token_type::eof) {
+          parameter_without_value(line);
+        } else if(tok.type != token_type::ws) {
+          sink.begin(text.substr(key_begin, key_end - key_begin));
+          sink.value(text.substr(tok.begin, tok.end - tok.begin));
+          state = PARAM_VALUE;
+        }
+        break;
+      case PARAM_VALUE:
+        if(tok.type == token_type::newline || tok.type == token_type::eof) {
+          sink.end();
+          if(tok.type == token_type::eof) {
+            return;
+          }
+          state = START;
+        } else {
+          sink.value(text.substr(tok.begin, tok.end - tok.begin));
+        }
+        break;
+    }
+  }
+}
+
+/**
+ * Sizes of a table : the properties (duplicates included) and their characters, NUL terminators included.
+ */
+struct counts {
+    std::size_t entries = 0;
+    std::size_t chars = 0;
+
+    constexpr void begin(std::string_view key) {
+      entries++;
+      chars += key.size() + 2;
+    }
+
+    constexpr void value(std::string_view piece) {
+      chars += piece.size();
+    }
+
+    constexpr void end() {
+    }
+};
+
+constexpr counts measure(std::string_view text) {
+  counts sink;
+  parse_text(text, sink);
+  return sink;
+}
+
+constexpr std::size_t nb_slots(std::size_t nb_entries) {
+  return std::bit_ceil(nb_entries + nb_entries / 4 + 1);
+}
+
+constexpr std::size_t nb_buckets(std::size_t nb_entries) {
+  return std::bit_ceil(nb_entries / 2 + 1);
+}
+
+/**
+ * Hash of a key, the seed giving an independent function (FNV-1a, then a final mix).
+ */
+constexpr std::uint32_t hash(std::string_view key, std::uint32_t seed) {
+  std::uint32_t h = 2166136261u ^ (seed * 0x9e3779b9u);
+
+  for(char c : key) {
+    h ^= static_cast<unsigned char>(c);
+    h *= 16777619u;
+  }
+  h ^= h >> 16;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35u;
+  h ^= h >> 16;
+  return h;
+}
+
+}
+
+/**
+ * @brief Properties parsed at compile time (see parse).
+ * The keys and values are stored NUL terminated in chars. A key goes to a bucket with the seed 0,
+ * then to its slot with the seed of its bucket : the seeds are chosen so that no two keys share a slot,
+ * and a lookup hashes twice and compares one key at most. The first of duplicate keys is kept, as in a holder.
+ */
+template <std::size_t NbEntries, std::size_t NbChars, std::size_t NbSlots, std::size_t NbBuckets>
+class static_properties {
+public:
+    struct entry {
+        std::uint32_t key;
+        std::uint32_t key_len;
+        std::uint32_t value;
+    };
+
+    /**
+     * @brief Iterator over the properties, in the order of the text, yielding (key, value) pairs.
+     */
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::pair<std::string_view, const char *>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        constexpr iterator() = default;
+
+        constexpr iterator(const static_properties *table, std::size_t idx) : table_(table), idx_(idx) {
+        }
+
+        constexpr value_type operator*() const {
+          return value_type(table_->key(idx_), table_->value(idx_));
+        }
+
+        constexpr iterator &operator++() {
+          idx_++;
+          return *this;
+        }
+
+        constexpr iterator operator++(int) {
+          iterator previous = *this;
+          idx_++;
+          return previous;
+        }
+
+        constexpr bool operator==(const iterator &other) const = default;
+
+    private:
+        const static_properties *table_ = nullptr;
+        std::size_t idx_ = 0;
+    };
+
+    consteval explicit static_properties(std::string_view text) {
+      filler sink{*this};
+
+      detail::parse_text(text, sink);
+      place_keys();
+    }
+
+    constexpr std::size_t size() const {
+      return size_;
+    }
+
+    /**
+     * @brief Gets the value of a property.
+     * @return the value if found, nullptr otherwise
+     */
+    constexpr const char *find(std::string_view key) const {
+      std::uint32_t seed, slot;
+
+      if(size_ == 0) {
+        return nullptr;
+      }
+      seed = seeds_[detail::hash(key, 0) & (NbBuckets - 1)];
+      slot = slots_[detail::hash(key, seed) & (NbSlots - 1)];
+      if(slot == 0 || this->key(slot - 1) != key) {
+        return nullptr;
+      }
+      return value(slot - 1);
+    }
+
+    constexpr bool contains(std::string_view key) const {
+      return find(key) != nullptr;
+    }
+
+    /**
+     * @brief Gets the value of a property, converted (see convert).
+     * @return the value if found and converted, std::nullopt otherwise
+     */
+    template <typename T>
+    std::optional<T> get(std::string_view key) const noexcept {
+      return convert<T>(find(key));
+    }
+
+    template <typename T>
+    T get(std::string_view key, T fallback) const noexcept {
+      return convert<T>(find(key)).value_or(fallback);
+    }
+
+    /**
+     * @brief Adds a copy of the properties to a properties holder, typically as defaults before loading a file.
+     * @return true if succeeded, false otherwise
+     */
+    bool put_into(Properties &properties) const noexcept {
+      for(std::size_t i = 0; i < size_; i++) {
+        if(!properties.put(key(i), value(i))) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    constexpr iterator begin() const {
+      return iterator(this, 0);
+    }
+
+    constexpr iterator end() const {
+      return iterator(this, size_);
+    }
+
+private:
+    /* fills the table with the properties given by parse_text */
+    struct filler {
+        static_properties &table;
+        std::size_t start = 0;
+
+        constexpr void begin(std::string_view key) {
+          entry &e = table.entries_[table.size_];
+
+          start = table.nb_chars_;
+          e.key = static_cast<std::uint32_t>(start);
+          e.key_len = static_cast<std::uint32_t>(key.size());
+          append(key);
+          table.chars_[table.nb_chars_++] = '\0';
+          e.value = static_cast<std::uint32_t>(table.nb_chars_);
+        }
+
+        constexpr void value(std::string_view piece) {
+          append(piece);
+        }
+
+        constexpr void end() {
+          std::string_view key = table.key(table.size_);
+
+          table.chars_[table.nb_chars_++] = '\0';
+          for(std::size_t i = 0; i < table.size_; i++) {
+            if(table.key(i) == key) {
+              table.nb_chars_ = start;
+              return;
+            }
+          }
+          table.size_++;
+        }
+
+        constexpr void append(std::string_view str) {
+          for(char c : str) {
+            table.chars_[table.nb_chars_++] = c;
+          }
+        }
+    };
+
+    constexpr std::string_view key(std::size_t idx) const {
+      return std::string_view(&chars_[entries_[idx].key], entries_[idx].key_len);
+    }
+
+    constexpr const char *value(std::size_t idx) const {
+      return &chars_[entries_[idx].value];
+    }
+
+    /* places the buckets by decreasing size, each with the first seed sending its keys to free and distinct slots */
+    consteval void place_keys() {
+      std::array<std::uint32_t, NbEntries + 1> buckets{};
+      std::array<std::uint32_t, NbBuckets> sizes{};
+      std::array<std::uint32_t, NbSlots> candidates{};
+      std::size_t i, j, nb, max_size = 0;
+      std::uint32_t seed, bucket;
+      bool placed;
+
+      for(i = 0; i < size_; i++) {
+        buckets[i] = detail::hash(key(i), 0) & (NbBuckets - 1);
+        if(++sizes[buckets[i]] > max_size) {
+          max_size = sizes[buckets[i]];
+        }
+      }
+      for(std::size_t size = max_size; size > 0; size--) {
+        for(bucket = 0; bucket < NbBuckets; bucket++) {
+          if(sizes[bucket] != size) {
+            continue;
+          }
+          placed = false;
+          for(seed = 1; !placed && seed < detail::MAX_SEEDS; seed++) {
+            placed = true;
+            nb = 0;
+            for(i = 0; placed && i < size_; i++) {
+              if(buckets[i] != bucket) {
+                continue;
+              }
+              candidates[nb] = detail::hash(key(i), seed) & (NbSlots - 1);
+              placed = slots_[candidates[nb]] == 0;
+              for(j = 0; placed && j < nb; j++) {
+                placed = candidates[j] != candidates[nb];
+              }
+              nb++;
+            }
+          }
+          if(!placed) {
+            detail::perfect_hash_not_found(static_cast<int>(bucket));
+          }
+          seeds_[bucket] = seed - 1;
+          for(i = 0; i < size_; i++) {
+            if(buckets[i] == bucket) {
+              slots_[detail::hash(key(i), seed - 1) & (NbSlots - 1)] = static_cast<std::uint32_t>(i + 1);
+            }
+          }
+        }
+      }
+    }
+
+    std::size_t size_ = 0;
+    std::size_t nb_chars_ = 0;
+    std::array<char, NbChars> chars_{};
+    std::array<entry, NbEntries> entries_{};
+    /* entry + 1, 0 when empty */
+    std::array<std::uint32_t, NbSlots> slots_{};
+    std::array<std::uint32_t, NbBuckets> seeds_{};
+};
+
+/**
+ * @brief Parses a string literal at compile time.
+ * Declare the result constexpr (or constinit) : static constexpr auto defaults = props::parse<"key=value\n">();
+ *
+ * @return the table of the properties
+ */
+template <fixed_string Text>
+consteval auto parse() {
+  constexpr detail::counts counts = detail::measure(Text.view());
+
+  return static_properties<counts.entries, counts.chars, detail::nb_slots(counts.entries),
+                           detail::nb_buckets(counts.entries)>(Text.view());
+}
+
+}
+
+#endif
@@ -0,0 +1,118 @@
+/*
+ * Filename:  reader.h
+ *
+ * Description:  Header file where the block reader functions are declared.
+ * The reader fills a fixed ring of blocks with read(), so that scanning a file takes the same memory
+ * whatever its size : the blocks, plus the token being built by the scanner.
+ *
+ * Copyright (c) 2017 Erwann Miriel, erwann.miriel@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROPERTIES_READER_H
+#define PROPERTIES_READER_H
+
+#include "memctx.h"
+
+#define READER_BLOCK_SIZE   65536
+#define READER_NB_BLOCKS    2
+
+/**
+ * Block reader.
+ * The ring keeps the block before the current one, so that a character can be given back
+ * even when it was the last one of a block.
+ * offsets holds the position of each block in the file, -1 for a block never filled.
+ */
+typedef struct _reader _reader_t;
+
+struct _reader {
+    int fd;
+    _memctx_t *mem;
+    int block_size;
+    char *blocks;
+    int lens[READER_NB_BLOCKS];
+    long offsets[READER_NB_BLOCKS];
+    int current;
+    int newest;
+    int pos;
+};
+
+/**
+ * Opens a file for reading.
+ *
+ * @param filename path to the file
+ * @param block_size the size of each block of the ring
+ * @param mem the memory context used for the allocations (can be NULL)
+ *
+ * @return the reader if succeeded, NULL otherwise
+ */
+_reader_t *reader_open(char *filename, int block_size, _memctx_t *mem);
+
+/**
+ * Reads the next character, filling the next block of the ring when the current one is consumed.
+ *
+ * @param reader the reader
+ *
+ * @return the character as an unsigned char, EOF at the end of the file or on a read error
+ */
+int reader_getc(_reader_t *reader);
+
+/**
+ * Gets the characters left in the current block, without consuming them.
+ * The next block is filled first if the current one is consumed.
+ *
+ * @param reader the reader
+ * @param p_len filled with the number of characters, 0 at the end of the file
+ *
+ * @return the characters, valid until the next call on the reader, NULL at the end of the file
+ */
+char *reader_peek(_reader_t *reader, int *p_len);
+
+/**
+ * Consumes characters got from reader_peek.
+ *
+ * @param reader the reader
+ * @param len the number of characters, at most the number given by reader_peek
+ */
+void reader_skip(_reader_t *reader, int len);
+
+/**
+ * Gives back the last character read, like ungetc. Giving back EOF does nothing.
+ * Only the characters of the current and the previous blocks can be given back.
+ *
+ * @param c the character
+ * @param reader the reader
+ *
+ * @return c if succeeded, EOF otherwise
+ */
+int reader_ungetc(int c, _reader_t *reader);
+
+/**
+ * Gets the number of bytes consumed so far.
+ *
+ * @param reader the reader
+ *
+ * @return the position in the file
+ */
+long reader_tell(_reader_t *reader);
+
+/**
+ * Closes the file and frees the reader.
+ *
+ * @param reader the reader
+ */
+void reader_close(_reader_t *reader);
+
+#endif
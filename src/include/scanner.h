@@ -26,6 +26,8 @@
 #include <stdio.h>
 
 #include "token.h"
+#include "memctx.h"
+#include "reader.h"
 
 /**
  * @brief Contains informations used to scan the current file and split it into tokens.
@@ -37,18 +39,42 @@ struct _scanner {
     int current_col;
     int previous_line;
     int previous_col;
-    FILE * file;
+    _reader_t *reader;
     char *filename;
+    _memctx_t *mem;
+    int peak_builder_size;
 };
 
+/**
+ * @brief Kinds of lines read by scanner_scan_simple_line.
+ */
+typedef enum {
+    SCANNER_NO_LINE     = 0,
+    SCANNER_EMPTY_LINE  = 1,
+    SCANNER_PAIR_LINE   = 2
+} _scanner_line_type;
+
 /**
  * @brief Inits a scanner for a file.
  *
  * @param filename path to the file to scan
+ * @param mem the memory context used for the allocations (can be NULL)
+ *
+ * @return a new scanner if succeeded, NULL otherwise
+ */
+_scanner_t * scanner_new(char *filename, _memctx_t *mem);
+
+/**
+ * @brief Inits a scanner for a file, read by blocks of the given size.
+ * The memory used while scanning is bounded by the blocks of the reader and the longest token.
+ *
+ * @param filename path to the file to scan
+ * @param block_size the size of the blocks of the reader (READER_BLOCK_SIZE for scanner_new)
+ * @param mem the memory context used for the allocations (can be NULL)
  *
  * @return a new scanner if succeeded, NULL otherwise
  */
-_scanner_t * scanner_new(char *filename);
+_scanner_t * scanner_new_blocks(char *filename, int block_size, _memctx_t *mem);
 
 /**
  * @brief Scavenges a token from the file.
@@ -59,10 +85,71 @@ _scanner_t * scanner_new(char *filename);
  */
 _token_t * scanner_scan(_scanner_t *scanner);
 
+/**
+ * @brief Reads a simple line at once, without tokens : a blank line, a comment, or a parameter
+ * (name, assignment and value) without escapes and ending in the block being read.
+ * Other lines are left to scanner_scan. Must be called at the start of a line.
+ *
+ * @param scanner an initialized scanner
+ * @param p_key filled with the name of a parameter, not NUL terminated and valid until the next call on the scanner
+ * @param p_key_len filled with the length of the name
+ * @param p_value filled with the value of a parameter, not NUL terminated and valid until the next call on the scanner
+ * @param p_value_len filled with the length of the value
+ *
+ * @return SCANNER_PAIR_LINE for a parameter, SCANNER_EMPTY_LINE for a line without parameter,
+ * SCANNER_NO_LINE if nothing was read
+ */
+_scanner_line_type scanner_scan_simple_line(_scanner_t *scanner, char **p_key, int *p_key_len, char **p_value,
+                                            int *p_value_len);
+
+/**
+ * @brief Gets the number of bytes read so far.
+ *
+ * @param scanner the scanner
+ *
+ * @return the number of bytes read
+ */
+long scanner_bytes_read(_scanner_t *scanner);
+
 /**
  * @brief Closes the file associated with the scanner and frees the scanner from memory.
  *
  * @param scanner the scanner to close
  */
 void scanner_free(_scanner_t *scanner);
+
+/**
+ * Token functions allocating through a memory context.
+ * token_new, token_free and copy_or_append_token are the same without memory context.
+ */
+
+/**
+ * @brief Creates a token able to hold nb_chars characters.
+ *
+ * @param mem the memory context (can be NULL)
+ * @param nb_chars the number of characters
+ *
+ * @return the token if succeeded, NULL otherwise
+ */
+_token_t * token_new_mem(_memctx_t *mem, int nb_chars);
+
+/**
+ * @brief Frees a token.
+ *
+ * @param mem the memory context the token was allocated with
+ * @param tok the token
+ */
+void token_free_mem(_memctx_t *mem, _token_t * tok);
+
+/**
+ * @brief Copies the value of a token into a string, or appends it if the string is not empty.
+ *
+ * @param mem the memory context of the string
+ * @param p_element_value the string
+ * @param p_element_size the size of the string (0 if empty)
+ * @param p_tok the token
+ *
+ * @return 0 if succeeded, -1 otherwise
+ */
+int copy_or_append_token_mem(_memctx_t *mem, char **p_element_value, int *p_element_size, _token_t *p_tok);
 #endif
@@ -0,0 +1,130 @@
+/*
+ * Filename:  shared.h
+ *
+ * Description:  Header file where the shared properties functions are declared.
+ * A properties holder is published into a shared memory segment, then attached read-only by other processes,
+ * which all read the same physical copy. The segment only holds offsets, so it can be mapped at any address.
+ *
+ * Copyright (c) 2017 Erwann Miriel, erwann.miriel@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROPERTIES_SHARED_H
+#define PROPERTIES_SHARED_H
+
+#include "properties.h"
+
+/**
+ * @brief Properties attached from a shared memory segment.
+ */
+typedef struct _properties_shared properties_shared_t;
+
+/**
+ * @brief Publishes a new version of a properties holder under a name.
+ * The values must be strings, like the ones of a loaded file : publishing fails on any other value.
+ * Each version is a segment of its own (name.version), readable by the owner only ;
+ * a small control segment (name) holds the current version and is switched once the new segment is complete.
+ * The segment of the replaced version is unlinked : processes still attached to it keep reading it until they refresh.
+ *
+ * @param name the name of the shared memory object, starting with a slash (see shm_open)
+ * @param properties the properties holder
+ *
+ * @return the published version (1 for the first one) if succeeded, 0 otherwise
+ */
+unsigned int properties_publish(char *name, properties_t *properties);
+
+/**
+ * @brief Removes a name published by properties_publish. Attached processes keep their current version.
+ *
+ * @param name the name
+ *
+ * @return 0 if succeeded, -1 otherwise
+ */
+int properties_unpublish(char *name);
+
+/**
+ * @brief Publishes a properties holder into an anonymous segment (a sealed memfd on Linux).
+ * The descriptor is meant to be inherited by forked workers, or passed over a unix socket.
+ *
+ * @param properties the properties holder
+ *
+ * @return the descriptor of the segment if succeeded, -1 otherwise
+ */
+int properties_publish_fd(properties_t *properties);
+
+/**
+ * @brief Attaches read-only the current version published under a name.
+ *
+ * @param name the name given to properties_publish
+ *
+ * @return the attached properties if succeeded, NULL otherwise
+ */
+properties_shared_t *properties_attach(char *name);
+
+/**
+ * @brief Attaches read-only a segment given by properties_publish_fd. The descriptor can be closed afterwards.
+ *
+ * @param fd the descriptor
+ *
+ * @return the attached properties if succeeded, NULL otherwise
+ */
+properties_shared_t *properties_attach_fd(int fd);
+
+/**
+ * @brief Switches to the current version published under the name, if it changed.
+ * Values got from the previous version must not be used after a switch.
+ *
+ * @param shared the attached properties
+ *
+ * @return 1 if switched, 0 if already current (or attached from a descriptor), -1 on error (the version is kept)
+ */
+int properties_shared_refresh(properties_shared_t *shared);
+
+/**
+ * @brief Gets the value of a property in the attached properties.
+ *
+ * @param key the name of the property
+ * @param shared the attached properties
+ *
+ * @return the value, read-only, if found, NULL otherwise
+ */
+char *properties_shared_get_value(char *key, properties_shared_t *shared);
+
+/**
+ * @brief Gets the number of attached properties.
+ *
+ * @param shared the attached properties
+ *
+ * @return the number of properties
+ */
+int properties_shared_size(properties_shared_t *shared);
+
+/**
+ * @brief Gets the attached version.
+ *
+ * @param shared the attached properties
+ *
+ * @return the version, 0 if attached from a descriptor
+ */
+unsigned int properties_shared_version(properties_shared_t *shared);
+
+/**
+ * @brief Detaches the properties and frees them.
+ *
+ * @param shared the attached properties
+ */
+void properties_detach(properties_shared_t *shared);
+
+#endif
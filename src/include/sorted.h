@@ -0,0 +1,104 @@
+/*
+ * Filename:  sorted.h
+ *
+ * Description:  Header file where the sorted index functions are declared.
+ * The sorted index orders the keys of a frozen properties holder. It is laid out in Eytzinger (BFS) order,
+ * so that the first levels of a binary search share a few cache lines and the next ones can be prefetched.
+ *
+ * Copyright (c) 2017 Erwann Miriel, erwann.miriel@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROPERTIES_SORTED_H
+#define PROPERTIES_SORTED_H
+
+#include "memctx.h"
+
+/**
+ * Sorted index over n keys.
+ * sorted holds the slots in key order. The Eytzinger arrays are 1-based : node k has its children at 2k and 2k + 1,
+ * slots[k] is its slot, ranks[k] its position in key order and offsets[k] the offset of its key in the pool,
+ * where the keys are copied in the order of the nodes.
+ *
+ * A searched key reaching node k lies between the bounds of its subtree, so it shares the prefix of these bounds.
+ * nodes[k] packs the length of this prefix (skip, in the 16 low bits) and the 6 bytes of the key of k
+ * following it (big endian, in the high bits) : a search step compares these bytes only,
+ * and reads the pool when they are equal. The nodes are aligned on cache lines inside nodes_block.
+ */
+typedef struct _sorted_index _sorted_index_t;
+
+struct _sorted_index {
+    int size;
+    int common_len;
+    int *sorted;
+    unsigned long long *nodes;
+    void *nodes_block;
+    unsigned int *offsets;
+    int *slots;
+    int *ranks;
+    char *pool;
+    size_t pool_size;
+};
+
+/**
+ * Builds the sorted index of keys.
+ *
+ * @param mem the memory context
+ * @param keys the keys, by slot
+ * @param key_lens the lengths of the keys, by slot
+ * @param size the number of keys
+ *
+ * @return the index if succeeded, NULL otherwise
+ */
+_sorted_index_t *sorted_index_new(_memctx_t *mem, char **keys, int *key_lens, int size);
+
+/**
+ * Frees the sorted index.
+ *
+ * @param mem the memory context the index was built with
+ * @param index the index
+ */
+void sorted_index_free(_memctx_t *mem, _sorted_index_t *index);
+
+/**
+ * Gets the memory used by the sorted index.
+ *
+ * @param index the index
+ *
+ * @return the number of bytes allocated for the index
+ */
+size_t sorted_index_memory(_sorted_index_t *index);
+
+/**
+ * Finds the first key greater or equal to a key, with a branchless search of the Eytzinger layout.
+ *
+ * @param index the index
+ * @param key the searched key
+ *
+ * @return the rank of the lower bound, size if every key is lower
+ */
+int sorted_index_lower_bound(_sorted_index_t *index, char *key);
+
+/**
+ * Finds a key.
+ *
+ * @param index the index
+ * @param key the searched key
+ *
+ * @return the slot of the key if found, -1 otherwise
+ */
+int sorted_index_find(_sorted_index_t *index, char *key);
+
+#endif
@@ -24,6 +24,8 @@
 #ifndef PROPERTIES_STRINGBUILDER_H
 #define PROPERTIES_STRINGBUILDER_H
 
+#include "memctx.h"
+
 /**
  * Contains pieces of string to concatenate.
  */
@@ -33,14 +35,17 @@ struct _stringbuilder {
   char * string;
   int size;
   int capacity;
+  _memctx_t *mem;
 };
 
 /**
  * Inits a stringbuilder.
  *
+ * @param mem the memory context used for the allocations (can be NULL)
+ *
  * @return A new stringbuilder if succeeded, NULL otherwise
  */
-_stringbuilder_t * sb_new();
+_stringbuilder_t * sb_new(_memctx_t *mem);
 
 /**
  * Frees a stringbuilder from memory.
@@ -27,6 +27,17 @@
 
 #define NULL_CHAR_OFFSET  1
 
+#define CACHE_LINE        64
+
+/* rounds a pointer up to a multiple of align, a power of 2 */
+#define ALIGN_UP(ptr, align)  ((void *) (((size_t) (ptr) + (align) - 1) & ~(size_t) ((align) - 1)))
+
+#ifdef __GNUC__
+#define PREFETCH(addr)    __builtin_prefetch(addr)
+#else
+#define PREFETCH(addr)    ((void) (addr))
+#endif
+
 /**
  * Checks nullity of a variable number of arguments
  *
@@ -57,4 +68,29 @@ int inflate(void **inflatable, int new_size, size_t ptrsize);
  */
 int manage_size(void ** inflatable, int cur_size, int *p_max_size, int step, size_t ptrsize);
 
+/**
+ * Hashes a string (32 bits FNV-1a) and measures it.
+ *
+ * @param str the string
+ * @param p_len filled with the length of the string
+ * @return the hash
+ */
+unsigned int hash_string(const char *str, int *p_len);
+
+/**
+ * Hashes len bytes (32 bits FNV-1a). Gives the same hash as hash_string for a string of length len.
+ *
+ * @param bytes the bytes
+ * @param len the number of bytes
+ * @return the hash
+ */
+unsigned int hash_bytes(const char *bytes, int len);
+
+/**
+ * Reads the monotonic clock.
+ *
+ * @return the current time in nanoseconds
+ */
+long long time_ns();
+
 #endif
@@ -0,0 +1,198 @@
+/*
+ * Filename:  intern.c
+ *
+ * Description:  Contains the string interning tables.
+ *
+ * Copyright (c) 2017 Erwann Miriel, erwann.miriel@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "include/intern.h"
+#include "include/utils.h"
+#include "include/logging.h"
+
+#define INTERN_MIN      16
+
+_intern_table_t *intern_new(_memctx_t *mem) {
+  _intern_table_t *table;
+
+  table = mem_malloc(mem, sizeof(*table));
+  if(table == NULL) {
+    goto error;
+  }
+  table->hashes = mem_malloc(mem, INTERN_MIN * sizeof(*(table->hashes)));
+  table->entries = mem_malloc(mem, INTERN_MIN * sizeof(*(table->entries)));
+  if(table->hashes == NULL || table->entries == NULL) {
+    mem_free(mem, table->hashes);
+    mem_free(mem, table->entries);
+    mem_free(mem, table);
+    goto error;
+  }
+  memset(table->entries, 0, INTERN_MIN * sizeof(*(table->entries)));
+  table->mem = mem;
+  table->mask = INTERN_MIN - 1;
+  table->size = 0;
+  return table;
+
+error:
+  log_error("intern_new");
+  return NULL;
+}
+
+void intern_free(_intern_table_t *table) {
+  _memctx_t *mem = table->mem;
+  unsigned int pos;
+
+  for(pos = 0; pos <= table->mask; pos++) {
+    if(table->entries[pos] != NULL) {
+      mem_free(mem, table->entries[pos]);
+    }
+  }
+  mem_free(mem, table->hashes);
+  mem_free(mem, table->entries);
+  mem_free(mem, table);
+}
+
+size_t intern_memory(_intern_table_t *table) {
+  size_t size = sizeof(*table) + ((size_t) table->mask + 1) * (sizeof(*(table->hashes)) + sizeof(*(table->entries)));
+  unsigned int pos;
+
+  for(pos = 0; pos <= table->mask; pos++) {
+    if(table->entries[pos] != NULL) {
+      size += sizeof(*(table->entries[pos])) + table->entries[pos]->len + NULL_CHAR_OFFSET;
+    }
+  }
+  return size;
+}
+
+/**
+ * Finds the slot of a string.
+ * @return the slot of the string if found, otherwise the empty slot ending its probe sequence
+ */
+static unsigned int intern_probe(_intern_table_t *table, char *str, int len, unsigned int hash) {
+  _intern_entry_t *entry;
+  unsigned int pos = hash & table->mask;
+
+  while((entry = table->entries[pos]) != NULL) {
+    if(table->hashes[pos] == hash && entry->len == len && memcmp(entry->str, str, len) == 0) {
+      break;
+    }
+    pos = (pos + 1) & table->mask;
+  }
+  return pos;
+}
+
+/**
+ * Doubles the number of slots of a table.
+ * @return 0 if succeeded, -1 otherwise
+ */
+static int intern_grow(_intern_table_t *table) {
+  unsigned int *hashes, mask = 2 * table->mask + 1, old, pos;
+  _intern_entry_t **entries;
+
+  hashes = mem_malloc(table->mem, (mask + 1) * sizeof(*hashes));
+  entries = mem_malloc(table->mem, (mask + 1) * sizeof(*entries));
+  if(hashes == NULL || entries == NULL) {
+    mem_free(table->mem, hashes);
+    mem_free(table->mem, entries);
+    return FUNC_FAILURE;
+  }
+  memset(entries, 0, (mask + 1) * sizeof(*entries));
+  for(old = 0; old <= table->mask; old++) {
+    if(table->entries[old] != NULL) {
+      pos = table->hashes[old] & mask;
+      while(entries[pos] != NULL) {
+        pos = (pos + 1) & mask;
+      }
+      hashes[pos] = table->hashes[old];
+      entries[pos] = table->entries[old];
+    }
+  }
+  mem_free(table->mem, table->hashes);
+  mem_free(table->mem, table->entries);
+  table->hashes = hashes;
+  table->entries = entries;
+  table->mask = mask;
+  return FUNC_SUCCESS;
+}
+
+char *intern_acquire(_intern_table_t *table, char *str, int len, unsigned int hash) {
+  _intern_entry_t *entry;
+  unsigned int pos;
+
+  pos = intern_probe(table, str, len, hash);
+  if(table->entries[pos] != NULL) {
+    table->entries[pos]->refs++;
+    return table->entries[pos]->str;
+  }
+
+  /* the table keeps at least half of its slots empty */
+  if(2 * (unsigned int) (table->size + 1) > table->mask + 1) {
+    if(intern_grow(table) != FUNC_SUCCESS) {
+      goto error;
+    }
+    pos = intern_probe(table, str, len, hash);
+  }
+  entry = mem_malloc(table->mem, sizeof(*entry) + len + NULL_CHAR_OFFSET);
+  if(entry == NULL) {
+    goto error;
+  }
+  entry->hash = hash;
+  entry->len = len;
+  entry->refs = 1;
+  memcpy(entry->str, str, len);
+  entry->str[len] = '\0';
+  table->hashes[pos] = hash;
+  table->entries[pos] = entry;
+  table->size++;
+  return entry->str;
+
+error:
+  log_error("intern_acquire");
+  return NULL;
+}
+
+char *intern_find(_intern_table_t *table, char *str, int len, unsigned int hash) {
+  unsigned int pos = intern_probe(table, str, len, hash);
+  return table->entries[pos] == NULL ? NULL : table->entries[pos]->str;
+}
+
+void intern_release(_intern_table_t *table, char *str) {
+  _intern_entry_t *entry = INTERN_ENTRY(str);
+  unsigned int pos, next, home;
+
+  if(--entry->refs > 0) {
+    return;
+  }
+  pos = intern_probe(table, entry->str, entry->len, entry->hash);
+  mem_free(table->mem, entry);
+  table->entries[pos] = NULL;
+  table->size--;
+
+  /* moves back the following entries of the cluster which can no longer be reached past the emptied slot */
+  next = (pos + 1) & table->mask;
+  while(table->entries[next] != NULL) {
+    home = table->hashes[next] & table->mask;
+    if(((next - home) & table->mask) >= ((next - pos) & table->mask)) {
+      table->hashes[pos] = table->hashes[next];
+      table->entries[pos] = table->entries[next];
+      table->entries[next] = NULL;
+      pos = next;
+    }
+    next = (next + 1) & table->mask;
+  }
+}
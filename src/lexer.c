@@ -23,12 +23,17 @@
 #include <stdio.h>
 #include <malloc.h>
 #include <errno.h>
+#include <string.h>
+#include <limits.h>
 
 #include "include/lexer.h"
 #include "include/utils.h"
 #include "include/logging.h"
+#include "include/profile.h"
 
 #define NB_STATES       6
+#define DIAGNOSTICS_STEP  10
+#define PARAM_MIN_CAPACITY  64
 
 /**
  * Type defitions section
@@ -115,9 +120,21 @@ struct _lexer {
     _state_t current_state;
     _state_t *states;
     char *param_name;
-    int param_name_size;
+    int param_name_len;
+    int param_name_capacity;
     char *param_value;
-    int param_value_size;
+    int param_value_len;
+    int param_value_capacity;
+    int recover;
+    int timing;
+    int result;
+    lexer_property_handler_t *handler;
+    void *handler_ctx;
+    int nb_diagnostics;
+    int diagnostics_capacity;
+    lexer_diagnostic_t *diagnostics;
+    _memctx_t mem;
+    properties_stats_t stats;
 };
 
 /**
@@ -125,6 +142,15 @@ struct _lexer {
  * Process functions implementations
  */
 
+/**
+ * Reads the clock for the timing statistics, only when they are enabled.
+ * @param lexer the lexer
+ * @return the time in nanoseconds, 0 when the timing is disabled
+ */
+static long long lexer_clock(lexer_t *lexer) {
+  return lexer->timing ? time_ns() : 0;
+}
+
 /**
  * Dummy function. Called on links that do nothing.
  * @param tok
@@ -135,6 +161,54 @@ static int process_nothing(_token_t *token, lexer_t *lexer) {
   return FUNC_SUCCESS;
 }
 
+/**
+ * Appends a string to one of the lexer's buffers, keeping it NUL terminated.
+ * The buffers are kept from one parameter to the next, the properties holder storing its own copy.
+ * @param str the string
+ * @param len the length of the string
+ * @param p_buffer the buffer
+ * @param p_len the length of the string in the buffer
+ * @param p_capacity the capacity of the buffer
+ * @param lexer the lexer
+ * @return 0 if succeeded, -1 otherwise
+ */
+static int append_string(char *str, int len, char **p_buffer, int *p_len, int *p_capacity, lexer_t *lexer) {
+  int new_len = *p_len + len;
+  int capacity = *p_capacity;
+  char *buffer;
+
+  if(new_len + NULL_CHAR_OFFSET > capacity) {
+    capacity = capacity < PARAM_MIN_CAPACITY ? PARAM_MIN_CAPACITY : capacity;
+    while(new_len + NULL_CHAR_OFFSET > capacity) {
+      capacity *= 2;
+    }
+    buffer = mem_realloc(&(lexer->mem), *p_buffer, capacity);
+    if(buffer == NULL) {
+      return FUNC_FAILURE;
+    }
+    *p_buffer = buffer;
+    *p_capacity = capacity;
+  }
+
+  memcpy(*p_buffer + *p_len, str, len);
+  (*p_buffer)[new_len] = '\0';
+  *p_len = new_len;
+  return FUNC_SUCCESS;
+}
+
+/**
+ * Appends the value of a token to one of the lexer's buffers.
+ * @param tok the token
+ * @param p_buffer the buffer
+ * @param p_len the length of the string in the buffer
+ * @param p_capacity the capacity of the buffer
+ * @param lexer the lexer
+ * @return 0 if succeeded, -1 otherwise
+ */
+static int append_token(_token_t *tok, char **p_buffer, int *p_len, int *p_capacity, lexer_t *lexer) {
+  return append_string(tok->value, tok->size - NULL_CHAR_OFFSET, p_buffer, p_len, p_capacity, lexer);
+}
+
 /**
  * Copies current token value (the token is a param name) into the lexer's current param name field.
  * @param tok the token
@@ -142,7 +216,7 @@ static int process_nothing(_token_t *token, lexer_t *lexer) {
  * @return 0 if succeeded, -1 otherwise
  */
 static int process_param_name(_token_t *tok, lexer_t *lexer) {
-  return copy_or_append_token(&(lexer->param_name), &(lexer->param_name_size), tok);
+  return append_token(tok, &(lexer->param_name), &(lexer->param_name_len), &(lexer->param_name_capacity), lexer);
 }
 
 /**
@@ -152,7 +226,32 @@ static int process_param_name(_token_t *tok, lexer_t *lexer) {
  * @return 0 if succeeded, -1 otherwise
  */
 static int process_param_value(_token_t *tok, lexer_t *lexer) {
-  return copy_or_append_token(&(lexer->param_value), &(lexer->param_value_size), tok);
+  return append_token(tok, &(lexer->param_value), &(lexer->param_value_len), &(lexer->param_value_capacity), lexer);
+}
+
+/**
+ * Gives a parameter to the handler of the lexer, or adds it to the lexer's properties holder.
+ * @param key the name of the parameter, NUL terminated if given to the handler
+ * @param key_len the length of the name
+ * @param value the value of the parameter, NUL terminated if given to the handler
+ * @param value_len the length of the value
+ * @param lexer the lexer
+ * @return 0 if succedded, -1 otherwise
+ */
+static int save_property(char *key, int key_len, char *value, int value_len, lexer_t *lexer) {
+  int phase, ret;
+  long long start;
+
+  phase = PROFILE_ENTER(PROFILE_INSERT);
+  start = lexer_clock(lexer);
+  if(lexer->handler != NULL) {
+    ret = lexer->handler(key, key_len, value_len == 0 ? "" : value, value_len, lexer->handler_ctx);
+  } else {
+    ret = properties_property_put_string(key, key_len, value, value_len, lexer->properties);
+  }
+  lexer->stats.insertion_ns += lexer_clock(lexer) - start;
+  PROFILE_LEAVE(phase);
+  return ret == FUNC_SUCCESS ? FUNC_SUCCESS : FUNC_FAILURE;
 }
 
 /**
@@ -162,21 +261,74 @@ static int process_param_value(_token_t *tok, lexer_t *lexer) {
  * @return 0 if succedded, -1 otherwise
  */
 static int process_save(_token_t *token, lexer_t *lexer) {
-  property_t * prop;
-
-  prop = properties_property_new(lexer->param_name, lexer->param_value, free);
-  if(prop == NULL) {
+  if(save_property(lexer->param_name, lexer->param_name_len, lexer->param_value, lexer->param_value_len,
+                   lexer) != FUNC_SUCCESS) {
     return FUNC_FAILURE;
   }
 
-  properties_property_add(prop, lexer->properties);
-  lexer->param_name = NULL;
-  lexer->param_name_size = 0;
-  lexer->param_value = NULL;
-  lexer->param_value_size = 0;
+  lexer->param_name_len = 0;
+  lexer->param_value_len = 0;
   return FUNC_SUCCESS;
 }
 
+/**
+ * Writes a printable excerpt of a token, truncated to the size of the target string.
+ * @param str the target string
+ * @param size the size of the target string
+ * @param tok the token
+ */
+static void describe_token(char *str, size_t size, _token_t *tok) {
+  switch(tok->type) {
+    case TOK_EOF: snprintf(str, size, "[end of file]"); break;
+    case TOK_NEWLINE: snprintf(str, size, "[newline]"); break;
+    case TOK_NULL: snprintf(str, size, "[nothing]"); break;
+    default: snprintf(str, size, "'%s'", tok->value); break;
+  }
+}
+
+/**
+ * Gives the reason of an error from the current state and the unexpected token.
+ * @param tok the unexpected token
+ * @param lexer the lexer
+ * @return the message
+ */
+static char *error_message(_token_t *tok, lexer_t *lexer) {
+  int end_of_line = (tok->type & (TOK_NEWLINE | TOK_EOF)) != 0;
+
+  switch(lexer->current_state.state_type) {
+    case STATE_START: return "expected a parameter name";
+    case STATE_PARAM_NAME: return end_of_line ? "parameter name without assignment" : "unauthorized character in parameter name";
+    case STATE_ASSIGN: return "parameter without value";
+    case STATE_PARAM_VALUE: return "unauthorized character in parameter value";
+    default: return "unexpected token";
+  }
+}
+
+/**
+ * Records a diagnostic for an unexpected token.
+ * @param tok the unexpected token
+ * @param lexer the lexer
+ * @return the diagnostic if succeeded, NULL otherwise
+ */
+static lexer_diagnostic_t *add_diagnostic(_token_t *tok, lexer_t *lexer) {
+  lexer_diagnostic_t *diagnostic;
+
+  if(mem_manage_size(&(lexer->mem), (void **) &(lexer->diagnostics), lexer->nb_diagnostics, &(lexer->diagnostics_capacity),
+                 DIAGNOSTICS_STEP, sizeof(*(lexer->diagnostics))) != FUNC_SUCCESS) {
+    return NULL;
+  }
+
+  diagnostic = &(lexer->diagnostics[lexer->nb_diagnostics]);
+  diagnostic->filename = lexer->scanner->filename;
+  diagnostic->line = lexer->scanner->previous_line;
+  diagnostic->column = lexer->scanner->previous_col;
+  describe_token(diagnostic->token, sizeof(diagnostic->token), tok);
+  diagnostic->message = error_message(tok, lexer);
+  lexer->nb_diagnostics++;
+
+  return diagnostic;
+}
+
 /**
  * Called when an unexpected token is met.
  * @param tok
@@ -184,18 +336,17 @@ static int process_save(_token_t *token, lexer_t *lexer) {
  * @return -1 (error)
  */
 static int process_error(_token_t *tok, lexer_t *lexer) {
-  char str[30];
-  int ret;
-
-  ret = token_print(str, *tok);
-  if(ret < 0) {
-    log_error("error printing unexpected token: %s", str);
-  } else {
-    ret = FUNC_FAILURE;
-    log_error("Unexpected %s in %s:%d,%d", str, lexer->scanner->filename, lexer->scanner->previous_line, lexer->scanner->previous_col);
+  lexer_diagnostic_t *diagnostic;
+
+  diagnostic = add_diagnostic(tok, lexer);
+  if(diagnostic == NULL) {
+    log_error("error recording unexpected token");
+  } else if(!lexer->recover) {
+    log_error("Unexpected %s in %s:%d,%d (%s)", diagnostic->token, diagnostic->filename, diagnostic->line,
+              diagnostic->column, diagnostic->message);
   }
 
-  return ret;
+  return FUNC_FAILURE;
 }
 
 static int check_token(_token_t *tok, _state_condition flags) {
@@ -231,18 +382,18 @@ static int process(_token_t *tok, lexer_t *lexer) {
  * States init and destroy functions
  */
 
-static void states_free_all(_state_t *all_states, int nb_states) {
+static void states_free_all(_memctx_t *mem, _state_t *all_states, int nb_states) {
   int i = 0 ;
   for(i = 0; i < nb_states; i++) {
-    free(all_states[i].actionlinks);
+    mem_free(mem, all_states[i].actionlinks);
   }
-  free(all_states);
+  mem_free(mem, all_states);
 }
 
-static int state_new(int state_idx, int nb_next_states, _state_t *all_states) {
+static int state_new(_memctx_t *mem, int state_idx, int nb_next_states, _state_t *all_states) {
   _state_t *cur_state;
   cur_state = &(all_states[state_idx]);
-  cur_state->actionlinks = malloc(nb_next_states * sizeof(_actionlink_t));
+  cur_state->actionlinks = mem_malloc(mem, nb_next_states * sizeof(_actionlink_t));
 
   if(cur_state->actionlinks == NULL) {
     return errno;
@@ -277,15 +428,16 @@ static void add_actionlink(int state_idx, _state_condition condition, int next_s
  * Create each state, then links them together with actionlinks.
  * Typical path is :
  * Start -> process param name -> process param value -> save and go to start or end.
+ * @param mem the memory context
  * @param p_all_states the array of states
  * @return the start state
  */
-static _state_t *states_new(_state_t **p_all_states) {
+static _state_t *states_new(_memctx_t *mem, _state_t **p_all_states) {
   _state_t *cur_state;
   _state_t *deref_all_states;
   int i = 0;
 
-  *p_all_states = malloc(NB_STATES * sizeof(_state_t));
+  *p_all_states = mem_malloc(mem, NB_STATES * sizeof(_state_t));
   if(*p_all_states == NULL) {
     goto error;
   }
@@ -302,7 +454,7 @@ static _state_t *states_new(_state_t **p_all_states) {
   /* populating states with arrays of actionlinks */
 
   /* Start state */
-  if(state_new(STATE_START, 4, deref_all_states) != 0) {
+  if(state_new(mem, STATE_START, 4, deref_all_states) != 0) {
     goto dealloc_states;
   }
   add_actionlink(STATE_START, START_TO_START, STATE_START, process_nothing, deref_all_states);
@@ -311,7 +463,7 @@ static _state_t *states_new(_state_t **p_all_states) {
   add_actionlink(STATE_START, START_TO_ERR, STATE_ERR, process_error, deref_all_states);
 
   /* Parameter Name state */
-  if(state_new(STATE_PARAM_NAME, 3, deref_all_states) != 0) {
+  if(state_new(mem, STATE_PARAM_NAME, 3, deref_all_states) != 0) {
     goto dealloc_states;
   }
   add_actionlink(STATE_PARAM_NAME, PNAME_TO_PNAME, STATE_PARAM_NAME, process_param_name, deref_all_states);
@@ -319,7 +471,7 @@ static _state_t *states_new(_state_t **p_all_states) {
   add_actionlink(STATE_PARAM_NAME, PNAME_TO_ERR, STATE_ERR, process_error, deref_all_states);
 
   /* Assign state */
-  if(state_new(STATE_ASSIGN, 3, deref_all_states) != 0) {
+  if(state_new(mem, STATE_ASSIGN, 3, deref_all_states) != 0) {
     goto dealloc_states;
   }
   add_actionlink(STATE_ASSIGN, ASSIGN_TO_ASSIGN, STATE_ASSIGN, process_nothing, deref_all_states);
@@ -327,7 +479,7 @@ static _state_t *states_new(_state_t **p_all_states) {
   add_actionlink(STATE_ASSIGN, ASSIGN_TO_ERR, STATE_ERR, process_error, deref_all_states);
 
   /* Parameter Value state */
-  if(state_new(STATE_PARAM_VALUE, 4, deref_all_states) != 0) {
+  if(state_new(mem, STATE_PARAM_VALUE, 4, deref_all_states) != 0) {
     goto dealloc_states;
   }
   add_actionlink(STATE_PARAM_VALUE, PVALUE_TO_PVALUE, STATE_PARAM_VALUE, process_param_value, deref_all_states);
@@ -338,7 +490,7 @@ static _state_t *states_new(_state_t **p_all_states) {
   return &(deref_all_states[STATE_START]);
 
 dealloc_states:
-  states_free_all(deref_all_states, NB_STATES);
+  states_free_all(mem, deref_all_states, NB_STATES);
   *p_all_states = NULL;
 
 error:
@@ -346,15 +498,128 @@ error:
   return NULL;
 }
 
+/**
+ * Updates the statistics of the lexer with a token.
+ * @param tok the token
+ * @param lexer the lexer
+ */
+static void count_token(_token_t *tok, lexer_t *lexer) {
+  int idx = 0;
+
+  while(idx < PROPERTIES_STATS_TOKEN_TYPES - 1 && (1 << idx) != (int) tok->type) {
+    idx++;
+  }
+  lexer->stats.tokens[idx]++;
+
+  switch(tok->type) {
+    case TOK_NEWLINE:
+      lexer->stats.lines++;
+      break;
+    case TOK_ESCAPED_CHAR:
+      if(tok->value[0] == '\r' || tok->value[0] == '\n') {
+        lexer->stats.continuation_lines++;
+        lexer->stats.lines++;
+      } else {
+        lexer->stats.escapes_decoded++;
+      }
+      break;
+    case TOK_UNICODE_CHAR:
+      lexer->stats.escapes_decoded++;
+      break;
+    default:
+      break;
+  }
+}
+
+/**
+ * Drops the parameter being built and skips the rest of the logical line
+ * (escaped newlines are part of the line), so the analysis can restart on the next one.
+ * @param tok the unexpected token
+ * @param lexer the lexer
+ * @return 0 if succeeded, -1 otherwise
+ */
+static int resync(_token_t *tok, lexer_t *lexer) {
+  _token_type type = tok->type;
+  _token_t *skipped;
+
+  lexer->param_name_len = 0;
+  lexer->param_value_len = 0;
+
+  while(type != TOK_NEWLINE && type != TOK_EOF) {
+    skipped = scanner_scan(lexer->scanner);
+    if(skipped == NULL) {
+      log_error("resync: token is NULL");
+      return FUNC_FAILURE;
+    }
+    type = skipped->type;
+    count_token(skipped, lexer);
+    token_free_mem(&(lexer->mem), skipped);
+  }
+
+  lexer->current_state = lexer->states[type == TOK_EOF ? STATE_END : STATE_START];
+  return FUNC_SUCCESS;
+}
+
+/**
+ * Reads the simple lines following the start of a line at once, without tokens,
+ * until a line needs the state machine : escapes, continuations, errors, or a line across two blocks,
+ * or until the limit of the current step is read.
+ * The handler gets its parameter NUL terminated, from the lexer's buffers.
+ * @param limit the position in the file where the step stops
+ * @param lexer the lexer
+ * @return 0 if succeeded, -1 otherwise
+ */
+static int process_simple_lines(long limit, lexer_t *lexer) {
+  _scanner_line_type type;
+  _token_t newline;
+  char *key, *value;
+  int key_len, value_len, ret = FUNC_SUCCESS;
+
+  /* each line is counted as its terminator */
+  newline.type = TOK_NEWLINE;
+
+  while(ret == FUNC_SUCCESS && scanner_bytes_read(lexer->scanner) < limit
+        && (type = scanner_scan_simple_line(lexer->scanner, &key, &key_len, &value, &value_len)) != SCANNER_NO_LINE) {
+    count_token(&newline, lexer);
+    lexer->stats.simple_lines++;
+    if(type != SCANNER_PAIR_LINE) {
+      continue;
+    }
+    if(lexer->handler != NULL) {
+      lexer->param_name_len = 0;
+      lexer->param_value_len = 0;
+      if(append_string(key, key_len, &(lexer->param_name), &(lexer->param_name_len), &(lexer->param_name_capacity),
+                       lexer) != FUNC_SUCCESS
+         || append_string(value, value_len, &(lexer->param_value), &(lexer->param_value_len),
+                          &(lexer->param_value_capacity), lexer) != FUNC_SUCCESS) {
+        return FUNC_FAILURE;
+      }
+      key = lexer->param_name;
+      value = lexer->param_value;
+    }
+    ret = save_property(key, key_len, value, value_len, lexer);
+    lexer->param_name_len = 0;
+    lexer->param_value_len = 0;
+  }
+  return ret;
+}
+
 /**
  * Public section
  */
 
 lexer_t * lexer_new(char *filename, properties_t *properties) {
+  if(properties == NULL) {
+    log_error("lexer_new: properties is NULL");
+    return NULL;
+  }
+  return lexer_new_with_allocator(filename, properties, properties->mem.allocator);
+}
+
+lexer_t * lexer_new_with_allocator(char *filename, properties_t *properties, properties_allocator_t *allocator) {
   lexer_t *lexer;
   _state_t *cur_state;
-  _state_t * all_states;
-  _scanner_t * scanner;
+  _memctx_t mem;
 
   if(properties == NULL) {
     log_error("lexer_new: properties is NULL");
@@ -366,63 +631,159 @@ lexer_t * lexer_new(char *filename, properties_t *properties) {
     log_error("lexer_new: empty filename");
     return NULL;
   }
+
+  mem_init(&mem, allocator);
+  lexer = mem_malloc(&mem, sizeof(*lexer));
+  if(lexer == NULL) {
+    log_error("lexer_new");
+    return NULL;
+  }
+  lexer->mem = mem;
+  memset(&(lexer->stats), 0, sizeof(lexer->stats));
   
-  cur_state = states_new(&all_states);
+  cur_state = states_new(&(lexer->mem), &(lexer->states));
   if(cur_state == NULL) {
-    goto dealloc_states;
+    goto dealloc_lexer;
   }
   
-  scanner = scanner_new(filename);
-  if(scanner == NULL) {
+  lexer->scanner = scanner_new(filename, &(lexer->mem));
+  if(lexer->scanner == NULL) {
     goto dealloc_states;
   }
 
-  lexer = malloc(sizeof(*lexer));
-  lexer->states = all_states;
   lexer->current_state = *cur_state;
-  lexer->scanner = scanner;
   lexer->properties = properties;
   lexer->param_name = NULL;
-  lexer->param_name_size = 0;
+  lexer->param_name_len = 0;
+  lexer->param_name_capacity = 0;
   lexer->param_value = NULL;
-  lexer->param_value_size = 0;
+  lexer->param_value_len = 0;
+  lexer->param_value_capacity = 0;
+  lexer->recover = 0;
+  lexer->timing = 0;
+  lexer->result = 1;
+  lexer->handler = NULL;
+  lexer->handler_ctx = NULL;
+  lexer->nb_diagnostics = 0;
+  lexer->diagnostics_capacity = 0;
+  lexer->diagnostics = NULL;
   return lexer;
 
 dealloc_states:
-  states_free_all(all_states, NB_STATES);
+  states_free_all(&(lexer->mem), lexer->states, NB_STATES);
+
+dealloc_lexer:
+  mem_free(&mem, lexer);
 
   return NULL;
 }
 
 void lexer_free(lexer_t *lexer) {
-  lexer->properties = NULL;
+  _memctx_t mem = lexer->mem;
+
   scanner_free(lexer->scanner);
 
-  if(lexer->param_name_size > 0) {
-    free(lexer->param_name);
-  }
-  if(lexer->param_value_size > 0) {
-    free(lexer->param_value);
-  }
+  mem_free(&mem, lexer->param_name);
+  mem_free(&mem, lexer->param_value);
+  lexer->properties = NULL;
+
+  mem_free(&mem, lexer->diagnostics);
+  states_free_all(&mem, lexer->states, NB_STATES);
+  mem_free(&mem, lexer);
+}
 
-  states_free_all(lexer->states, NB_STATES);
-  free(lexer);
+void lexer_set_recovery(lexer_t *lexer, int recover) {
+  lexer->recover = recover;
+}
+
+void lexer_set_timing(lexer_t *lexer, int enabled) {
+  lexer->timing = enabled != 0;
+}
+
+void lexer_set_property_handler(lexer_t *lexer, lexer_property_handler_t *handler, void *ctx) {
+  lexer->handler = handler;
+  lexer->handler_ctx = ctx;
+}
+
+int lexer_get_diagnostics(lexer_t *lexer, lexer_diagnostic_t **p_diagnostics) {
+  *p_diagnostics = lexer->diagnostics;
+  return lexer->nb_diagnostics;
 }
 
 int lexer_analyze(lexer_t *lexer) {
-  int process_status;
+  return lexer_analyze_step(lexer, 0);
+}
+
+int lexer_analyze_step(lexer_t *lexer, long max_bytes) {
+  int process_status, phase;
   _token_t *token;
-  
+  long long start, scanned;
+  long limit;
+  properties_stats_t stats;
+  _memctx_t props_mem = lexer->properties->mem;
+
+  /* an analysis already over is not counted twice */
+  if(lexer->result != 1) {
+    return lexer->result;
+  }
+  limit = max_bytes > 0 ? scanner_bytes_read(lexer->scanner) + max_bytes : LONG_MAX;
+  start = lexer_clock(lexer);
   do {
+    if(lexer->current_state.state_type == STATE_START) {
+      phase = PROFILE_ENTER(PROFILE_LEX);
+      process_status = process_simple_lines(limit, lexer);
+      PROFILE_LEAVE(phase);
+      scanned = lexer_clock(lexer);
+      lexer->stats.lexer_ns += scanned - start;
+      start = scanned;
+      if(process_status != FUNC_SUCCESS) {
+        log_error("lexer_analyze: simple line not saved");
+        break;
+      }
+    }
+    phase = PROFILE_ENTER(PROFILE_SCAN);
     token = scanner_scan(lexer->scanner);
+    PROFILE_LEAVE(phase);
+    scanned = lexer_clock(lexer);
+    lexer->stats.scanner_ns += scanned - start;
     if(token != NULL) {
+      count_token(token, lexer);
+      phase = PROFILE_ENTER(PROFILE_LEX);
       process_status = process(token, lexer);
-      token_free(token);
+      PROFILE_LEAVE(phase);
+      if(lexer->recover && lexer->current_state.state_type == STATE_ERR) {
+        process_status = resync(token, lexer);
+      }
+      token_free_mem(&(lexer->mem), token);
     } else {
       process_status = FUNC_FAILURE;
       log_error("lexer_analyze: token is NULL");
     }
-  } while(process_status == FUNC_SUCCESS && lexer->current_state.state_type != STATE_END);
+    start = lexer_clock(lexer);
+    lexer->stats.lexer_ns += start - scanned;
+  } while(process_status == FUNC_SUCCESS && lexer->current_state.state_type != STATE_END
+          && scanner_bytes_read(lexer->scanner) < limit);
+
+  lexer->stats.nb_malloc += lexer->properties->mem.nb_malloc - props_mem.nb_malloc;
+  lexer->stats.nb_realloc += lexer->properties->mem.nb_realloc - props_mem.nb_realloc;
+  if(process_status == FUNC_SUCCESS && lexer->current_state.state_type != STATE_END) {
+    return 1;
+  }
+
+  /* insertion is timed apart, inside the lexing time */
+  lexer->stats.lexer_ns -= lexer->stats.insertion_ns;
+  lexer->stats.loads = 1;
+  lexer->stats.bytes_read = scanner_bytes_read(lexer->scanner);
+  lexer->stats.peak_builder_size = lexer->scanner->peak_builder_size;
+  lexer_get_stats(lexer, &stats);
+  properties_stats_add(&(lexer->properties->stats), &stats);
 
-  return process_status;
-}
\ No newline at end of file
+  lexer->result = lexer->nb_diagnostics > 0 ? FUNC_FAILURE : process_status;
+  return lexer->result;
+}
+
+void lexer_get_stats(lexer_t *lexer, properties_stats_t *stats) {
+  *stats = lexer->stats;
+  stats->nb_malloc += lexer->mem.nb_malloc;
+  stats->nb_realloc += lexer->mem.nb_realloc;
+}
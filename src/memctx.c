@@ -0,0 +1,104 @@
+/*
+ * Filename:  memctx.c
+ *
+ * Description:  Contains the allocation functions of the memory context.
+ *
+ * Copyright (c) 2017 Erwann Miriel, erwann.miriel@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+
+#include "include/memctx.h"
+#include "include/utils.h"
+#include "include/logging.h"
+
+static void *std_alloc(size_t size, void *ctx) {
+  (void) ctx;
+  return malloc(size);
+}
+
+static void *std_realloc(void *ptr, size_t size, void *ctx) {
+  (void) ctx;
+  return realloc(ptr, size);
+}
+
+static void std_free(void *ptr, void *ctx) {
+  (void) ctx;
+  free(ptr);
+}
+
+static properties_allocator_t std_allocator = {std_alloc, std_realloc, std_free, NULL};
+
+static properties_allocator_t *default_allocator = &std_allocator;
+
+void properties_allocator_set_default(properties_allocator_t *allocator) {
+  default_allocator = allocator == NULL ? &std_allocator : allocator;
+}
+
+properties_allocator_t *properties_allocator_get_default() {
+  return default_allocator;
+}
+
+void mem_init(_memctx_t *mem, properties_allocator_t *allocator) {
+  mem->allocator = allocator == NULL ? default_allocator : allocator;
+  mem->nb_malloc = 0;
+  mem->nb_realloc = 0;
+}
+
+void *mem_malloc(_memctx_t *mem, size_t size) {
+  if(mem == NULL) {
+    return default_allocator->alloc(size, default_allocator->ctx);
+  }
+  mem->nb_malloc++;
+  return mem->allocator->alloc(size, mem->allocator->ctx);
+}
+
+void *mem_realloc(_memctx_t *mem, void *ptr, size_t size) {
+  if(mem == NULL) {
+    return default_allocator->realloc(ptr, size, default_allocator->ctx);
+  }
+  if(ptr == NULL) {
+    mem->nb_malloc++;
+  } else {
+    mem->nb_realloc++;
+  }
+  return mem->allocator->realloc(ptr, size, mem->allocator->ctx);
+}
+
+void mem_free(_memctx_t *mem, void *ptr) {
+  properties_allocator_t *allocator = mem == NULL ? default_allocator : mem->allocator;
+
+  if(ptr != NULL) {
+    allocator->free(ptr, allocator->ctx);
+  }
+}
+
+int mem_manage_size(_memctx_t *mem, void **inflatable, int cur_size, int *p_max_size, int step, size_t ptrsize) {
+  void *new_inflatable;
+
+  if(cur_size < *p_max_size) {
+    return FUNC_SUCCESS;
+  }
+
+  new_inflatable = mem_realloc(mem, *inflatable, (*p_max_size + step) * ptrsize);
+  if(new_inflatable == NULL) {
+    log_error("inflate");
+    return FUNC_FAILURE;
+  }
+  *inflatable = new_inflatable;
+  *p_max_size += step;
+  return FUNC_SUCCESS;
+}
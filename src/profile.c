@@ -0,0 +1,295 @@
+/*
+ * Filename:  profile.c
+ *
+ * Description:  Contains the profiler.
+ * Each phase owns a group of hardware counters (perf_event_open), enabled only while the phase runs,
+ * so the kernel accumulates the counts of each phase separately.
+ *
+ * Copyright (c) 2017 Erwann Miriel, erwann.miriel@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "include/profile.h"
+#include "include/utils.h"
+#include "include/logging.h"
+
+#define NB_HW_COUNTERS      4
+#define NO_PHASE            (-1)
+#define NOT_MEASURED        (-2)
+
+/**
+ * Counters of a phase : one perf event group (the first counter opened is the leader).
+ */
+typedef struct _phase _phase_t;
+
+struct _phase {
+    int fds[NB_HW_COUNTERS];
+    int leader;
+    long long started_ns;
+};
+
+int profile_enabled = 0;
+
+static pthread_t owner;
+static int current_phase = NO_PHASE;
+static int hardware = 0;
+static _phase_t phases[PROFILE_NB_PHASES];
+static properties_phase_counters_t counters[PROFILE_NB_PHASES];
+
+static char *phase_names[PROFILE_NB_PHASES] = {"scan", "lex", "insert", "lookup"};
+
+#ifdef __linux__
+static const struct {
+    unsigned int type;
+    unsigned long long config;
+} hw_events[NB_HW_COUNTERS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)}
+};
+
+static int open_counter(int idx, int group_fd) {
+  struct perf_event_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = hw_events[idx].type;
+  attr.config = hw_events[idx].config;
+  attr.disabled = group_fd == -1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID;
+
+  return (int) syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+/**
+ * Opens the group of counters of a phase. Counters that cannot be opened are left out.
+ * @param phase the phase
+ * @return the flags of the opened counters
+ */
+static int open_phase(_phase_t *phase) {
+  int i, opened = 0;
+
+  phase->leader = -1;
+  for(i = 0; i < NB_HW_COUNTERS; i++) {
+    phase->fds[i] = open_counter(i, phase->leader);
+    if(phase->fds[i] != -1) {
+      opened |= 1 << i;
+      if(phase->leader == -1) {
+        phase->leader = phase->fds[i];
+      }
+    }
+  }
+  return opened;
+}
+
+static void switch_phase(_phase_t *phase, unsigned long request) {
+  if(phase->leader != -1) {
+    ioctl(phase->leader, request, PERF_IOC_FLAG_GROUP);
+  }
+}
+
+/**
+ * Reads the counts of a phase group into its counters.
+ * The group is read with its ids, so the counts are matched with the counters that were opened.
+ * @param phase the phase
+ * @param phase_counters the counters to fill
+ */
+static void read_phase(_phase_t *phase, properties_phase_counters_t *phase_counters) {
+  unsigned long long buf[1 + 2 * NB_HW_COUNTERS], id, values[NB_HW_COUNTERS];
+  unsigned long long i, nr;
+  int j;
+
+  memset(values, 0, sizeof(values));
+  if(phase->leader != -1 && read(phase->leader, buf, sizeof(buf)) > 0) {
+    nr = buf[0];
+    for(i = 0; i < nr && i < NB_HW_COUNTERS; i++) {
+      for(j = 0; j < NB_HW_COUNTERS; j++) {
+        if(phase->fds[j] != -1 && ioctl(phase->fds[j], PERF_EVENT_IOC_ID, &id) == 0 && id == buf[2 + 2 * i]) {
+          values[j] = buf[1 + 2 * i];
+        }
+      }
+    }
+  }
+  phase_counters->cycles = values[0];
+  phase_counters->instructions = values[1];
+  phase_counters->branch_misses = values[2];
+  phase_counters->llc_misses = values[3];
+}
+
+static void close_phase(_phase_t *phase) {
+  int i;
+  for(i = NB_HW_COUNTERS - 1; i >= 0; i--) {
+    if(phase->fds[i] != -1) {
+      close(phase->fds[i]);
+      phase->fds[i] = -1;
+    }
+  }
+  phase->leader = -1;
+}
+#else
+static int open_phase(_phase_t *phase) {
+  phase->leader = -1;
+  return 0;
+}
+
+static void read_phase(_phase_t *phase, properties_phase_counters_t *phase_counters) {
+  (void) phase;
+  (void) phase_counters;
+}
+
+static void close_phase(_phase_t *phase) {
+  phase->leader = -1;
+}
+#endif
+
+static void start_phase(int idx) {
+  phases[idx].started_ns = time_ns();
+  counters[idx].calls++;
+#ifdef __linux__
+  switch_phase(&(phases[idx]), PERF_EVENT_IOC_ENABLE);
+#endif
+}
+
+static void pause_phase(int idx) {
+#ifdef __linux__
+  switch_phase(&(phases[idx]), PERF_EVENT_IOC_DISABLE);
+#endif
+  counters[idx].wall_ns += time_ns() - phases[idx].started_ns;
+}
+
+int profile_enter(properties_profile_phase phase) {
+  int previous = current_phase;
+
+  if(!pthread_equal(owner, pthread_self())) {
+    return NOT_MEASURED;
+  }
+  if(previous != NO_PHASE) {
+    pause_phase(previous);
+  }
+  current_phase = phase;
+  start_phase(phase);
+  return previous;
+}
+
+void profile_leave(int previous) {
+  if(previous == NOT_MEASURED || current_phase == NO_PHASE) {
+    return;
+  }
+  pause_phase(current_phase);
+  current_phase = previous;
+  if(previous != NO_PHASE) {
+    /* resuming is not a new call of the phase */
+    counters[previous].calls--;
+    start_phase(previous);
+  }
+}
+
+int properties_profile_start() {
+  int i;
+
+  if(profile_enabled) {
+    log_error("properties_profile_start : profiling already started");
+    return FUNC_FAILURE;
+  }
+
+  hardware = PROFILE_HW_CYCLES | PROFILE_HW_INSTRUCTIONS | PROFILE_HW_BRANCH_MISSES | PROFILE_HW_LLC_MISSES;
+  for(i = 0; i < PROFILE_NB_PHASES; i++) {
+    hardware &= open_phase(&(phases[i]));
+  }
+  if(hardware == 0) {
+    log_info("properties_profile_start : hardware counters unavailable, using wall-clock time only");
+    for(i = 0; i < PROFILE_NB_PHASES; i++) {
+      close_phase(&(phases[i]));
+    }
+  }
+
+  properties_profile_reset();
+  owner = pthread_self();
+  current_phase = NO_PHASE;
+  profile_enabled = 1;
+  return FUNC_SUCCESS;
+}
+
+void properties_profile_stop() {
+  int i;
+
+  if(!profile_enabled) {
+    return;
+  }
+  if(current_phase != NO_PHASE) {
+    pause_phase(current_phase);
+    current_phase = NO_PHASE;
+  }
+  profile_enabled = 0;
+
+  /* keeps the hardware counts readable once the counters are closed */
+  for(i = 0; i < PROFILE_NB_PHASES; i++) {
+    if(hardware != 0) {
+      read_phase(&(phases[i]), &(counters[i]));
+    }
+    close_phase(&(phases[i]));
+  }
+}
+
+void properties_profile_reset() {
+  int i;
+
+  memset(counters, 0, sizeof(counters));
+#ifdef __linux__
+  for(i = 0; i < PROFILE_NB_PHASES; i++) {
+    if(hardware != 0 && phases[i].leader != -1) {
+      ioctl(phases[i].leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    }
+  }
+#else
+  (void) i;
+#endif
+}
+
+void properties_profile_read(properties_profile_t *profile) {
+  int i;
+
+  profile->hardware = hardware;
+  for(i = 0; i < PROFILE_NB_PHASES; i++) {
+    if(profile_enabled && hardware != 0) {
+      read_phase(&(phases[i]), &(counters[i]));
+    }
+    profile->phases[i] = counters[i];
+  }
+}
+
+char *properties_profile_phase_name(properties_profile_phase phase) {
+  if(phase < 0 || phase >= PROFILE_NB_PHASES) {
+    return "unknown";
+  }
+  return phase_names[phase];
+}
@@ -27,19 +27,139 @@
 
 #include "include/properties.h"
 #include "include/utils.h"
+#include "include/profile.h"
+#include "include/sorted.h"
+#include "include/bloom.h"
+#include "include/intern.h"
+#include "include/atom.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #define PROPERTIES_STEP 10
 
+/* under this size, the hashes are scanned instead of indexed */
+#define PROPERTIES_INDEX_MIN    16
+
+/* minimum number of keys the bloom filter is sized for */
+#define PROPERTIES_BLOOM_MIN    64
+
+/* keys hashed and prefetched ahead by properties_get_values */
+#define PROPERTIES_BATCH        16
+
+/* longest key or value stored inside the property node */
+#define PROPERTY_INLINE_MAX     24
+
+/* alignment of the nodes in the packed block */
+#define PROPERTY_ALIGN          sizeof(void *)
+#define PACKED_SIZE(size)       (((size) + PROPERTY_ALIGN - 1) & ~(PROPERTY_ALIGN - 1))
+
+/* property flags */
+#define PROPERTY_HOLDER_OWNED   1
+#define PROPERTY_INLINE_KEY     2
+#define PROPERTY_INLINE_VALUE   4
+#define PROPERTY_INTERNED_VALUE 8
+#define PROPERTY_ATOM_KEY       16
+#define PROPERTY_STRING_VALUE   32
+#define PROPERTY_PACKED         64
+
 struct _valueholder {
     void *value;
     _free_func_t *_dealloc;
 };
 
+/**
+ * A property created by properties_property_put is owned by its holder :
+ * the node and the key (and the value if it has no deallocation function) belong to the holder's allocator.
+ * Otherwise, they belong to the default allocator.
+ * A property created by properties_property_put_string keeps its short key and value in inline_data,
+ * right after the node, so that a lookup reads them on the same cache lines.
+ * When the holder interns its values, the value of such a property is a reference on the holder's interning table.
+ * When the holder stores its keys as atoms, the key of such a property is a reference on the atom table of the process.
+ * A compacted property lives in the packed block of its holder, its key and string value inline.
+ */
 struct _property {
     char *key;
     valueholder_t valueholder;
+    int flags;
+    int key_len;
+    char inline_data[];
 };
 
+/** @brief Checks the key of a slot. The hash is compared first, the key bytes only when hash and length match.
+ *
+ * @param props the properties holder
+ * @param slot the slot
+ * @param key the key
+ * @param len the length of the key
+ * @param hash the hash of the key
+ * @return 1 if the key matches, 0 otherwise
+ */
+static int slot_matches(properties_t *props, int slot, char *key, int len, unsigned int hash) {
+  return props->hashes[slot] == hash && props->key_lens[slot] == len && memcmp(props->keys[slot], key, len) == 0;
+}
+
+/** @brief Scans the hashes for a key, four at a time when SSE2 is available.
+ *
+ * @return the slot of the key if found, -1 otherwise
+ */
+static int scan_hashes(properties_t *props, char *key, int len, unsigned int hash) {
+  int i = 0;
+#ifdef __SSE2__
+  __m128i needle = _mm_set1_epi32((int) hash);
+  int mask;
+
+  for(; i + 4 <= props->size; i += 4) {
+    mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(needle, _mm_loadu_si128((__m128i *) &(props->hashes[i])))));
+    while(mask != 0) {
+      if(slot_matches(props, i + __builtin_ctz(mask), key, len, hash)) {
+        return i + __builtin_ctz(mask);
+      }
+      mask &= mask - 1;
+    }
+  }
+#endif
+  for(; i < props->size; i++) {
+    if(slot_matches(props, i, key, len, hash)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/** @brief Probes the index for a key.
+ *
+ * @return the slot of the key if found, -1 otherwise
+ */
+static int probe_index(properties_t *props, char *key, int len, unsigned int hash) {
+  unsigned int pos = hash & props->index_mask;
+  int slot;
+
+  while((slot = props->index[pos]) != 0) {
+    if(slot_matches(props, slot - 1, key, len, hash)) {
+      return slot - 1;
+    }
+    pos = (pos + 1) & props->index_mask;
+  }
+  return -1;
+}
+
+/** @brief Finds a property by its hashed name in a properties holder.
+ *
+ * @param props the properties holder
+ * @param key the name of the property to find
+ * @param len the length of the name
+ * @param hash the hash of the name
+ * @return Index of Property if found, -1 (minus one) otherwise
+ */
+static int properties_find_hashed(properties_t *props, char *key, int len, unsigned int hash) {
+  if(props->index != NULL) {
+    return probe_index(props, key, len, hash);
+  }
+  return scan_hashes(props, key, len, hash);
+}
+
 /** @brief Finds a property by its name in a properties holder.
  *
  * @param propertiesholder the properties container
@@ -48,62 +168,285 @@ struct _property {
  *
  */
 static int properties_find_property(char *key, properties_t *props) {
+  int len;
+  unsigned int hash;
+
+  hash = hash_string(key, &len);
+  return properties_find_hashed(props, key, len, hash);
+}
+
+static void index_insert(properties_t *props, int slot) {
+  unsigned int pos = props->hashes[slot] & props->index_mask;
+
+  while(props->index[pos] != 0) {
+    pos = (pos + 1) & props->index_mask;
+  }
+  props->index[pos] = slot + 1;
+}
+
+/** @brief (Re)builds the index, with at least twice as many entries as properties.
+ *
+ * @param props the properties holder
+ * @return 0 if succeeded, -1 otherwise
+ */
+static int index_build(properties_t *props) {
+  unsigned int capacity = 2 * PROPERTIES_INDEX_MIN;
   int i;
-  for (i = 0; i < props->size; i++) {
-    if (strcmp(key, props->contents[i]->key) == 0) {
-      return i;
+
+  while(capacity < 2 * (unsigned int) props->size) {
+    capacity *= 2;
+  }
+  if(props->index == NULL || capacity != props->index_mask + 1) {
+    mem_free(&(props->mem), props->index);
+    props->index = mem_malloc(&(props->mem), capacity * sizeof(*(props->index)));
+    if(props->index == NULL) {
+      props->index_mask = 0;
+      return FUNC_FAILURE;
     }
+    props->index_mask = capacity - 1;
   }
-  return -1;
+
+  memset(props->index, 0, capacity * sizeof(*(props->index)));
+  for(i = 0; i < props->size; i++) {
+    index_insert(props, i);
+  }
+  return FUNC_SUCCESS;
+}
+
+/** @brief (Re)builds the bloom filter, sized for a number of keys.
+ *
+ * @param props the properties holder
+ * @param fp_rate the false positive rate
+ * @param capacity the number of keys
+ * @return 0 if succeeded, -1 otherwise
+ */
+static int bloom_build(properties_t *props, double fp_rate, int capacity) {
+  _bloom_t *bloom;
+  int i;
+
+  if(capacity < PROPERTIES_BLOOM_MIN) {
+    capacity = PROPERTIES_BLOOM_MIN;
+  }
+  bloom = bloom_new(&(props->mem), capacity, fp_rate);
+  if(bloom == NULL) {
+    return FUNC_FAILURE;
+  }
+  for(i = 0; i < props->size; i++) {
+    bloom_add(bloom, props->hashes[i]);
+  }
+  if(props->bloom != NULL) {
+    bloom_free(&(props->mem), props->bloom);
+  }
+  props->bloom = bloom;
+  return FUNC_SUCCESS;
+}
+
+/* state of the generator drawing the sampled lookups of the thread, seeded on its first draw */
+static __thread unsigned int access_draw;
+
+/** @brief Counts a lookup if it is drawn : one lookup in the sampling period adds the period to the count of its slot.
+ * The draws come from a xorshift generator of the calling thread, so that periodic lookups are not always missed.
+ *
+ * @param props the properties holder
+ * @param slot the slot found, -1 if none
+ */
+static void count_access(properties_t *props, int slot) {
+  unsigned int x;
+
+  if(props->access_counts == NULL || slot == -1) {
+    return;
+  }
+  x = access_draw;
+  if(x == 0) {
+    x = (unsigned int) (size_t) &access_draw | 1;
+  }
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  access_draw = x;
+  if((x & (props->access_period - 1)) == 0) {
+    __atomic_fetch_add(&(props->access_counts[slot]), props->access_period, __ATOMIC_RELAXED);
+  }
+}
+
+static int grow_array(_memctx_t *mem, void **p_array, int capacity, size_t elem_size) {
+  void *array = mem_realloc(mem, *p_array, capacity * elem_size);
+  if(array == NULL) {
+    return FUNC_FAILURE;
+  }
+  *p_array = array;
+  return FUNC_SUCCESS;
+}
+
+/** @brief Moves the arrays of a compacted holder out of its packed block, to arrays of a larger capacity.
+ *
+ * @param props the properties holder
+ * @param capacity the new capacity
+ * @return 0 if succeeded, -1 otherwise
+ */
+static int properties_unpack_arrays(properties_t *props, int capacity) {
+  _memctx_t *mem = &(props->mem);
+  property_t **contents = mem_malloc(mem, capacity * sizeof(*contents));
+  unsigned int *hashes = mem_malloc(mem, capacity * sizeof(*hashes));
+  int *key_lens = mem_malloc(mem, capacity * sizeof(*key_lens));
+  char **keys = mem_malloc(mem, capacity * sizeof(*keys));
+  void **values = mem_malloc(mem, capacity * sizeof(*values));
+
+  if(contents == NULL || hashes == NULL || key_lens == NULL || keys == NULL || values == NULL) {
+    mem_free(mem, contents);
+    mem_free(mem, hashes);
+    mem_free(mem, key_lens);
+    mem_free(mem, keys);
+    mem_free(mem, values);
+    log_error("properties_grow");
+    return FUNC_FAILURE;
+  }
+  memcpy(contents, props->contents, props->size * sizeof(*contents));
+  memcpy(hashes, props->hashes, props->size * sizeof(*hashes));
+  memcpy(key_lens, props->key_lens, props->size * sizeof(*key_lens));
+  memcpy(keys, props->keys, props->size * sizeof(*keys));
+  memcpy(values, props->values, props->size * sizeof(*values));
+  props->contents = contents;
+  props->hashes = hashes;
+  props->key_lens = key_lens;
+  props->keys = keys;
+  props->values = values;
+  props->capacity = capacity;
+  props->packed_arrays = 0;
+  return FUNC_SUCCESS;
+}
+
+/** @brief Doubles the capacity of all the arrays of a properties holder.
+ *
+ * @param props the properties holder
+ * @return 0 if succeeded, -1 otherwise
+ */
+static int properties_grow(properties_t *props) {
+  int capacity = props->capacity * 2;
+  _memctx_t *mem = &(props->mem);
+
+  if(props->access_counts != NULL
+     && grow_array(mem, (void **) &(props->access_counts), capacity, sizeof(*(props->access_counts))) != FUNC_SUCCESS) {
+    log_error("properties_grow");
+    return FUNC_FAILURE;
+  }
+  if(props->packed_arrays) {
+    return properties_unpack_arrays(props, capacity);
+  }
+  if(grow_array(mem, (void **) &(props->contents), capacity, sizeof(*(props->contents))) != FUNC_SUCCESS
+     || grow_array(mem, (void **) &(props->hashes), capacity, sizeof(*(props->hashes))) != FUNC_SUCCESS
+     || grow_array(mem, (void **) &(props->key_lens), capacity, sizeof(*(props->key_lens))) != FUNC_SUCCESS
+     || grow_array(mem, (void **) &(props->keys), capacity, sizeof(*(props->keys))) != FUNC_SUCCESS
+     || grow_array(mem, (void **) &(props->values), capacity, sizeof(*(props->values))) != FUNC_SUCCESS) {
+    log_error("properties_grow");
+    return FUNC_FAILURE;
+  }
+  props->capacity = capacity;
+  return FUNC_SUCCESS;
 }
 
 /** @brief Frees property from memory.
  *
  * @param property_t the property to free
+ * @param props the properties holder of the property
  *
  */
-static int properties_free_property(property_t *property) {
+static int properties_free_property(property_t *property, properties_t *props) {
+  _memctx_t *mem;
+
   if(check_null(1, property) != FUNC_SUCCESS) {
     log_error("properties_free : property_t is NULL");
     return FUNC_FAILURE;
   }
 
-  free(property->key);
-  property->valueholder._dealloc(property->valueholder.value);
-  free(property);
+  mem = (property->flags & PROPERTY_HOLDER_OWNED) ? &(props->mem) : NULL;
+  if(property->flags & PROPERTY_ATOM_KEY) {
+    properties_atom_release(property->key);
+  } else if(!(property->flags & PROPERTY_INLINE_KEY)) {
+    mem_free(mem, property->key);
+  }
+  if(property->valueholder._dealloc != NULL) {
+    property->valueholder._dealloc(property->valueholder.value);
+  } else if(property->flags & PROPERTY_INTERNED_VALUE) {
+    intern_release(props->values_table, property->valueholder.value);
+  } else if(!(property->flags & PROPERTY_INLINE_VALUE)) {
+    mem_free(mem, property->valueholder.value);
+  }
+  if(!(property->flags & PROPERTY_PACKED)) {
+    mem_free(mem, property);
+  }
 
   return FUNC_SUCCESS;
 }
 
 properties_t *properties_new() {
+  return properties_new_with_allocator(NULL);
+}
+
+properties_t *properties_new_with_allocator(properties_allocator_t *allocator) {
   properties_t *props;
-  props = malloc(sizeof(*props));
+  _memctx_t mem;
+
+  mem_init(&mem, allocator);
+  props = mem_malloc(&mem, sizeof(*props));
   if(props == NULL) {
     perror("properties_new: contents");
     goto exit_error;
   }
-  props->contents = malloc(PROPERTIES_STEP * sizeof(*(props->contents)));
-  if(props->contents == NULL) {
+  props->mem = mem;
+  props->capacity = PROPERTIES_STEP / 2;
+  props->size = 0;
+  props->contents = NULL;
+  props->hashes = NULL;
+  props->key_lens = NULL;
+  props->keys = NULL;
+  props->values = NULL;
+  props->index = NULL;
+  props->index_mask = 0;
+  props->sorted = NULL;
+  props->bloom = NULL;
+  props->generation = 0;
+  props->values_table = NULL;
+  props->intern_values = 0;
+  props->atom_keys = 0;
+  props->packed = NULL;
+  props->packed_size = 0;
+  props->packed_arrays = 0;
+  props->access_counts = NULL;
+  props->access_period = 0;
+  if(properties_grow(props) != FUNC_SUCCESS) {
     perror("properties_new: properties");
     goto free_props;
   }
-  props->capacity = PROPERTIES_STEP;
-  props->size = 0;
+  memset(&(props->stats), 0, sizeof(props->stats));
 
   return props;
 
 free_props:
-  free(props);
+  mem_free(&mem, props->contents);
+  mem_free(&mem, props->hashes);
+  mem_free(&mem, props->key_lens);
+  mem_free(&mem, props->keys);
+  mem_free(&mem, props->values);
+  mem_free(&mem, props);
 exit_error:
   return NULL;
 }
 
-property_t * properties_property_new(char *key, void *value, _free_func_t *dealloc) {
-  if(check_null(3, key, value, dealloc) != FUNC_SUCCESS) {
+/** @brief Creates a new property, allocated through a memory context.
+ *
+ * @param mem the memory context
+ * @param key the name of the property
+ * @param value the value of the property
+ * @param dealloc the deallocation function of the value
+ * @return the pointer of the created property if succeeded, NULL otherwise
+ */
+static property_t *property_new(_memctx_t *mem, char *key, void *value, _free_func_t *dealloc) {
+  if(check_null(2, key, value) != FUNC_SUCCESS) {
     log_error("properties_property_new : key or value is NULL");
   }
 
-  property_t * property = malloc(sizeof(*property));
+  property_t * property = mem_malloc(mem, sizeof(*property));
 
   if (property == NULL) {
     log_error("properties_property_new : allocation failed");
@@ -113,9 +456,126 @@ property_t * properties_property_new(char *key, void *value, _free_func_t *deall
   property->key = key;
   property->valueholder.value = value;
   property->valueholder._dealloc = dealloc;
+  property->flags = mem == NULL ? 0 : PROPERTY_HOLDER_OWNED;
+  property->key_len = (int) strlen(key);
   return property;
 }
 
+/** @brief Stores a copy of a string inline, at the cursor, or in a new allocation if it is too long.
+ *
+ * @param mem the memory context
+ * @param p_cursor the inline cursor, moved after the copy
+ * @param str the string
+ * @param len the length of the string
+ * @return the copy if succeeded, NULL otherwise
+ */
+static char *property_copy_string(_memctx_t *mem, char **p_cursor, char *str, int len) {
+  char *copy;
+
+  if(len <= PROPERTY_INLINE_MAX) {
+    copy = *p_cursor;
+    *p_cursor += len + NULL_CHAR_OFFSET;
+  } else {
+    copy = mem_malloc(mem, len + NULL_CHAR_OFFSET);
+    if(copy == NULL) {
+      return NULL;
+    }
+  }
+  memcpy(copy, str, len);
+  copy[len] = '\0';
+  return copy;
+}
+
+property_t * properties_property_new(char *key, void *value, _free_func_t *dealloc) {
+  return property_new(NULL, key, value, dealloc);
+}
+
+int properties_property_put(char *key, void *value, _free_func_t *dealloc, properties_t *properties) {
+  property_t *property;
+
+  property = property_new(&(properties->mem), key, value, dealloc);
+  if(property == NULL) {
+    return FUNC_FAILURE;
+  }
+  if(properties_property_add(property, properties) != FUNC_SUCCESS) {
+    mem_free(&(properties->mem), property);
+    return FUNC_FAILURE;
+  }
+  return FUNC_SUCCESS;
+}
+
+int properties_property_put_string(char *key, int key_len, char *value, int value_len, properties_t *properties) {
+  property_t *property;
+  size_t inline_size = 0;
+  char *cursor;
+
+  if(key_len <= PROPERTY_INLINE_MAX && !properties->atom_keys) {
+    inline_size += key_len + NULL_CHAR_OFFSET;
+  }
+  if(value_len <= PROPERTY_INLINE_MAX && !properties->intern_values) {
+    inline_size += value_len + NULL_CHAR_OFFSET;
+  }
+
+  property = mem_malloc(&(properties->mem), sizeof(*property) + inline_size);
+  if(property == NULL) {
+    log_error("properties_property_put_string : allocation failed");
+    return FUNC_FAILURE;
+  }
+
+  cursor = property->inline_data;
+  property->flags = PROPERTY_HOLDER_OWNED | PROPERTY_STRING_VALUE;
+  if(properties->atom_keys) {
+    property->flags |= PROPERTY_ATOM_KEY;
+  } else if(key_len <= PROPERTY_INLINE_MAX) {
+    property->flags |= PROPERTY_INLINE_KEY;
+  }
+  if(properties->intern_values) {
+    property->flags |= PROPERTY_INTERNED_VALUE;
+  } else if(value_len <= PROPERTY_INLINE_MAX) {
+    property->flags |= PROPERTY_INLINE_VALUE;
+  }
+  property->key_len = key_len;
+  property->valueholder._dealloc = NULL;
+  if(properties->atom_keys) {
+    property->key = properties_atom_acquire(key, key_len);
+  } else {
+    property->key = property_copy_string(&(properties->mem), &cursor, key, key_len);
+  }
+  if(properties->intern_values) {
+    property->valueholder.value = intern_acquire(properties->values_table, value, value_len,
+                                                 hash_bytes(value, value_len));
+  } else {
+    property->valueholder.value = property_copy_string(&(properties->mem), &cursor, value, value_len);
+  }
+  if(property->key == NULL || property->valueholder.value == NULL) {
+    goto dealloc_property;
+  }
+
+  if(properties_property_add(property, properties) != FUNC_SUCCESS) {
+    properties_free_property(property, properties);
+    return FUNC_FAILURE;
+  }
+  return FUNC_SUCCESS;
+
+dealloc_property:
+  if(property->flags & PROPERTY_ATOM_KEY) {
+    if(property->key != NULL) {
+      properties_atom_release(property->key);
+    }
+  } else if(!(property->flags & PROPERTY_INLINE_KEY)) {
+    mem_free(&(properties->mem), property->key);
+  }
+  if(property->valueholder.value != NULL) {
+    if(property->flags & PROPERTY_INTERNED_VALUE) {
+      intern_release(properties->values_table, property->valueholder.value);
+    } else if(!(property->flags & PROPERTY_INLINE_VALUE)) {
+      mem_free(&(properties->mem), property->valueholder.value);
+    }
+  }
+  mem_free(&(properties->mem), property);
+  return FUNC_FAILURE;
+}
+
 int properties_property_free(char *key, properties_t *properties) {
   int idx, max;
   property_t *a_property;
@@ -124,6 +584,10 @@ int properties_property_free(char *key, properties_t *properties) {
     log_error("properties_property_free : structure or key is null");
     return FUNC_FAILURE;
   }
+  if(properties->sorted != NULL) {
+    log_error("properties_property_free : properties are frozen");
+    return FUNC_FAILURE;
+  }
 
   idx = properties_find_property(key, properties);
   if (idx == -1) {
@@ -131,7 +595,7 @@ int properties_property_free(char *key, properties_t *properties) {
   }
 
   a_property = properties->contents[idx];
-  if(properties_free_property(a_property) != 0) {
+  if(properties_free_property(a_property, properties) != 0) {
     return FUNC_FAILURE;
   }
 
@@ -139,35 +603,162 @@ int properties_property_free(char *key, properties_t *properties) {
 
   for (int i = idx; i < max; i++) {
     properties->contents[i] = properties->contents[i + 1];
+    properties->hashes[i] = properties->hashes[i + 1];
+    properties->key_lens[i] = properties->key_lens[i + 1];
+    properties->keys[i] = properties->keys[i + 1];
+    properties->values[i] = properties->values[i + 1];
+  }
+  if(properties->access_counts != NULL) {
+    memmove(&(properties->access_counts[idx]), &(properties->access_counts[idx + 1]),
+            (max - idx) * sizeof(*(properties->access_counts)));
   }
 
   properties->contents[max] = NULL;
   properties->size--;
+  properties->generation++;
+
+  /* the slots after the removed one have moved */
+  if(properties->index != NULL && index_build(properties) != FUNC_SUCCESS) {
+    return FUNC_FAILURE;
+  }
+  /* a bloom filter cannot forget a key */
+  if(properties->bloom != NULL
+     && bloom_build(properties, properties->bloom->fp_rate, properties->bloom->capacity) != FUNC_SUCCESS) {
+    return FUNC_FAILURE;
+  }
 
   return idx;
 }
 
 void properties_free(properties_t *props) {
   int i;
+  _memctx_t mem = props->mem;
+
   for (i = 0; i < props->size; i++) {
-    properties_free_property(props->contents[i]);
+    properties_free_property(props->contents[i], props);
+  }
+  if(!props->packed_arrays) {
+    mem_free(&mem, props->contents);
+    mem_free(&mem, props->hashes);
+    mem_free(&mem, props->key_lens);
+    mem_free(&mem, props->keys);
+    mem_free(&mem, props->values);
+  }
+  mem_free(&mem, props->packed);
+  mem_free(&mem, props->index);
+  mem_free(&mem, props->access_counts);
+  properties_unfreeze(props);
+  if(props->bloom != NULL) {
+    bloom_free(&mem, props->bloom);
+  }
+  if(props->values_table != NULL) {
+    intern_free(props->values_table);
+  }
+  mem_free(&mem, props);
+}
+
+/** @brief Replaces the key of a property by its atom. The replaced key is kept until the property is added
+ * (see property_release_key), so that a failed addition can give it back.
+ *
+ * @param property the property
+ * @return 0 if succeeded, -1 otherwise
+ */
+static int property_atomize_key(property_t *property) {
+  char *atom;
+
+  atom = properties_atom_acquire(property->key, property->key_len);
+  if(atom == NULL) {
+    log_error("properties_property_add : key not stored as an atom");
+    return FUNC_FAILURE;
+  }
+  property->key = atom;
+  property->flags = (property->flags & ~PROPERTY_INLINE_KEY) | PROPERTY_ATOM_KEY;
+  return FUNC_SUCCESS;
+}
+
+/** @brief Frees a key replaced by its atom, as the property would have.
+ *
+ * @param property the property
+ * @param key the replaced key
+ * @param flags the flags of the property before the replacement
+ * @param props the properties holder
+ */
+static void property_release_key(property_t *property, char *key, int flags, properties_t *props) {
+  if(key != property->key && !(flags & PROPERTY_INLINE_KEY)) {
+    mem_free((flags & PROPERTY_HOLDER_OWNED) ? &(props->mem) : NULL, key);
   }
-  free(props->contents);
-  free(props);
 }
 
 int properties_property_add(property_t *prop, properties_t *props) {
-  int max;
+  int max, flags;
+  char *key;
 
   if(props == NULL || prop == NULL) {
     log_error("properties_property_add : structure or element is NULL");
     return FUNC_FAILURE;
   }
+  if(props->sorted != NULL) {
+    log_error("properties_property_add : properties are frozen");
+    return FUNC_FAILURE;
+  }
+
+  key = prop->key;
+  flags = prop->flags;
+  if(props->atom_keys && !(prop->flags & PROPERTY_ATOM_KEY) && property_atomize_key(prop) != FUNC_SUCCESS) {
+    return FUNC_FAILURE;
+  }
+  if(props->size == props->capacity && properties_grow(props) != FUNC_SUCCESS) {
+    goto restore_key;
+  }
 
   max = props->size;
   props->size++;
   props->contents[max] = prop;
-  return manage_size((void **) props->contents, props->size, &(props->capacity), PROPERTIES_STEP, sizeof(*(props->contents)));
+  props->hashes[max] = (prop->flags & PROPERTY_ATOM_KEY) ? properties_atom_hash(prop->key)
+                                                         : hash_bytes(prop->key, prop->key_len);
+  props->key_lens[max] = prop->key_len;
+  props->keys[max] = prop->key;
+  props->values[max] = prop->valueholder.value;
+  if(props->access_counts != NULL) {
+    props->access_counts[max] = 0;
+  }
+  props->generation++;
+
+  if(props->bloom != NULL) {
+    if(props->bloom->count < props->bloom->capacity) {
+      bloom_add(props->bloom, props->hashes[max]);
+    } else if(bloom_build(props, props->bloom->fp_rate, 2 * props->size) != FUNC_SUCCESS) {
+      goto rollback;
+    }
+  }
+
+  if(props->size >= PROPERTIES_INDEX_MIN) {
+    if(props->index == NULL || 2 * (unsigned int) props->size > props->index_mask + 1) {
+      if(index_build(props) != FUNC_SUCCESS) {
+        goto rollback;
+      }
+    } else {
+      index_insert(props, max);
+    }
+  }
+  property_release_key(prop, key, flags, props);
+  return FUNC_SUCCESS;
+
+  /* a failed index leaves the lookups to the scan, and a hash left in the bloom filter is only a false positive */
+rollback:
+  props->size--;
+  props->contents[max] = NULL;
+  props->keys[max] = NULL;
+  props->values[max] = NULL;
+  props->generation--;
+  log_error("properties_property_add : allocation failed");
+restore_key:
+  if(key != prop->key) {
+    properties_atom_release(prop->key);
+    prop->key = key;
+    prop->flags = flags;
+  }
+  return FUNC_FAILURE;
 }
 
 int properties_get_keys(char ***p_keys, properties_t *props) {
@@ -181,16 +772,640 @@ int properties_get_keys(char ***p_keys, properties_t *props) {
   }
 
   for (i = 0; i < props->size; i++) {
-    deref_keys[i] = props->contents[i]->key;
+    deref_keys[i] = props->keys[i];
   }
 
   return i;
 }
 
 void *properties_get_value(char *key, properties_t *props) {
-  int i = properties_find_property(key, props);
+  int i, len, phase;
+  unsigned int hash;
+
+  phase = PROFILE_ENTER(PROFILE_LOOKUP);
+  if(props->bloom != NULL) {
+    hash = hash_string(key, &len);
+    if(!bloom_may_contain(props->bloom, hash)) {
+      i = -1;
+    } else if(props->sorted != NULL) {
+      i = sorted_index_find(props->sorted, key);
+    } else {
+      i = properties_find_hashed(props, key, len, hash);
+    }
+  } else if(props->sorted != NULL) {
+    i = sorted_index_find(props->sorted, key);
+  } else {
+    i = properties_find_property(key, props);
+  }
+  PROFILE_LEAVE(phase);
   if (i != -1) {
-    return props->contents[i]->valueholder.value;
+    count_access(props, i);
+    return props->values[i];
   }
   return NULL;
-}
\ No newline at end of file
+}
+
+void *properties_get_value_len(const char *key, int key_len, properties_t *props) {
+  int i, phase;
+  unsigned int hash = hash_bytes(key, key_len);
+
+  phase = PROFILE_ENTER(PROFILE_LOOKUP);
+  if(props->bloom != NULL && !bloom_may_contain(props->bloom, hash)) {
+    i = -1;
+  } else {
+    i = properties_find_hashed(props, (char *) key, key_len, hash);
+  }
+  PROFILE_LEAVE(phase);
+  count_access(props, i);
+  return i == -1 ? NULL : props->values[i];
+}
+
+/** @brief Finds a property by the atom of its key : the keys of a holder of atoms are compared by pointer.
+ *
+ * @return the slot of the key if found, -1 otherwise
+ */
+static int properties_find_atom(properties_t *props, char *atom) {
+  unsigned int hash = properties_atom_hash(atom), pos;
+  int i, slot;
+
+  if(!props->atom_keys) {
+    return properties_find_hashed(props, atom, properties_atom_len(atom), hash);
+  }
+  if(props->bloom != NULL && !bloom_may_contain(props->bloom, hash)) {
+    return -1;
+  }
+  if(props->index != NULL) {
+    for(pos = hash & props->index_mask; (slot = props->index[pos]) != 0; pos = (pos + 1) & props->index_mask) {
+      if(props->keys[slot - 1] == atom) {
+        return slot - 1;
+      }
+    }
+    return -1;
+  }
+  for(i = 0; i < props->size; i++) {
+    if(props->keys[i] == atom) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void *properties_get_by_atom(char *atom, properties_t *props) {
+  int i, phase;
+
+  phase = PROFILE_ENTER(PROFILE_LOOKUP);
+  i = properties_find_atom(props, atom);
+  PROFILE_LEAVE(phase);
+  count_access(props, i);
+  return i == -1 ? NULL : props->values[i];
+}
+
+int properties_set_bloom_filter(properties_t *props, double fp_rate) {
+  if(fp_rate <= 0) {
+    if(props->bloom != NULL) {
+      bloom_free(&(props->mem), props->bloom);
+      props->bloom = NULL;
+    }
+    return FUNC_SUCCESS;
+  }
+  if(fp_rate >= 1) {
+    log_error("properties_set_bloom_filter : false positive rate must be lower than 1");
+    return FUNC_FAILURE;
+  }
+  return bloom_build(props, fp_rate, 2 * props->size);
+}
+
+int properties_set_key_atoms(properties_t *props, int enabled) {
+  if(props->size != 0) {
+    log_error("properties_set_key_atoms : properties are not empty");
+    return FUNC_FAILURE;
+  }
+  props->atom_keys = enabled != 0;
+  return FUNC_SUCCESS;
+}
+
+int properties_set_value_interning(properties_t *props, int enabled) {
+  if(enabled && props->values_table == NULL) {
+    props->values_table = intern_new(&(props->mem));
+    if(props->values_table == NULL) {
+      return FUNC_FAILURE;
+    }
+  }
+  props->intern_values = enabled != 0;
+  return FUNC_SUCCESS;
+}
+
+int properties_freeze(properties_t *props) {
+  if(props->sorted != NULL) {
+    return FUNC_SUCCESS;
+  }
+  props->sorted = sorted_index_new(&(props->mem), props->keys, props->key_lens, props->size);
+  return props->sorted == NULL ? FUNC_FAILURE : FUNC_SUCCESS;
+}
+
+void properties_unfreeze(properties_t *props) {
+  if(props->sorted != NULL) {
+    sorted_index_free(&(props->mem), props->sorted);
+    props->sorted = NULL;
+  }
+}
+
+int properties_lower_bound(char *key, properties_t *props) {
+  if(props->sorted == NULL) {
+    log_error("properties_lower_bound : properties are not frozen");
+    return FUNC_FAILURE;
+  }
+  return sorted_index_lower_bound(props->sorted, key);
+}
+
+char *properties_sorted_key(int rank, properties_t *props) {
+  if(props->sorted == NULL || rank < 0 || rank >= props->size) {
+    return NULL;
+  }
+  return props->keys[props->sorted->sorted[rank]];
+}
+
+void *properties_sorted_value(int rank, properties_t *props) {
+  if(props->sorted == NULL || rank < 0 || rank >= props->size) {
+    return NULL;
+  }
+  return props->values[props->sorted->sorted[rank]];
+}
+
+static void handle_resolve(properties_handle_t *handle, properties_t *props) {
+  handle->slot = properties_find_hashed(props, handle->key, handle->key_len, handle->hash);
+  handle->generation = props->generation;
+}
+
+properties_handle_t properties_resolve(char *key, properties_t *props) {
+  properties_handle_t handle;
+
+  handle.key = key;
+  handle.hash = hash_string(key, &(handle.key_len));
+  handle_resolve(&handle, props);
+  return handle;
+}
+
+void *properties_get_by_handle(properties_handle_t *handle, properties_t *props) {
+  if(handle->generation != props->generation) {
+    handle_resolve(handle, props);
+  }
+  count_access(props, handle->slot);
+  return handle->slot == -1 ? NULL : props->values[handle->slot];
+}
+
+/** @brief Resolves a batch of keys in stages, each stage prefetching what the next one reads :
+ * the searched keys are prefetched, then hashed and their index entries (or filter blocks) prefetched, then the slots found in the index
+ * are prefetched, then the keys of these slots, and only then are the keys compared.
+ *
+ * @return the number of properties found
+ */
+static int get_batch(char **keys, int nb_keys, void **values, properties_t *props) {
+  unsigned int hashes[PROPERTIES_BATCH];
+  int lens[PROPERTIES_BATCH], slots[PROPERTIES_BATCH], i, slot, nb_found = 0;
+
+  for(i = 0; i < nb_keys; i++) {
+    PREFETCH(keys[i]);
+  }
+  for(i = 0; i < nb_keys; i++) {
+    hashes[i] = hash_string(keys[i], &(lens[i]));
+    if(props->bloom != NULL) {
+      bloom_prefetch(props->bloom, hashes[i]);
+    }
+    if(props->index != NULL) {
+      PREFETCH(&(props->index[hashes[i] & props->index_mask]));
+    }
+  }
+
+  if(props->index != NULL && props->sorted == NULL) {
+    for(i = 0; i < nb_keys; i++) {
+      slots[i] = props->index[hashes[i] & props->index_mask] - 1;
+      if(slots[i] >= 0) {
+        PREFETCH(&(props->hashes[slots[i]]));
+        PREFETCH(&(props->keys[slots[i]]));
+        PREFETCH(&(props->values[slots[i]]));
+      }
+    }
+    for(i = 0; i < nb_keys; i++) {
+      if(slots[i] >= 0) {
+        PREFETCH(props->keys[slots[i]]);
+      }
+    }
+  }
+
+  for(i = 0; i < nb_keys; i++) {
+    if(props->bloom != NULL && !bloom_may_contain(props->bloom, hashes[i])) {
+      slot = -1;
+    } else if(props->sorted != NULL) {
+      slot = sorted_index_find(props->sorted, keys[i]);
+    } else {
+      slot = properties_find_hashed(props, keys[i], lens[i], hashes[i]);
+    }
+    values[i] = slot == -1 ? NULL : props->values[slot];
+    nb_found += slot != -1;
+  }
+  return nb_found;
+}
+
+int properties_get_values(char **keys, int nb_keys, void **values, properties_t *props) {
+  int i, phase, nb_found = 0;
+
+  phase = PROFILE_ENTER(PROFILE_LOOKUP);
+  for(i = 0; i < nb_keys; i += PROPERTIES_BATCH) {
+    nb_found += get_batch(keys + i, nb_keys - i < PROPERTIES_BATCH ? nb_keys - i : PROPERTIES_BATCH, values + i, props);
+  }
+  PROFILE_LEAVE(phase);
+  return nb_found;
+}
+
+void properties_iter_begin(properties_iter_t *iter, properties_t *props) {
+  iter->slot = 0;
+  iter->generation = props->generation;
+}
+
+int properties_iter_next(properties_iter_t *iter, char **p_key, int *p_key_len, void **p_value, properties_t *props) {
+  if(iter->generation != props->generation) {
+    log_error("properties_iter_next : properties modified during the iteration");
+    return FUNC_FAILURE;
+  }
+  if(iter->slot >= props->size) {
+    return 0;
+  }
+  if(p_key != NULL) {
+    *p_key = props->keys[iter->slot];
+  }
+  if(p_key_len != NULL) {
+    *p_key_len = props->key_lens[iter->slot];
+  }
+  if(p_value != NULL) {
+    *p_value = props->values[iter->slot];
+  }
+  iter->slot++;
+  return 1;
+}
+
+int properties_find_slot(char *key, int key_len, unsigned int hash, properties_t *props) {
+  return properties_find_hashed(props, key, key_len, hash);
+}
+
+int properties_property_is_string(property_t *property) {
+  return (property->flags & PROPERTY_STRING_VALUE) != 0;
+}
+
+/* bytes of a slot in the parallel arrays */
+#define PROPERTIES_ROW  (sizeof(property_t *) + sizeof(unsigned int) + sizeof(int) + sizeof(char *) + sizeof(void *))
+
+/** @brief Tells whether the value of a property is a string stored by its node or apart, and not interned.
+ */
+static int property_owns_string(property_t *property) {
+  return (property->flags & (PROPERTY_STRING_VALUE | PROPERTY_INTERNED_VALUE)) == PROPERTY_STRING_VALUE;
+}
+
+/** @brief Gets the size of a property once packed : the node, followed by its key (unless it is an atom)
+ * and by its string value.
+ *
+ * @param property the property
+ * @return the size, without padding
+ */
+static size_t property_packed_size(property_t *property) {
+  size_t size = sizeof(*property);
+
+  if(!(property->flags & PROPERTY_ATOM_KEY)) {
+    size += property->key_len + NULL_CHAR_OFFSET;
+  }
+  if(property_owns_string(property)) {
+    size += strlen(property->valueholder.value) + NULL_CHAR_OFFSET;
+  }
+  return size;
+}
+
+void properties_memory_usage(properties_t *props, properties_memory_t *report) {
+  property_t *property;
+  size_t packed_used = 0;
+  int i;
+
+  memset(report, 0, sizeof(*report));
+  report->index = sizeof(*props) + props->size * PROPERTIES_ROW;
+  report->slack = (props->capacity - props->size) * PROPERTIES_ROW;
+  if(props->access_counts != NULL) {
+    report->index += props->size * sizeof(*(props->access_counts));
+    report->slack += (props->capacity - props->size) * sizeof(*(props->access_counts));
+  }
+  if(props->index != NULL) {
+    report->index += (props->index_mask + 1) * sizeof(*(props->index));
+  }
+  if(props->sorted != NULL) {
+    report->index += sorted_index_memory(props->sorted);
+  }
+  if(props->bloom != NULL) {
+    report->index += bloom_memory(props->bloom);
+  }
+  if(props->values_table != NULL) {
+    report->values += intern_memory(props->values_table);
+  }
+
+  for(i = 0; i < props->size; i++) {
+    property = props->contents[i];
+    report->nodes += sizeof(*property);
+    if(!(property->flags & PROPERTY_ATOM_KEY)) {
+      report->keys += property->key_len + NULL_CHAR_OFFSET;
+    }
+    if(property_owns_string(property)) {
+      report->values += strlen(property->valueholder.value) + NULL_CHAR_OFFSET;
+    }
+    if(property->flags & PROPERTY_PACKED) {
+      packed_used += property_packed_size(property);
+    }
+  }
+  if(props->packed != NULL) {
+    if(props->packed_arrays) {
+      packed_used += props->capacity * PROPERTIES_ROW;
+    }
+    report->slack += props->packed_size - packed_used;
+  }
+  report->total = report->index + report->nodes + report->keys + report->values + report->slack;
+}
+
+/** @brief Copies a property into the packed block, its key and string value inline, and frees what it no longer uses.
+ *
+ * @param property the property
+ * @param cursor where to copy the property
+ * @param props the properties holder
+ * @return the copy
+ */
+static property_t *property_pack(property_t *property, char *cursor, properties_t *props) {
+  _memctx_t *mem = (property->flags & PROPERTY_HOLDER_OWNED) ? &(props->mem) : NULL;
+  property_t *packed = (property_t *) cursor;
+  char *data = packed->inline_data;
+  int len;
+
+  *packed = *property;
+  packed->flags |= PROPERTY_PACKED;
+  if(!(property->flags & PROPERTY_ATOM_KEY)) {
+    memcpy(data, property->key, property->key_len + NULL_CHAR_OFFSET);
+    packed->key = data;
+    packed->flags |= PROPERTY_INLINE_KEY;
+    data += property->key_len + NULL_CHAR_OFFSET;
+    if(!(property->flags & PROPERTY_INLINE_KEY)) {
+      mem_free(mem, property->key);
+    }
+  }
+  if(property_owns_string(property)) {
+    len = (int) strlen(property->valueholder.value);
+    memcpy(data, property->valueholder.value, len + NULL_CHAR_OFFSET);
+    packed->valueholder.value = data;
+    packed->flags |= PROPERTY_INLINE_VALUE;
+    if(!(property->flags & PROPERTY_INLINE_VALUE)) {
+      mem_free(mem, property->valueholder.value);
+    }
+  }
+  if(!(property->flags & PROPERTY_PACKED)) {
+    mem_free(mem, property);
+  }
+  return packed;
+}
+
+int properties_compact(properties_t *props) {
+  size_t arrays_size, block_size;
+  char *block, *cursor;
+  property_t **contents;
+  unsigned int *hashes;
+  int *key_lens;
+  char **keys;
+  void **values;
+  int i;
+
+  if(props->size == 0) {
+    return FUNC_SUCCESS;
+  }
+
+  arrays_size = PACKED_SIZE(props->size * PROPERTIES_ROW);
+  block_size = arrays_size;
+  for(i = 0; i < props->size; i++) {
+    block_size += PACKED_SIZE(property_packed_size(props->contents[i]));
+  }
+  block = mem_malloc(&(props->mem), block_size);
+  if(block == NULL || (props->access_counts != NULL
+                       && grow_array(&(props->mem), (void **) &(props->access_counts), props->size,
+                                     sizeof(*(props->access_counts))) != FUNC_SUCCESS)) {
+    mem_free(&(props->mem), block);
+    log_error("properties_compact");
+    return FUNC_FAILURE;
+  }
+
+  /* the arrays by decreasing alignment, then the nodes */
+  contents = (property_t **) block;
+  keys = (char **) (contents + props->size);
+  values = (void **) (keys + props->size);
+  hashes = (unsigned int *) (values + props->size);
+  key_lens = (int *) (hashes + props->size);
+  cursor = block + arrays_size;
+  for(i = 0; i < props->size; i++) {
+    contents[i] = property_pack(props->contents[i], cursor, props);
+    cursor += PACKED_SIZE(property_packed_size(contents[i]));
+    keys[i] = contents[i]->key;
+    values[i] = contents[i]->valueholder.value;
+    hashes[i] = props->hashes[i];
+    key_lens[i] = props->key_lens[i];
+  }
+
+  if(!props->packed_arrays) {
+    mem_free(&(props->mem), props->contents);
+    mem_free(&(props->mem), props->hashes);
+    mem_free(&(props->mem), props->key_lens);
+    mem_free(&(props->mem), props->keys);
+    mem_free(&(props->mem), props->values);
+  }
+  mem_free(&(props->mem), props->packed);
+  props->contents = contents;
+  props->hashes = hashes;
+  props->key_lens = key_lens;
+  props->keys = keys;
+  props->values = values;
+  props->capacity = props->size;
+  props->packed = block;
+  props->packed_size = block_size;
+  props->packed_arrays = 1;
+  props->generation++;
+
+  if(props->index != NULL && index_build(props) != FUNC_SUCCESS) {
+    return FUNC_FAILURE;
+  }
+  if(props->bloom != NULL && bloom_build(props, props->bloom->fp_rate, props->size) != FUNC_SUCCESS) {
+    return FUNC_FAILURE;
+  }
+  return FUNC_SUCCESS;
+}
+
+/* a slot and its count, to rank the slots */
+typedef struct {
+    unsigned int count;
+    int slot;
+} _access_rank_t;
+
+static int compare_ranks(const void *a, const void *b) {
+  const _access_rank_t *rank_a = a, *rank_b = b;
+
+  if(rank_a->count != rank_b->count) {
+    return rank_a->count > rank_b->count ? -1 : 1;
+  }
+  return rank_a->slot - rank_b->slot;
+}
+
+/** @brief Ranks the slots by decreasing count, the slots of equal counts keeping their order.
+ *
+ * @param props the properties holder
+ * @return the ranks, to be freed with the allocator of the holder, NULL if failed
+ */
+static _access_rank_t *rank_accesses(properties_t *props) {
+  _access_rank_t *ranks;
+  int i;
+
+  ranks = mem_malloc(&(props->mem), props->size * sizeof(*ranks));
+  if(ranks == NULL) {
+    return NULL;
+  }
+  for(i = 0; i < props->size; i++) {
+    ranks[i].count = __atomic_load_n(&(props->access_counts[i]), __ATOMIC_RELAXED);
+    ranks[i].slot = i;
+  }
+  qsort(ranks, props->size, sizeof(*ranks), compare_ranks);
+  return ranks;
+}
+
+/** @brief Reorders one of the parallel arrays by rank.
+ *
+ * @param array the array
+ * @param elem_size the size of its elements
+ * @param ranks the ranks of the slots
+ * @param size the number of slots
+ * @param buffer room for size elements
+ */
+static void reorder_array(void *array, size_t elem_size, _access_rank_t *ranks, int size, char *buffer) {
+  int i;
+
+  for(i = 0; i < size; i++) {
+    memcpy(buffer + i * elem_size, (char *) array + ranks[i].slot * elem_size, elem_size);
+  }
+  memcpy(array, buffer, size * elem_size);
+}
+
+int properties_set_access_sampling(properties_t *props, unsigned int period) {
+  if(period == 0) {
+    mem_free(&(props->mem), props->access_counts);
+    props->access_counts = NULL;
+    props->access_period = 0;
+    return FUNC_SUCCESS;
+  }
+  if((period & (period - 1)) != 0) {
+    log_error("properties_set_access_sampling : period must be a power of 2");
+    return FUNC_FAILURE;
+  }
+  if(props->access_counts == NULL) {
+    props->access_counts = mem_malloc(&(props->mem), props->capacity * sizeof(*(props->access_counts)));
+    if(props->access_counts == NULL) {
+      log_error("properties_set_access_sampling");
+      return FUNC_FAILURE;
+    }
+    memset(props->access_counts, 0, props->capacity * sizeof(*(props->access_counts)));
+  }
+  props->access_period = period;
+  return FUNC_SUCCESS;
+}
+
+int properties_hot_keys(properties_access_t *accesses, int nb, properties_t *props) {
+  _access_rank_t *ranks;
+  int i;
+
+  if(props->access_counts == NULL) {
+    log_error("properties_hot_keys : lookups are not counted");
+    return FUNC_FAILURE;
+  }
+  if(props->size == 0 || nb <= 0) {
+    return 0;
+  }
+  ranks = rank_accesses(props);
+  if(ranks == NULL) {
+    log_error("properties_hot_keys");
+    return FUNC_FAILURE;
+  }
+  if(nb > props->size) {
+    nb = props->size;
+  }
+  for(i = 0; i < nb; i++) {
+    accesses[i].key = props->keys[ranks[i].slot];
+    accesses[i].count = ranks[i].count;
+  }
+  mem_free(&(props->mem), ranks);
+  return nb;
+}
+
+int properties_optimize_layout(properties_t *props) {
+  _access_rank_t *ranks;
+  char *buffer;
+
+  if(props->access_counts == NULL) {
+    log_error("properties_optimize_layout : lookups are not counted");
+    return FUNC_FAILURE;
+  }
+  if(props->sorted != NULL) {
+    log_error("properties_optimize_layout : properties are frozen");
+    return FUNC_FAILURE;
+  }
+  if(props->size == 0) {
+    return FUNC_SUCCESS;
+  }
+
+  ranks = rank_accesses(props);
+  buffer = mem_malloc(&(props->mem), props->size * sizeof(void *));
+  if(ranks == NULL || buffer == NULL) {
+    mem_free(&(props->mem), ranks);
+    mem_free(&(props->mem), buffer);
+    log_error("properties_optimize_layout");
+    return FUNC_FAILURE;
+  }
+  reorder_array(props->contents, sizeof(*(props->contents)), ranks, props->size, buffer);
+  reorder_array(props->hashes, sizeof(*(props->hashes)), ranks, props->size, buffer);
+  reorder_array(props->key_lens, sizeof(*(props->key_lens)), ranks, props->size, buffer);
+  reorder_array(props->keys, sizeof(*(props->keys)), ranks, props->size, buffer);
+  reorder_array(props->values, sizeof(*(props->values)), ranks, props->size, buffer);
+  reorder_array(props->access_counts, sizeof(*(props->access_counts)), ranks, props->size, buffer);
+  mem_free(&(props->mem), buffer);
+  mem_free(&(props->mem), ranks);
+  props->generation++;
+
+  /* the nodes follow the slots, and the hot slots take their place in the index first */
+  if(props->packed != NULL) {
+    return properties_compact(props);
+  }
+  if(props->index != NULL && index_build(props) != FUNC_SUCCESS) {
+    return FUNC_FAILURE;
+  }
+  return FUNC_SUCCESS;
+}
+
+void properties_stats(properties_t *props, properties_stats_t *stats) {
+  *stats = props->stats;
+}
+
+void properties_stats_add(properties_stats_t *total, properties_stats_t *stats) {
+  int i;
+
+  total->loads += stats->loads;
+  total->bytes_read += stats->bytes_read;
+  for(i = 0; i < PROPERTIES_STATS_TOKEN_TYPES; i++) {
+    total->tokens[i] += stats->tokens[i];
+  }
+  total->lines += stats->lines;
+  total->continuation_lines += stats->continuation_lines;
+  total->escapes_decoded += stats->escapes_decoded;
+  total->simple_lines += stats->simple_lines;
+  total->nb_malloc += stats->nb_malloc;
+  total->nb_realloc += stats->nb_realloc;
+  if(stats->peak_builder_size > total->peak_builder_size) {
+    total->peak_builder_size = stats->peak_builder_size;
+  }
+  total->scanner_ns += stats->scanner_ns;
+  total->lexer_ns += stats->lexer_ns;
+  total->insertion_ns += stats->insertion_ns;
+}
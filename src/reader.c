@@ -0,0 +1,168 @@
+/*
+ * Filename:  reader.c
+ *
+ * Description:  Contains the block reader used by the scanner.
+ *
+ * Copyright (c) 2017 Erwann Miriel, erwann.miriel@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "include/reader.h"
+#include "include/utils.h"
+#include "include/logging.h"
+
+#define NEXT_BLOCK(idx)     (((idx) + 1) % READER_NB_BLOCKS)
+#define PREVIOUS_BLOCK(idx) (((idx) + READER_NB_BLOCKS - 1) % READER_NB_BLOCKS)
+
+_reader_t *reader_open(char *filename, int block_size, _memctx_t *mem) {
+  _reader_t *reader;
+  int i;
+
+  if(block_size <= 0) {
+    goto error;
+  }
+  reader = mem_malloc(mem, sizeof(*reader));
+  if(reader == NULL) {
+    goto error;
+  }
+  reader->blocks = mem_malloc(mem, (size_t) block_size * READER_NB_BLOCKS);
+  if(reader->blocks == NULL) {
+    goto dealloc_reader;
+  }
+  reader->fd = open(filename, O_RDONLY);
+  if(reader->fd == -1) {
+    goto dealloc_blocks;
+  }
+
+  reader->mem = mem;
+  reader->block_size = block_size;
+  for(i = 0; i < READER_NB_BLOCKS; i++) {
+    reader->lens[i] = 0;
+    reader->offsets[i] = -1;
+  }
+  /* an empty first block at offset 0 : the first read fills the next one */
+  reader->current = READER_NB_BLOCKS - 1;
+  reader->newest = reader->current;
+  reader->offsets[reader->current] = 0;
+  reader->pos = 0;
+  return reader;
+
+dealloc_blocks:
+  mem_free(mem, reader->blocks);
+dealloc_reader:
+  mem_free(mem, reader);
+error:
+  log_error("reader_open");
+  return NULL;
+}
+
+/**
+ * Fills the block following the newest one, overwriting the oldest block of the ring.
+ * @return 0 if succeeded, -1 at the end of the file or on a read error
+ */
+static int fill_block(_reader_t *reader) {
+  int next = NEXT_BLOCK(reader->newest);
+  ssize_t len;
+
+  do {
+    len = read(reader->fd, reader->blocks + (size_t) next * reader->block_size, reader->block_size);
+  } while(len == -1 && errno == EINTR);
+  if(len <= 0) {
+    if(len == -1) {
+      log_error("reader_getc : read error");
+    }
+    return FUNC_FAILURE;
+  }
+
+  reader->offsets[next] = reader->offsets[reader->newest] + reader->lens[reader->newest];
+  reader->lens[next] = (int) len;
+  reader->newest = next;
+  return FUNC_SUCCESS;
+}
+
+/**
+ * Moves to the next block once the current one is consumed.
+ * @return 0 if there is something left to read, -1 at the end of the file or on a read error
+ */
+static int next_block(_reader_t *reader) {
+  if(reader->pos < reader->lens[reader->current]) {
+    return FUNC_SUCCESS;
+  }
+  /* after a character given back across blocks, the next block is already filled */
+  if(reader->current == reader->newest && fill_block(reader) != FUNC_SUCCESS) {
+    return FUNC_FAILURE;
+  }
+  reader->current = NEXT_BLOCK(reader->current);
+  reader->pos = 0;
+  return FUNC_SUCCESS;
+}
+
+int reader_getc(_reader_t *reader) {
+  if(next_block(reader) != FUNC_SUCCESS) {
+    return EOF;
+  }
+  return (unsigned char) reader->blocks[(size_t) reader->current * reader->block_size + reader->pos++];
+}
+
+char *reader_peek(_reader_t *reader, int *p_len) {
+  if(next_block(reader) != FUNC_SUCCESS) {
+    *p_len = 0;
+    return NULL;
+  }
+  *p_len = reader->lens[reader->current] - reader->pos;
+  return reader->blocks + (size_t) reader->current * reader->block_size + reader->pos;
+}
+
+void reader_skip(_reader_t *reader, int len) {
+  reader->pos += len;
+}
+
+int reader_ungetc(int c, _reader_t *reader) {
+  int previous;
+
+  if(c == EOF) {
+    return EOF;
+  }
+  if(reader->pos == 0) {
+    previous = PREVIOUS_BLOCK(reader->current);
+    /* the previous block may have been overwritten, or never filled */
+    if(previous == reader->newest || reader->offsets[previous] == -1
+       || reader->offsets[previous] + reader->lens[previous] != reader->offsets[reader->current]) {
+      log_error("reader_ungetc : nothing to give back");
+      return EOF;
+    }
+    reader->current = previous;
+    reader->pos = reader->lens[previous];
+  }
+  reader->pos--;
+  return c;
+}
+
+long reader_tell(_reader_t *reader) {
+  return reader->offsets[reader->current] + reader->pos;
+}
+
+void reader_close(_reader_t *reader) {
+  _memctx_t *mem = reader->mem;
+
+  close(reader->fd);
+  mem_free(mem, reader->blocks);
+  mem_free(mem, reader);
+}
@@ -25,6 +25,7 @@
 #include <string.h>
 
 #include "include/scanner.h"
+#include "include/reader.h"
 #include "include/stringbuilder.h"
 #include "include/utils.h"
 #include "include/logging.h"
@@ -44,18 +45,18 @@ static int is_newline(char c) {
   return c == '\r' || c == '\n';
 }
 
+static int is_eof(char c) {
+  return c == EOF;
+}
+
 static int not_newline(char c) {
-  return !is_newline(c);
+  return !is_newline(c) && !is_eof(c);
 }
 
 static int is_assign(char c) {
   return c == '=' || c == ':';
 }
 
-static int is_eof(char c) {
-  return c == EOF;
-}
-
 static int is_escape(char c) {
   return c == '\\';
 }
@@ -69,7 +70,7 @@ static int is_comment(char c) {
 }
 
 static char get_char(_scanner_t * scanner) {
-  char c = (char) fgetc(scanner->file);
+  char c = (char) reader_getc(scanner->reader);
   scanner->previous_line = scanner->current_line;
   scanner->previous_col = scanner->current_col;
   if(!is_eof(c)) {
@@ -88,14 +89,14 @@ static void unget_char(char c, _scanner_t * scanner) {
   scanner->current_line = scanner->previous_line;
   scanner->current_col = scanner->previous_col;
   
-  ungetc(c, scanner->file);
+  reader_ungetc(c, scanner->reader);
 }
 
 static _token_t * scanGeneric(_scanner_t * scanner, _token_type type, int (*checker)(char)) {
   char c;
   unsigned int size = 0;
   _token_t *tok;
-  _stringbuilder_t * sb = sb_new();
+  _stringbuilder_t * sb = sb_new(scanner->mem);
   if(sb == NULL ) {
     goto error;
   }
@@ -109,8 +110,11 @@ static _token_t * scanGeneric(_scanner_t * scanner, _token_type type, int (*chec
     c = get_char(scanner);
   }
   unget_char(c, scanner);
+  if((int) size > scanner->peak_builder_size) {
+    scanner->peak_builder_size = size;
+  }
   
-  tok = token_new(size);
+  tok = token_new_mem(scanner->mem, size);
   if(tok == NULL) {
     goto free_sb_error;
   }
@@ -131,7 +135,7 @@ error:
 static _token_t * scanGenChar(_scanner_t * scanner, _token_type type) {
   _token_t *tok;
   
-  tok = token_new(1);
+  tok = token_new_mem(scanner->mem, 1);
   if(tok == NULL) {
     goto error;
   }
@@ -168,7 +172,7 @@ static _token_t * scanUnicodeChar(_scanner_t * scanner) {
   workValue[size] = '\0';
   unget_char(c, scanner);
 
-  tok = token_new(size);
+  tok = token_new_mem(scanner->mem, size);
   if(tok == NULL) {
     goto error;
   }
@@ -189,7 +193,7 @@ static _token_t * scanEscapedNewline(_scanner_t * scanner) {
   
   c = get_char(scanner);
   if(c == '\n') {
-    tok = token_new(1);
+    tok = token_new_mem(scanner->mem, 1);
     if(tok == NULL) {
       goto error;
     }
@@ -197,9 +201,9 @@ static _token_t * scanEscapedNewline(_scanner_t * scanner) {
     tok->value[0] = '\n';
     tok->value[1] = '\0';
   } else {
-    c = (char) fgetc(scanner->file);
+    c = (char) reader_getc(scanner->reader);
     if(c == '\n') {
-      tok = token_new(2);
+      tok = token_new_mem(scanner->mem, 2);
       if(tok == NULL) {
         goto error;
       }
@@ -208,9 +212,9 @@ static _token_t * scanEscapedNewline(_scanner_t * scanner) {
       tok->value[1] = '\n';
       tok->value[2] = '\0';
     } else {
-      ungetc(c, scanner->file);
+      reader_ungetc(c, scanner->reader);
       
-      tok = token_new(1);
+      tok = token_new_mem(scanner->mem, 1);
       if(tok == NULL) {
         goto error;
       }
@@ -240,7 +244,7 @@ static _token_t * scanEscapedChars(_scanner_t * scanner) {
     return scanEscapedNewline(scanner);
   }
 
-  tok = token_new(2);
+  tok = token_new_mem(scanner->mem, 2);
   if(tok == NULL) {
     return NULL;
   }
@@ -268,6 +272,10 @@ static _token_t * scanAssign(_scanner_t * scanner) {
   return scanGenChar(scanner, TOK_ASSIGN);
 }
 
+static _token_t * scanOther(_scanner_t * scanner) {
+  return scanGenChar(scanner, TOK_OTHER);
+}
+
 static _token_t * scanComment(_scanner_t * scanner) {
   return scanGeneric(scanner, TOK_COMMENT, &not_newline);
 }
@@ -298,31 +306,36 @@ _token_t * scanner_scan(_scanner_t *scanner) {
   } else if (is_comment(c)) {
     tok = scanComment(scanner);
   } else if (is_eof(c)) {
-    tok = token_new(0);
+    tok = token_new_mem(scanner->mem, 0);
     tok->value = NULL;
     tok->type = TOK_EOF;
   } else {
     unget_char(c, scanner);
+    tok = scanOther(scanner);
   }
 
   return tok;
 }
 
-_scanner_t * scanner_new(char *filename) {
+_scanner_t * scanner_new(char *filename, _memctx_t *mem) {
+  return scanner_new_blocks(filename, READER_BLOCK_SIZE, mem);
+}
+
+_scanner_t * scanner_new_blocks(char *filename, int block_size, _memctx_t *mem) {
   _scanner_t *scanner;
-  FILE *file;
+  _reader_t *reader;
 
-  file = fopen(filename, "r");
-  if(file == NULL) {
+  reader = reader_open(filename, block_size, mem);
+  if(reader == NULL) {
     goto log_error;
   }
 
-  scanner = malloc(sizeof(*scanner));
+  scanner = mem_malloc(mem, sizeof(*scanner));
   if(scanner == NULL) {
-    goto close_file;
+    goto close_reader;
   }
 
-  scanner->filename = malloc(sizeof(char) * strlen(filename) + NULL_CHAR_OFFSET);
+  scanner->filename = mem_malloc(mem, sizeof(char) * strlen(filename) + NULL_CHAR_OFFSET);
   if(scanner->filename == NULL) {
     goto dealloc_scanner;
   }
@@ -331,19 +344,21 @@ _scanner_t * scanner_new(char *filename) {
     goto dealloc_filename;
   }
 
-  scanner->file = file;
+  scanner->reader = reader;
   scanner->current_line = 1;
   scanner->current_col = 1;
+  scanner->mem = mem;
+  scanner->peak_builder_size = 0;
   return scanner;
 
   dealloc_filename:
-  free(scanner->filename);
-
-  close_file:
-  fclose(file);
+  mem_free(mem, scanner->filename);
 
   dealloc_scanner:
-  free(scanner);
+  mem_free(mem, scanner);
+
+  close_reader:
+  reader_close(reader);
 
   log_error:
   log_error("scanner_new");
@@ -351,9 +366,80 @@ _scanner_t * scanner_new(char *filename) {
   return NULL;
 }
 
-void scanner_free(_scanner_t *scanner) {
-  fclose(scanner->file);
-  free(scanner->filename);
-  free(scanner);
+/**
+ * Checks that a value can be taken as is : without escapes, nor characters the tokens would not carry as is
+ * (comment tokens drop their leading character, EOF and NUL end the scanning).
+ */
+static int is_plain_value(char *value, int len) {
+  return memchr(value, '\\', len) == NULL && memchr(value, '#', len) == NULL && memchr(value, '!', len) == NULL
+         && memchr(value, '\0', len) == NULL && memchr(value, EOF, len) == NULL;
+}
+
+_scanner_line_type scanner_scan_simple_line(_scanner_t *scanner, char **p_key, int *p_key_len, char **p_value,
+                                            int *p_value_len) {
+  char *line, *end, *cur;
+  int len, consumed;
+  _scanner_line_type type = SCANNER_PAIR_LINE;
+
+  /* only a line ending in the current block can be taken as is */
+  line = reader_peek(scanner->reader, &len);
+  if(line == NULL || (end = memchr(line, '\n', len)) == NULL) {
+    return SCANNER_NO_LINE;
+  }
+  cur = memchr(line, '\r', end - line);
+  if(cur != NULL) {
+    end = cur;
+  }
+  consumed = (int) (end - line) + 1;
+
+  cur = line;
+  while(cur < end && is_ws(*cur)) {
+    cur++;
+  }
+  if(cur == end || is_comment(*cur)) {
+    type = SCANNER_EMPTY_LINE;
+    goto consume;
+  }
+
+  *p_key = cur;
+  while(cur < end && (is_alnum(*cur) || is_ponct(*cur))) {
+    cur++;
+  }
+  *p_key_len = (int) (cur - *p_key);
+  if(*p_key_len == 0 || cur == end) {
+    return SCANNER_NO_LINE;
+  }
+  /* the name ends with an assignment character or with whitespace, then the whitespace before the value is skipped */
+  if(is_assign(*cur)) {
+    cur++;
+  } else if(!is_ws(*cur)) {
+    return SCANNER_NO_LINE;
+  }
+  while(cur < end && is_ws(*cur)) {
+    cur++;
+  }
+  *p_value = cur;
+  *p_value_len = (int) (end - cur);
+  if(*p_value_len == 0 || !is_plain_value(*p_value, *p_value_len)) {
+    return SCANNER_NO_LINE;
+  }
+
+consume:
+  reader_skip(scanner->reader, consumed);
+  scanner->previous_line = scanner->current_line;
+  scanner->previous_col = scanner->current_col + consumed - 1;
+  scanner->current_line++;
+  scanner->current_col = 1;
+  return type;
 }
 
+long scanner_bytes_read(_scanner_t *scanner) {
+  return reader_tell(scanner->reader);
+}
+
+void scanner_free(_scanner_t *scanner) {
+  _memctx_t *mem = scanner->mem;
+  reader_close(scanner->reader);
+  mem_free(mem, scanner->filename);
+  mem_free(mem, scanner);
+}
@@ -0,0 +1,548 @@
+/*
+ * Filename:  shared.c
+ *
+ * Description:  Contains the publication of properties into shared memory, and their read-only attachment.
+ *
+ * Copyright (c) 2017 Erwann Miriel, erwann.miriel@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "include/shared.h"
+#include "include/utils.h"
+#include "include/logging.h"
+
+#define SHARED_MAGIC        0x50525348u     /* "PRSH" */
+#define SHARED_LAYOUT       1
+#define SHARED_NO_VALUE     0xffffffffu
+#define SHARED_INDEX_MIN    16
+#define SHARED_MODE         0600
+
+/* attempts to open the current version, which may be replaced meanwhile */
+#define SHARED_ATTEMPTS     8
+
+/* name.version, the version being at most 10 digits */
+#define SEGMENT_NAME_EXTRA  12
+
+#ifdef __GNUC__
+#define ATOMIC_LOAD(ptr)            __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define ATOMIC_STORE(ptr, val)      __atomic_store_n(ptr, val, __ATOMIC_RELEASE)
+#define ATOMIC_INCREMENT(ptr)       __atomic_add_fetch(ptr, 1, __ATOMIC_ACQ_REL)
+#define ATOMIC_CAS(ptr, p_old, val) \
+    __atomic_compare_exchange_n(ptr, p_old, val, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#else
+#error "shared.c needs the __atomic builtins"
+#endif
+
+/**
+ * Layout of a segment : the header, the entries (in insertion order), the index, then the string table.
+ * Every position is an offset : from the start of the segment in the header, from the string table in the entries.
+ * The index is an open addressing table of slot + 1 (0 when empty), probed like the one of the holders.
+ */
+typedef struct _shared_header _shared_header_t;
+
+struct _shared_header {
+    unsigned int magic;
+    unsigned int layout;
+    unsigned long long segment_size;
+    unsigned int version;
+    int size;
+    unsigned int index_mask;
+    unsigned int entries;
+    unsigned int index;
+    unsigned int strings;
+};
+
+typedef struct _shared_entry _shared_entry_t;
+
+struct _shared_entry {
+    unsigned int hash;
+    int key_len;
+    unsigned int key;
+    unsigned int value;
+};
+
+/**
+ * Control segment of a name : the last reserved version, and the current one.
+ */
+typedef struct _shared_control _shared_control_t;
+
+struct _shared_control {
+    unsigned int magic;
+    unsigned int next_version;
+    unsigned int current;
+};
+
+struct _properties_shared {
+    char *name;
+    _shared_control_t *control;
+    char *base;
+    size_t segment_size;
+    _shared_header_t *header;
+    _shared_entry_t *entries;
+    unsigned int *index;
+    char *strings;
+};
+
+static void segment_name(char *buf, char *name, unsigned int version) {
+  snprintf(buf, strlen(name) + SEGMENT_NAME_EXTRA, "%s.%u", name, version);
+}
+
+static size_t index_capacity(int size) {
+  size_t capacity = 2 * SHARED_INDEX_MIN;
+
+  while(capacity < 2 * (size_t) size) {
+    capacity *= 2;
+  }
+  return capacity;
+}
+
+/**
+ * Checks that all the values of a properties holder are strings, the only values a segment can hold.
+ * @param caller the name of the public function, for the log
+ * @return 0 if succeeded, -1 otherwise
+ */
+static int segment_check(properties_t *props, char *caller) {
+  int i;
+
+  for(i = 0; i < props->size; i++) {
+    if(!properties_property_is_string(props->contents[i])) {
+      log_error("%s : the value of %s is not a string", caller, props->keys[i]);
+      return FUNC_FAILURE;
+    }
+  }
+  return FUNC_SUCCESS;
+}
+
+/**
+ * Computes the size of the segment of a properties holder, and the offsets of its parts.
+ */
+static size_t segment_size(properties_t *props, _shared_header_t *header) {
+  size_t strings_size = 0;
+  int i;
+
+  for(i = 0; i < props->size; i++) {
+    strings_size += props->key_lens[i] + NULL_CHAR_OFFSET;
+    if(props->values[i] != NULL) {
+      strings_size += strlen(props->values[i]) + NULL_CHAR_OFFSET;
+    }
+  }
+  header->size = props->size;
+  header->index_mask = (unsigned int) index_capacity(props->size) - 1;
+  header->entries = sizeof(*header);
+  header->index = header->entries + props->size * sizeof(_shared_entry_t);
+  header->strings = header->index + (header->index_mask + 1) * sizeof(unsigned int);
+  header->segment_size = header->strings + strings_size;
+  return header->segment_size;
+}
+
+/**
+ * Writes the segment of a properties holder.
+ * @param base the segment, zeroed
+ * @param header the header computed by segment_size
+ */
+static void segment_fill(properties_t *props, char *base, _shared_header_t *header) {
+  _shared_entry_t *entries = (_shared_entry_t *) (base + header->entries);
+  unsigned int *index = (unsigned int *) (base + header->index), pos, offset = 0;
+  char *strings = base + header->strings;
+  int i, len;
+
+  for(i = 0; i < props->size; i++) {
+    entries[i].hash = props->hashes[i];
+    entries[i].key_len = props->key_lens[i];
+    entries[i].key = offset;
+    memcpy(strings + offset, props->keys[i], props->key_lens[i] + NULL_CHAR_OFFSET);
+    offset += props->key_lens[i] + NULL_CHAR_OFFSET;
+
+    entries[i].value = SHARED_NO_VALUE;
+    if(props->values[i] != NULL) {
+      len = (int) strlen(props->values[i]);
+      entries[i].value = offset;
+      memcpy(strings + offset, props->values[i], len + NULL_CHAR_OFFSET);
+      offset += len + NULL_CHAR_OFFSET;
+    }
+
+    pos = entries[i].hash & header->index_mask;
+    while(index[pos] != 0) {
+      pos = (pos + 1) & header->index_mask;
+    }
+    index[pos] = i + 1;
+  }
+  header->magic = SHARED_MAGIC;
+  header->layout = SHARED_LAYOUT;
+  memcpy(base, header, sizeof(*header));
+}
+
+/**
+ * Sizes a new segment and writes a properties holder into it.
+ * @return 0 if succeeded, -1 otherwise
+ */
+static int segment_write(int fd, properties_t *props, unsigned int version) {
+  _shared_header_t header;
+  size_t size;
+  char *base;
+
+  memset(&header, 0, sizeof(header));
+  header.version = version;
+  size = segment_size(props, &header);
+  if(size > SHARED_NO_VALUE) {
+    log_error("properties_publish : properties too large to be shared");
+    return FUNC_FAILURE;
+  }
+  if(ftruncate(fd, (off_t) size) == -1) {
+    return FUNC_FAILURE;
+  }
+  base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if(base == MAP_FAILED) {
+    return FUNC_FAILURE;
+  }
+  segment_fill(props, base, &header);
+  munmap(base, size);
+  return FUNC_SUCCESS;
+}
+
+/**
+ * Maps a segment read-only and checks its layout.
+ * @return 0 if succeeded, -1 otherwise
+ */
+static int segment_map(int fd, properties_shared_t *shared) {
+  struct stat st;
+  _shared_header_t *header;
+  char *base;
+
+  if(fstat(fd, &st) == -1 || (size_t) st.st_size < sizeof(*header)) {
+    return FUNC_FAILURE;
+  }
+  base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  if(base == MAP_FAILED) {
+    return FUNC_FAILURE;
+  }
+
+  header = (_shared_header_t *) base;
+  if(header->magic != SHARED_MAGIC || header->layout != SHARED_LAYOUT || header->segment_size != (size_t) st.st_size
+     || header->strings > st.st_size || header->index + (header->index_mask + 1) * sizeof(unsigned int) > header->strings
+     || header->entries + header->size * sizeof(_shared_entry_t) > header->index) {
+    log_error("properties_attach : not a properties segment");
+    munmap(base, st.st_size);
+    return FUNC_FAILURE;
+  }
+
+  shared->base = base;
+  shared->segment_size = st.st_size;
+  shared->header = header;
+  shared->entries = (_shared_entry_t *) (base + header->entries);
+  shared->index = (unsigned int *) (base + header->index);
+  shared->strings = base + header->strings;
+  return FUNC_SUCCESS;
+}
+
+/**
+ * Opens the control segment of a name, mapped read-write to publish or read-only to attach.
+ * @return the control segment if succeeded, NULL otherwise
+ */
+static _shared_control_t *control_map(char *name, int writable) {
+  _shared_control_t *control;
+  struct stat st;
+  int fd;
+
+  fd = shm_open(name, writable ? O_RDWR | O_CREAT : O_RDONLY, SHARED_MODE);
+  if(fd == -1) {
+    return NULL;
+  }
+  /* a new control segment is zeroed : no version yet */
+  if((writable && ftruncate(fd, sizeof(*control)) == -1)
+     || (!writable && (fstat(fd, &st) == -1 || (size_t) st.st_size < sizeof(*control)))) {
+    close(fd);
+    return NULL;
+  }
+  control = mmap(NULL, sizeof(*control), writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  return control == MAP_FAILED ? NULL : control;
+}
+
+unsigned int properties_publish(char *name, properties_t *props) {
+  _shared_control_t *control;
+  char *data_name;
+  unsigned int version, current;
+  int fd;
+
+  if(segment_check(props, "properties_publish") != FUNC_SUCCESS) {
+    return 0;
+  }
+  data_name = mem_malloc(NULL, strlen(name) + SEGMENT_NAME_EXTRA);
+  if(data_name == NULL) {
+    goto error;
+  }
+  control = control_map(name, 1);
+  if(control == NULL) {
+    goto dealloc_name;
+  }
+  ATOMIC_STORE(&(control->magic), SHARED_MAGIC);
+
+  version = ATOMIC_INCREMENT(&(control->next_version));
+  segment_name(data_name, name, version);
+  fd = shm_open(data_name, O_RDWR | O_CREAT | O_EXCL, SHARED_MODE);
+  if(fd == -1) {
+    goto unmap_control;
+  }
+  if(segment_write(fd, props, version) != FUNC_SUCCESS) {
+    close(fd);
+    shm_unlink(data_name);
+    goto unmap_control;
+  }
+  close(fd);
+
+  /* switches to the new version, unless a concurrent publisher already switched to a later one */
+  current = ATOMIC_LOAD(&(control->current));
+  while(current < version && !ATOMIC_CAS(&(control->current), &current, version));
+  if(current < version) {
+    if(current != 0) {
+      segment_name(data_name, name, current);
+      shm_unlink(data_name);
+    }
+  } else {
+    shm_unlink(data_name);
+  }
+
+  munmap(control, sizeof(*control));
+  mem_free(NULL, data_name);
+  return version;
+
+unmap_control:
+  munmap(control, sizeof(*control));
+dealloc_name:
+  mem_free(NULL, data_name);
+error:
+  log_error("properties_publish");
+  return 0;
+}
+
+int properties_unpublish(char *name) {
+  _shared_control_t *control;
+  char *data_name;
+  unsigned int current;
+  int ret = FUNC_SUCCESS;
+
+  control = control_map(name, 0);
+  if(control == NULL) {
+    log_error("properties_unpublish : %s is not published", name);
+    return FUNC_FAILURE;
+  }
+  current = ATOMIC_LOAD(&(control->current));
+  munmap(control, sizeof(*control));
+
+  data_name = mem_malloc(NULL, strlen(name) + SEGMENT_NAME_EXTRA);
+  if(data_name == NULL) {
+    return FUNC_FAILURE;
+  }
+  segment_name(data_name, name, current);
+  if((current != 0 && shm_unlink(data_name) == -1) || shm_unlink(name) == -1) {
+    ret = FUNC_FAILURE;
+  }
+  mem_free(NULL, data_name);
+  return ret;
+}
+
+int properties_publish_fd(properties_t *props) {
+  int fd;
+
+  if(segment_check(props, "properties_publish_fd") != FUNC_SUCCESS) {
+    return -1;
+  }
+#ifdef __linux__
+  fd = memfd_create("properties", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if(fd == -1) {
+    goto error;
+  }
+  if(segment_write(fd, props, 0) != FUNC_SUCCESS
+     || fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) == -1) {
+    close(fd);
+    goto error;
+  }
+#else
+  char name[32];
+
+  snprintf(name, sizeof(name), "/properties.%ld", (long) getpid());
+  fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, SHARED_MODE);
+  if(fd == -1) {
+    goto error;
+  }
+  shm_unlink(name);
+  if(segment_write(fd, props, 0) != FUNC_SUCCESS) {
+    close(fd);
+    goto error;
+  }
+#endif
+  return fd;
+
+error:
+  log_error("properties_publish_fd");
+  return -1;
+}
+
+static properties_shared_t *shared_new(char *name) {
+  properties_shared_t *shared;
+
+  shared = mem_malloc(NULL, sizeof(*shared));
+  if(shared == NULL) {
+    return NULL;
+  }
+  memset(shared, 0, sizeof(*shared));
+  if(name != NULL) {
+    shared->name = mem_malloc(NULL, strlen(name) + SEGMENT_NAME_EXTRA);
+    if(shared->name == NULL) {
+      mem_free(NULL, shared);
+      return NULL;
+    }
+    strcpy(shared->name, name);
+  }
+  return shared;
+}
+
+/**
+ * Maps the current version of a name into a new mapping of shared, leaving the previous mapping untouched.
+ * @return 0 if succeeded, -1 otherwise
+ */
+static int map_current(properties_shared_t *shared, properties_shared_t *mapping) {
+  char *data_name;
+  unsigned int current;
+  int fd = -1, attempts;
+
+  data_name = mem_malloc(NULL, strlen(shared->name) + SEGMENT_NAME_EXTRA);
+  if(data_name == NULL) {
+    return FUNC_FAILURE;
+  }
+  /* the version read may be replaced and unlinked before being opened : the new one is read again */
+  for(attempts = 0; fd == -1 && attempts < SHARED_ATTEMPTS; attempts++) {
+    current = ATOMIC_LOAD(&(shared->control->current));
+    if(current == 0) {
+      break;
+    }
+    segment_name(data_name, shared->name, current);
+    fd = shm_open(data_name, O_RDONLY, 0);
+    if(fd == -1 && errno != ENOENT) {
+      break;
+    }
+  }
+  mem_free(NULL, data_name);
+  if(fd == -1) {
+    return FUNC_FAILURE;
+  }
+  if(segment_map(fd, mapping) != FUNC_SUCCESS) {
+    close(fd);
+    return FUNC_FAILURE;
+  }
+  close(fd);
+  return FUNC_SUCCESS;
+}
+
+properties_shared_t *properties_attach(char *name) {
+  properties_shared_t *shared;
+
+  shared = shared_new(name);
+  if(shared == NULL) {
+    goto error;
+  }
+  shared->control = control_map(name, 0);
+  if(shared->control == NULL || ATOMIC_LOAD(&(shared->control->magic)) != SHARED_MAGIC
+     || map_current(shared, shared) != FUNC_SUCCESS) {
+    properties_detach(shared);
+    goto error;
+  }
+  return shared;
+
+error:
+  log_error("properties_attach");
+  return NULL;
+}
+
+properties_shared_t *properties_attach_fd(int fd) {
+  properties_shared_t *shared;
+
+  shared = shared_new(NULL);
+  if(shared == NULL || segment_map(fd, shared) != FUNC_SUCCESS) {
+    if(shared != NULL) {
+      properties_detach(shared);
+    }
+    log_error("properties_attach_fd");
+    return NULL;
+  }
+  return shared;
+}
+
+int properties_shared_refresh(properties_shared_t *shared) {
+  properties_shared_t mapping;
+
+  if(shared->control == NULL || ATOMIC_LOAD(&(shared->control->current)) == shared->header->version) {
+    return 0;
+  }
+  if(map_current(shared, &mapping) != FUNC_SUCCESS) {
+    log_error("properties_shared_refresh");
+    return FUNC_FAILURE;
+  }
+  munmap(shared->base, shared->segment_size);
+  shared->base = mapping.base;
+  shared->segment_size = mapping.segment_size;
+  shared->header = mapping.header;
+  shared->entries = mapping.entries;
+  shared->index = mapping.index;
+  shared->strings = mapping.strings;
+  return 1;
+}
+
+char *properties_shared_get_value(char *key, properties_shared_t *shared) {
+  _shared_entry_t *entry;
+  unsigned int pos, hash, mask = shared->header->index_mask, slot;
+  int len;
+
+  hash = hash_string(key, &len);
+  pos = hash & mask;
+  while((slot = shared->index[pos]) != 0) {
+    entry = &(shared->entries[slot - 1]);
+    if(entry->hash == hash && entry->key_len == len && memcmp(shared->strings + entry->key, key, len) == 0) {
+      return entry->value == SHARED_NO_VALUE ? NULL : shared->strings + entry->value;
+    }
+    pos = (pos + 1) & mask;
+  }
+  return NULL;
+}
+
+int properties_shared_size(properties_shared_t *shared) {
+  return shared->header->size;
+}
+
+unsigned int properties_shared_version(properties_shared_t *shared) {
+  return shared->header->version;
+}
+
+void properties_detach(properties_shared_t *shared) {
+  if(shared->base != NULL) {
+    munmap(shared->base, shared->segment_size);
+  }
+  if(shared->control != NULL) {
+    munmap(shared->control, sizeof(*(shared->control)));
+  }
+  mem_free(NULL, shared->name);
+  mem_free(NULL, shared);
+}
@@ -0,0 +1,297 @@
+/*
+ * Filename:  sorted.c
+ *
+ * Description:  Contains the sorted index of the frozen properties holders.
+ *
+ * Copyright (c) 2017 Erwann Miriel, erwann.miriel@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "include/sorted.h"
+#include "include/utils.h"
+#include "include/logging.h"
+
+/* nodes per cache line : prefetching node 8k brings the nodes 3 levels below k */
+#define NODES_PER_LINE  8
+
+#define PREFIX_BYTES    6
+#define SKIP_BITS       16
+#define SKIP_MAX        ((1 << SKIP_BITS) - 1)
+#define NODE_SKIP(node)     ((unsigned int) ((node) & SKIP_MAX))
+#define NODE_PREFIX(node)   ((node) >> SKIP_BITS)
+
+/* lower bound beyond the last key */
+#define NO_NODE         0
+
+typedef struct _sort_entry _sort_entry_t;
+
+struct _sort_entry {
+    char *key;
+    int slot;
+};
+
+/**
+ * Orders keys like strcmp, equal keys by slot.
+ */
+static int compare_entries(const void *a, const void *b) {
+  const _sort_entry_t *entry_a = a, *entry_b = b;
+  int cmp = strcmp(entry_a->key, entry_b->key);
+
+  if(cmp == 0) {
+    cmp = entry_a->slot - entry_b->slot;
+  }
+  return cmp;
+}
+
+/**
+ * Packs the first bytes of a key, so that comparing prefixes orders keys like strcmp.
+ */
+static unsigned long long key_prefix(char *key) {
+  unsigned long long prefix = 0;
+  int i;
+
+  for(i = 0; i < PREFIX_BYTES; i++) {
+    prefix <<= 8;
+    if(*key != '\0') {
+      prefix |= (unsigned char) *key;
+      key++;
+    }
+  }
+  return prefix;
+}
+
+/**
+ * Packs the first bytes of a key at an offset, the key being len bytes long.
+ */
+static unsigned long long key_prefix_at(char *key, int len, unsigned int offset) {
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  unsigned long long prefix;
+
+  if(len - (int) offset >= (int) sizeof(prefix)) {
+    memcpy(&prefix, key + offset, sizeof(prefix));
+    return __builtin_bswap64(prefix) >> (8 * (sizeof(prefix) - PREFIX_BYTES));
+  }
+#else
+  (void) len;
+#endif
+  return key_prefix(key + offset);
+}
+
+static unsigned int common_prefix_len(char *a, char *b) {
+  unsigned int len = 0;
+
+  while(a[len] != '\0' && a[len] == b[len]) {
+    len++;
+  }
+  return len;
+}
+
+/**
+ * Fills the slots and the ranks of the nodes with an in-order walk of the implicit tree.
+ * @return the next rank to place
+ */
+static int eytzinger_fill(_sorted_index_t *index, int rank, int k) {
+  if(k <= index->size) {
+    rank = eytzinger_fill(index, rank, 2 * k);
+    index->slots[k] = index->sorted[rank];
+    index->ranks[k] = rank;
+    rank = eytzinger_fill(index, rank + 1, 2 * k + 1);
+  }
+  return rank;
+}
+
+/**
+ * Packs the nodes, walking down the tree with the bounds of each subtree.
+ * Without one of the bounds, the searched key may lie outside the keys : only their common prefix is shared.
+ * A shorter skip than the shared prefix is still valid, so it is capped.
+ * @param lower the rank of the lower bound, -1 if none
+ * @param upper the rank of the upper bound, -1 if none
+ */
+static void eytzinger_pack(_sorted_index_t *index, char **keys, int k, int lower, int upper) {
+  unsigned int skip;
+
+  if(k > index->size) {
+    return;
+  }
+  skip = index->common_len;
+  if(lower != -1 && upper != -1) {
+    skip = common_prefix_len(keys[index->sorted[lower]], keys[index->sorted[upper]]);
+  }
+  if(skip > SKIP_MAX) {
+    skip = SKIP_MAX;
+  }
+  index->nodes[k] = key_prefix(keys[index->slots[k]] + skip) << SKIP_BITS | skip;
+
+  eytzinger_pack(index, keys, 2 * k, lower, index->ranks[k]);
+  eytzinger_pack(index, keys, 2 * k + 1, index->ranks[k], upper);
+}
+
+static void pool_fill(_sorted_index_t *index, char **keys, int *key_lens) {
+  unsigned int offset = 0;
+  int k, slot;
+
+  for(k = 1; k <= index->size; k++) {
+    slot = index->slots[k];
+    index->offsets[k] = offset;
+    memcpy(index->pool + offset, keys[slot], key_lens[slot] + NULL_CHAR_OFFSET);
+    offset += key_lens[slot] + NULL_CHAR_OFFSET;
+  }
+}
+
+_sorted_index_t *sorted_index_new(_memctx_t *mem, char **keys, int *key_lens, int size) {
+  _sorted_index_t *index;
+  _sort_entry_t *entries;
+  size_t pool_size = NULL_CHAR_OFFSET;
+  int i;
+
+  index = mem_malloc(mem, sizeof(*index));
+  entries = mem_malloc(mem, (size + 1) * sizeof(*entries));
+  if(index == NULL || entries == NULL) {
+    goto dealloc_entries;
+  }
+
+  for(i = 0; i < size; i++) {
+    pool_size += key_lens[i] + NULL_CHAR_OFFSET;
+  }
+  index->size = size;
+  index->pool_size = pool_size;
+  index->sorted = mem_malloc(mem, (size + 1) * sizeof(*(index->sorted)));
+  /* the nodes are aligned on cache lines, so that the 8 descendants 3 levels below a node share one line */
+  index->nodes_block = mem_malloc(mem, (size + 1 + NODES_PER_LINE) * sizeof(*(index->nodes)));
+  index->nodes = ALIGN_UP(index->nodes_block, CACHE_LINE);
+  index->offsets = mem_malloc(mem, (size + 1) * sizeof(*(index->offsets)));
+  index->slots = mem_malloc(mem, (size + 1) * sizeof(*(index->slots)));
+  index->ranks = mem_malloc(mem, (size + 1) * sizeof(*(index->ranks)));
+  index->pool = mem_malloc(mem, pool_size);
+  if(index->sorted == NULL || index->nodes_block == NULL || index->offsets == NULL || index->slots == NULL
+     || index->ranks == NULL || index->pool == NULL) {
+    sorted_index_free(mem, index);
+    index = NULL;
+    goto dealloc_entries;
+  }
+
+  for(i = 0; i < size; i++) {
+    entries[i].key = keys[i];
+    entries[i].slot = i;
+  }
+  qsort(entries, size, sizeof(*entries), compare_entries);
+  for(i = 0; i < size; i++) {
+    index->sorted[i] = entries[i].slot;
+  }
+
+  /* the common prefix of the first and last keys is shared by all keys */
+  index->common_len = 0;
+  if(size > 0) {
+    index->common_len = (int) common_prefix_len(entries[0].key, entries[size - 1].key);
+  }
+
+  eytzinger_fill(index, 0, 1);
+  eytzinger_pack(index, keys, 1, -1, -1);
+  pool_fill(index, keys, key_lens);
+  index->pool[pool_size - 1] = '\0';
+
+  mem_free(mem, entries);
+  return index;
+
+dealloc_entries:
+  mem_free(mem, entries);
+  if(index != NULL) {
+    mem_free(mem, index);
+  }
+  log_error("sorted_index_new");
+  return NULL;
+}
+
+size_t sorted_index_memory(_sorted_index_t *index) {
+  size_t nb = (size_t) index->size + 1;
+
+  return sizeof(*index) + nb * (sizeof(*(index->sorted)) + sizeof(*(index->offsets)) + sizeof(*(index->slots))
+                                + sizeof(*(index->ranks)))
+         + (nb + NODES_PER_LINE) * sizeof(*(index->nodes)) + index->pool_size;
+}
+
+void sorted_index_free(_memctx_t *mem, _sorted_index_t *index) {
+  mem_free(mem, index->sorted);
+  mem_free(mem, index->nodes_block);
+  mem_free(mem, index->offsets);
+  mem_free(mem, index->slots);
+  mem_free(mem, index->ranks);
+  mem_free(mem, index->pool);
+  mem_free(mem, index);
+}
+
+/**
+ * Searches the node of the lower bound of a key.
+ * @return the node, NO_NODE if every key is lower
+ */
+static int lower_bound_node(_sorted_index_t *index, char *key) {
+  unsigned long long node, prefix;
+  unsigned int skip;
+  int k = 1, cmp, less, len;
+
+  if(index->size == 0) {
+    return NO_NODE;
+  }
+
+  /* keys outside the common prefix are lower or greater than all the keys */
+  cmp = strncmp(key, index->pool + index->offsets[1], index->common_len);
+  if(cmp > 0) {
+    return NO_NODE;
+  }
+  if(cmp < 0) {
+    /* the first key is the leftmost node */
+    while(2 * k <= index->size) {
+      k *= 2;
+    }
+    return k;
+  }
+
+  len = (int) strlen(key);
+  while(k <= index->size) {
+    PREFETCH(index->nodes + NODES_PER_LINE * k);
+    node = index->nodes[k];
+    skip = NODE_SKIP(node);
+    prefix = key_prefix_at(key, len, skip);
+    less = NODE_PREFIX(node) < prefix;
+    /* the pool is only read when the prefixes are equal and the key goes on after them */
+    if(NODE_PREFIX(node) == prefix && len > (int) skip + PREFIX_BYTES) {
+      less = strcmp(index->pool + index->offsets[k] + skip + PREFIX_BYTES, key + skip + PREFIX_BYTES) < 0;
+    }
+    k = 2 * k + less;
+  }
+
+  /* drops the trailing right turns (ones) and the last left turn : k is the last node where we went left */
+  while(k & 1) {
+    k >>= 1;
+  }
+  return k >> 1;
+}
+
+int sorted_index_lower_bound(_sorted_index_t *index, char *key) {
+  int k = lower_bound_node(index, key);
+  return k == NO_NODE ? index->size : index->ranks[k];
+}
+
+int sorted_index_find(_sorted_index_t *index, char *key) {
+  int k = lower_bound_node(index, key);
+
+  if(k == NO_NODE || strcmp(index->pool + index->offsets[k], key) != 0) {
+    return -1;
+  }
+  return index->slots[k];
+}
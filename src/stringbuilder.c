@@ -27,16 +27,17 @@
 
 static int DEFAULT_CAPACITY = 500;
 
-_stringbuilder_t * sb_new() {
-  _stringbuilder_t * sb = malloc(sizeof(_stringbuilder_t));
+_stringbuilder_t * sb_new(_memctx_t *mem) {
+  _stringbuilder_t * sb = mem_malloc(mem, sizeof(_stringbuilder_t));
   if(sb == NULL) {
     goto error;
   }
-  sb->string = malloc(sizeof(char) * (DEFAULT_CAPACITY + NULL_CHAR_OFFSET));
+  sb->string = mem_malloc(mem, sizeof(char) * (DEFAULT_CAPACITY + NULL_CHAR_OFFSET));
   if(sb->string == NULL) {
-    free(sb);
+    mem_free(mem, sb);
     goto error;
   }
+  sb->mem = mem;
   sb->size = 0;
   sb->capacity = DEFAULT_CAPACITY;
   return sb;
@@ -47,16 +48,17 @@ _stringbuilder_t * sb_new() {
 }
 
 void sb_free(_stringbuilder_t *sb) {
-  free(sb->string);
-  free(sb);
+  _memctx_t *mem = sb->mem;
+  mem_free(mem, sb->string);
+  mem_free(mem, sb);
 }
 
 int sb_appendchar(_stringbuilder_t *sb, char c) {
   sb->string[sb->size] = c;
   sb->size++;
   if(sb->size == sb->capacity) {
-    sb->capacity += DEFAULT_CAPACITY;
-    sb->string = realloc(sb->string, sizeof(*(sb->string)) * (sb->capacity + NULL_CHAR_OFFSET));
+    sb->capacity *= 2;
+    sb->string = mem_realloc(sb->mem, sb->string, sizeof(*(sb->string)) * (sb->capacity + NULL_CHAR_OFFSET));
     if(sb->string == NULL) {
       sb_free(sb);
       log_error("sb_appendchar");
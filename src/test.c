@@ -1,8 +1,22 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/wait.h>
 #include "include/lexer.h"
 #include "include/utils.h"
 #include "include/logging.h"
+#include "include/profile.h"
+#include "include/bloom.h"
+#include "include/intern.h"
+#include "include/async.h"
+#include "include/scanner.h"
+#include "include/shared.h"
+#include "include/diff.h"
+#include "include/atom.h"
+#include "include/cache.h"
+#include <pthread.h>
 
 struct lexer_unit_test {
     char *filename;
@@ -207,11 +221,1674 @@ free_properties:
   return ret;
 }
 
+int run_recovery_tests() {
+  int ret = FUNC_SUCCESS, nb_diagnostics;
+  char *expected_keys[] = {"first", "second", "third", "fourth"};
+  lexer_diagnostic_t *diagnostics;
+  properties_t *properties;
+  lexer_t *lexer;
+
+  log_info("Testing recovery mode...");
+  properties = properties_new();
+  if(properties == NULL) {
+    log_error("Unable to init properties !");
+    global_nb_errors++;
+    return FUNC_FAILURE;
+  }
+
+  lexer = lexer_new("tests/several_errors.properties", properties);
+  if(lexer == NULL) {
+    log_error("Unable to init lexer !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+    goto free_properties;
+  }
+
+  lexer_set_recovery(lexer, 1);
+  if(lexer_analyze(lexer) != FUNC_FAILURE) {
+    log_error("Errors were not reported !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+
+  nb_diagnostics = lexer_get_diagnostics(lexer, &diagnostics);
+  for(int i = 0; i < nb_diagnostics; i++) {
+    log_info("%s:%d,%d: %s %s", diagnostics[i].filename, diagnostics[i].line, diagnostics[i].column,
+             diagnostics[i].message, diagnostics[i].token);
+  }
+  if(nb_diagnostics != 3) {
+    log_error("%d diagnostics, expected 3", nb_diagnostics);
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+
+  for(int i = 0; i < 4; i++) {
+    if(properties_get_value(expected_keys[i], properties) == NULL) {
+      log_error("%s was not saved after recovery !", expected_keys[i]);
+      global_nb_errors++;
+      ret = FUNC_FAILURE;
+    }
+  }
+  if(ret == FUNC_SUCCESS) {
+    log_info("OK !");
+  }
+
+  lexer_free(lexer);
+
+free_properties:
+  properties_free(properties);
+  return ret;
+}
+
+int run_profile_tests() {
+  int ret = FUNC_SUCCESS;
+  properties_profile_t profile;
+  properties_t *properties;
+  lexer_t *lexer;
+
+  log_info("Testing profiling...");
+  properties = properties_new();
+  if(properties == NULL || properties_profile_start() != FUNC_SUCCESS) {
+    log_error("Unable to start profiling !");
+    global_nb_errors++;
+    return FUNC_FAILURE;
+  }
+
+  lexer = lexer_new("tests/good.properties", properties);
+  if(lexer == NULL || lexer_analyze(lexer) != FUNC_SUCCESS) {
+    log_error("Analysis failed !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+  properties_get_value("test", properties);
+  properties_profile_stop();
+  properties_profile_read(&profile);
+
+  for(int i = 0; i < PROFILE_NB_PHASES; i++) {
+    log_info("%s: %llu calls, %llu ns", properties_profile_phase_name((properties_profile_phase) i),
+             profile.phases[i].calls, profile.phases[i].wall_ns);
+  }
+  if(profile.phases[PROFILE_SCAN].calls == 0 || profile.phases[PROFILE_INSERT].calls != 9
+     || profile.phases[PROFILE_LOOKUP].calls != 1) {
+    log_error("Unexpected phase calls !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+  if(ret == FUNC_SUCCESS) {
+    log_info("OK !");
+  }
+
+  if(lexer != NULL) {
+    lexer_free(lexer);
+  }
+  properties_free(properties);
+  return ret;
+}
+
+int run_stats_tests() {
+  int ret = FUNC_SUCCESS;
+  properties_stats_t stats, total;
+  properties_t *properties;
+  lexer_t *lexer;
+
+  log_info("Testing statistics...");
+  properties = properties_new();
+  if(properties == NULL) {
+    log_error("Unable to init properties !");
+    global_nb_errors++;
+    return FUNC_FAILURE;
+  }
+
+  /* not timed by default */
+  lexer = lexer_new("tests/good.properties", properties);
+  if(lexer == NULL || lexer_analyze(lexer) != FUNC_SUCCESS) {
+    log_error("Analysis failed !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+    goto free_properties;
+  }
+  lexer_get_stats(lexer, &stats);
+  lexer_free(lexer);
+  if(stats.scanner_ns != 0 || stats.lexer_ns != 0 || stats.insertion_ns != 0 || stats.lines != 13) {
+    log_error("Untimed analysis timed !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+    goto free_properties;
+  }
+  properties_free(properties);
+  properties = properties_new();
+  if(properties == NULL) {
+    log_error("Unable to init properties !");
+    global_nb_errors++;
+    return FUNC_FAILURE;
+  }
+
+  lexer = lexer_new("tests/good.properties", properties);
+  if(lexer != NULL) {
+    lexer_set_timing(lexer, 1);
+  }
+  if(lexer == NULL || lexer_analyze(lexer) != FUNC_SUCCESS) {
+    log_error("Analysis failed !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+    goto free_properties;
+  }
+
+  /* analysing again counts nothing more */
+  if(lexer_analyze(lexer) != FUNC_SUCCESS) {
+    log_error("Second analysis failed !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+  lexer_get_stats(lexer, &stats);
+  properties_stats(properties, &total);
+  log_info("%llu bytes, %llu lines (%llu continued), %llu escapes, %llu malloc, %llu realloc, peak builder %llu",
+           stats.bytes_read, stats.lines, stats.continuation_lines, stats.escapes_decoded, stats.nb_malloc,
+           stats.nb_realloc, stats.peak_builder_size);
+  log_info("scanner %llu ns, lexer %llu ns, insertion %llu ns", stats.scanner_ns, stats.lexer_ns, stats.insertion_ns);
+  if(stats.bytes_read != 305 || stats.lines != 13 || stats.continuation_lines != 2 || stats.escapes_decoded != 6
+     || stats.tokens[4] != 11 || stats.nb_malloc == 0 || total.loads != 1 || total.nb_malloc != stats.nb_malloc
+     || total.lines != 13 || stats.scanner_ns == 0) {
+    log_error("Unexpected statistics !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  } else {
+    log_info("OK !");
+  }
+  lexer_free(lexer);
+
+free_properties:
+  properties_free(properties);
+  return ret;
+}
+
+struct counting_allocator {
+    int nb_alloc;
+    int nb_live;
+};
+
+void *counting_alloc(size_t size, void *ctx) {
+  struct counting_allocator *counter = ctx;
+  counter->nb_alloc++;
+  counter->nb_live++;
+  return malloc(size);
+}
+
+void *counting_realloc(void *ptr, size_t size, void *ctx) {
+  struct counting_allocator *counter = ctx;
+  if(ptr == NULL) {
+    counter->nb_alloc++;
+    counter->nb_live++;
+  }
+  return realloc(ptr, size);
+}
+
+void counting_free(void *ptr, void *ctx) {
+  struct counting_allocator *counter = ctx;
+  counter->nb_live--;
+  free(ptr);
+}
+
+int run_allocator_tests() {
+  int ret = FUNC_SUCCESS;
+  struct counting_allocator counter = {0, 0};
+  properties_allocator_t allocator = {counting_alloc, counting_realloc, counting_free, NULL};
+  properties_t *properties;
+  lexer_t *lexer;
+
+  log_info("Testing allocator...");
+  allocator.ctx = &counter;
+  properties = properties_new_with_allocator(&allocator);
+  if(properties == NULL) {
+    log_error("Unable to init properties !");
+    global_nb_errors++;
+    return FUNC_FAILURE;
+  }
+
+  lexer = lexer_new("tests/good.properties", properties);
+  if(lexer == NULL || lexer_analyze(lexer) != FUNC_SUCCESS) {
+    log_error("Analysis failed !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+  if(lexer != NULL) {
+    lexer_free(lexer);
+  }
+  properties_property_free("user", properties);
+  properties_free(properties);
+
+  log_info("%d allocations, %d still live", counter.nb_alloc, counter.nb_live);
+  if(counter.nb_alloc == 0 || counter.nb_live != 0) {
+    log_error("Allocations were not all routed through the allocator !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  } else {
+    log_info("OK !");
+  }
+  return ret;
+}
+
+struct failing_allocator {
+    int budget;
+    int nb_live;
+};
+
+void *failing_alloc(size_t size, void *ctx) {
+  struct failing_allocator *failing = ctx;
+  if(failing->budget == 0) {
+    return NULL;
+  }
+  failing->budget--;
+  failing->nb_live++;
+  return malloc(size);
+}
+
+void *failing_realloc(void *ptr, size_t size, void *ctx) {
+  struct failing_allocator *failing = ctx;
+  if(failing->budget == 0) {
+    return NULL;
+  }
+  failing->budget--;
+  if(ptr == NULL) {
+    failing->nb_live++;
+  }
+  return realloc(ptr, size);
+}
+
+void failing_free(void *ptr, void *ctx) {
+  struct failing_allocator *failing = ctx;
+  failing->nb_live--;
+  free(ptr);
+}
+
+int run_oom_tests() {
+  int ret = FUNC_SUCCESS, budget, i, nb_added, added[40], len;
+  struct failing_allocator failing = {-1, 0};
+  properties_allocator_t allocator = {failing_alloc, failing_realloc, failing_free, NULL};
+  properties_t *properties;
+  char key[64], *value;
+
+  log_info("Testing failed allocations...");
+  allocator.ctx = &failing;
+  /* every allocation of the puts fails in turn, a failed put must leave the holder as it was */
+  for(budget = 0, nb_added = 0; nb_added < 40 && ret == FUNC_SUCCESS; budget++) {
+    failing.budget = -1;
+    properties = properties_new_with_allocator(&allocator);
+    if(properties == NULL || properties_set_bloom_filter(properties, 0.01) != FUNC_SUCCESS
+       || properties_set_key_atoms(properties, budget % 2) != FUNC_SUCCESS) {
+      log_error("Unable to init properties !");
+      global_nb_errors++;
+      return FUNC_FAILURE;
+    }
+
+    failing.budget = budget;
+    for(i = 0, nb_added = 0; i < 40; i++) {
+      len = sprintf(key, "a.rather.long.section.name.key%d", i);
+      added[i] = properties_property_put_string(key, len, key, len, properties) == FUNC_SUCCESS;
+      nb_added += added[i];
+    }
+    failing.budget = -1;
+
+    for(i = 0; i < 40; i++) {
+      sprintf(key, "a.rather.long.section.name.key%d", i);
+      value = properties_get_value(key, properties);
+      if(added[i] != (value != NULL) || (value != NULL && strcmp(value, key) != 0)) {
+        log_error("Wrong lookup of %s after %d allocations !", key, budget);
+        global_nb_errors++;
+        ret = FUNC_FAILURE;
+      }
+    }
+    if(properties->size != nb_added) {
+      log_error("Wrong size after %d allocations !", budget);
+      global_nb_errors++;
+      ret = FUNC_FAILURE;
+    }
+    properties_free(properties);
+    if(failing.nb_live != 0) {
+      log_error("%d allocations leaked after %d allocations !", failing.nb_live, budget);
+      global_nb_errors++;
+      ret = FUNC_FAILURE;
+      failing.nb_live = 0;
+    }
+  }
+  if(ret == FUNC_SUCCESS) {
+    log_info("OK !");
+  }
+  return ret;
+}
+
+int run_index_tests() {
+  int ret = FUNC_SUCCESS, len;
+  char key[32], *value;
+  properties_t *properties;
+
+  log_info("Testing indexed lookups...");
+  properties = properties_new();
+  if(properties == NULL) {
+    log_error("Unable to init properties !");
+    global_nb_errors++;
+    return FUNC_FAILURE;
+  }
+
+  for(int i = 0; i < 100; i++) {
+    len = sprintf(key, "section.key%d", i);
+    properties_property_put_string(key, len, key, len, properties);
+  }
+  for(int i = 0; i < 100; i += 2) {
+    sprintf(key, "section.key%d", i);
+    properties_property_free(key, properties);
+  }
+
+  for(int i = 0; i < 100; i++) {
+    sprintf(key, "section.key%d", i);
+    value = properties_get_value(key, properties);
+    if((i % 2 == 0) != (value == NULL) || (value != NULL && strcmp(value, key) != 0)) {
+      log_error("Wrong lookup of %s !", key);
+      global_nb_errors++;
+      ret = FUNC_FAILURE;
+    }
+  }
+  char *keys[100];
+  void *values[100];
+  for(int i = 0; i < 100; i++) {
+    keys[i] = malloc(32);
+    sprintf(keys[i], "section.key%d", i);
+  }
+  if(properties_get_values(keys, 100, values, properties) != 50) {
+    log_error("Wrong batched lookup !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+  for(int i = 0; i < 100; i++) {
+    if(values[i] != properties_get_value(keys[i], properties)) {
+      log_error("Wrong batched lookup of %s !", keys[i]);
+      global_nb_errors++;
+      ret = FUNC_FAILURE;
+    }
+    free(keys[i]);
+  }
+  if(properties->size != 50 || properties_get_value("section.key", properties) != NULL) {
+    log_error("Wrong properties after removal !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+  if(ret == FUNC_SUCCESS) {
+    log_info("OK !");
+  }
+
+  properties_free(properties);
+  return ret;
+}
+
+int run_sorted_tests() {
+  int ret = FUNC_SUCCESS, len, rank;
+  char key[32], *value;
+  properties_t *properties;
+
+  log_info("Testing frozen properties...");
+  properties = properties_new();
+  if(properties == NULL) {
+    log_error("Unable to init properties !");
+    global_nb_errors++;
+    return FUNC_FAILURE;
+  }
+
+  for(int i = 99; i >= 0; i--) {
+    len = sprintf(key, "section.key%d", i);
+    properties_property_put_string(key, len, key, len, properties);
+  }
+  if(properties_lower_bound("section.key", properties) != FUNC_FAILURE || properties_freeze(properties) != FUNC_SUCCESS) {
+    log_error("Wrong freeze !");
+    global_nb_errors++;
+    properties_free(properties);
+    return FUNC_FAILURE;
+  }
+
+  for(int i = 0; i < 100; i++) {
+    sprintf(key, "section.key%d", i);
+    value = properties_get_value(key, properties);
+    if(value == NULL || strcmp(value, key) != 0) {
+      log_error("Wrong frozen lookup of %s !", key);
+      global_nb_errors++;
+      ret = FUNC_FAILURE;
+    }
+  }
+  for(rank = 1; rank < properties->size; rank++) {
+    if(strcmp(properties_sorted_key(rank - 1, properties), properties_sorted_key(rank, properties)) >= 0) {
+      log_error("Wrong order at rank %d !", rank);
+      global_nb_errors++;
+      ret = FUNC_FAILURE;
+    }
+  }
+
+  rank = properties_lower_bound("section.key50a", properties);
+  if(properties_get_value("section.key50a", properties) != NULL
+     || strcmp(properties_sorted_value(rank, properties), "section.key51") != 0
+     || properties_lower_bound("a", properties) != 0 || properties_lower_bound("z", properties) != 100
+     || properties_sorted_key(100, properties) != NULL) {
+    log_error("Wrong lower bound !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+  if(properties_property_put_string("key", 3, "value", 5, properties) != FUNC_FAILURE) {
+    log_error("Frozen properties modified !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+  properties_unfreeze(properties);
+  if(properties_property_put_string("key", 3, "value", 5, properties) != FUNC_SUCCESS
+     || properties_get_value("key", properties) == NULL) {
+    log_error("Wrong unfreeze !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+  if(ret == FUNC_SUCCESS) {
+    log_info("OK !");
+  }
+
+  properties_free(properties);
+  return ret;
+}
+
+int run_bloom_tests() {
+  int ret = FUNC_SUCCESS, len, nb_false_positives = 0;
+  char key[32], *value;
+  properties_t *properties;
+
+  log_info("Testing bloom filter...");
+  properties = properties_new();
+  if(properties == NULL || properties_set_bloom_filter(properties, 0.01) != FUNC_SUCCESS) {
+    log_error("Unable to init properties !");
+    global_nb_errors++;
+    return FUNC_FAILURE;
+  }
+
+  /* the filter grows past the size it was built for */
+  for(int i = 0; i < 1000; i++) {
+    len = sprintf(key, "section.key%d", i);
+    properties_property_put_string(key, len, key, len, properties);
+  }
+  properties_property_free("section.key0", properties);
+
+  for(int i = 1; i < 1000; i++) {
+    sprintf(key, "section.key%d", i);
+    value = properties_get_value(key, properties);
+    if(value == NULL || strcmp(value, key) != 0) {
+      log_error("Wrong lookup of %s !", key);
+      global_nb_errors++;
+      ret = FUNC_FAILURE;
+    }
+  }
+  for(int i = 0; i < 10000; i++) {
+    len = sprintf(key, "missing.key%d", i);
+    nb_false_positives += bloom_may_contain(properties->bloom, hash_bytes(key, len));
+  }
+  if(properties_get_value("section.key0", properties) != NULL || nb_false_positives > 300) {
+    log_error("Wrong filter (%d false positives) !", nb_false_positives);
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+  if(properties_set_bloom_filter(properties, 0) != FUNC_SUCCESS || properties->bloom != NULL
+     || properties_get_value("section.key1", properties) == NULL) {
+    log_error("Wrong filter removal !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+  if(ret == FUNC_SUCCESS) {
+    log_info("OK !");
+  }
+
+  properties_free(properties);
+  return ret;
+}
+
+int run_handle_tests() {
+  int ret = FUNC_SUCCESS;
+  properties_handle_t first, second, missing;
+  properties_t *properties;
+
+  log_info("Testing handles...");
+  properties = properties_new();
+  if(properties == NULL) {
+    log_error("Unable to init properties !");
+    global_nb_errors++;
+    return FUNC_FAILURE;
+  }
+  properties_property_put_string("first", 5, "1", 1, properties);
+  properties_property_put_string("second", 6, "2", 1, properties);
+
+  first = properties_resolve("first", properties);
+  second = properties_resolve("second", properties);
+  missing = properties_resolve("third", properties);
+  if(strcmp(properties_get_by_handle(&second, properties), "2") != 0
+     || properties_get_by_handle(&missing, properties) != NULL) {
+    log_error("Wrong handle lookup !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+
+  /* the slot of second moves, third appears */
+  properties_property_free("first", properties);
+  properties_property_put_string("third", 5, "3", 1, properties);
+  if(properties_get_by_handle(&first, properties) != NULL
+     || strcmp(properties_get_by_handle(&second, properties), "2") != 0
+     || strcmp(properties_get_by_handle(&missing, properties), "3") != 0) {
+    log_error("Wrong stale handle lookup !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+  if(ret == FUNC_SUCCESS) {
+    log_info("OK !");
+  }
+
+  properties_free(properties);
+  return ret;
+}
+
+int run_async_tests() {
+  int ret = FUNC_SUCCESS, status;
+  properties_load_opts_t opts = {1, NULL};
+  properties_load_t *load;
+  properties_load_result_t result;
+  struct pollfd pfd;
+
+  log_info("Testing asynchronous load...");
+  if(properties_load_async("tests/several_errors.properties", &opts, &load) != FUNC_SUCCESS) {
+    log_error("Unable to start the load !");
+    global_nb_errors++;
+    return FUNC_FAILURE;
+  }
+
+  pfd.fd = properties_load_async_fd(load);
+  pfd.events = POLLIN;
+  if(poll(&pfd, 1, 10000) != 1) {
+    log_error("End of load not signaled !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+  status = properties_load_async_finish(load, &result);
+  if(status != FUNC_FAILURE || result.properties == NULL || result.nb_diagnostics != 3
+     || properties_get_value("fourth", result.properties) == NULL
+     || strcmp(result.diagnostics[0].filename, "tests/several_errors.properties") != 0) {
+    log_error("Wrong asynchronous load !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+  properties_load_result_free(&result);
+
+  if(properties_load_async("tests/missing.properties", NULL, &load) != FUNC_SUCCESS
+     || properties_load_async_finish(load, &result) != FUNC_FAILURE || result.properties != NULL) {
+    log_error("Wrong asynchronous load of a missing file !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+  properties_load_result_free(&result);
+  if(ret == FUNC_SUCCESS) {
+    log_info("OK !");
+  }
+  return ret;
+}
+
+static int count_property(char *key, int key_len, char *value, int value_len, void *ctx) {
+  if((int) strlen(key) != key_len || (int) strlen(value) != value_len) {
+    return FUNC_FAILURE;
+  }
+  (*(int *) ctx)++;
+  return FUNC_SUCCESS;
+}
+
+int run_handler_tests() {
+  int ret = FUNC_SUCCESS, nb_properties = 0;
+  properties_t *properties;
+  lexer_t *lexer;
+
+  log_info("Testing property handler...");
+  properties = properties_new();
+  if(properties == NULL) {
+    log_error("Unable to init properties !");
+    global_nb_errors++;
+    return FUNC_FAILURE;
+  }
+  lexer = lexer_new("tests/good.properties", properties);
+  if(lexer == NULL) {
+    log_error("Unable to init lexer !");
+    global_nb_errors++;
+    properties_free(properties);
+    return FUNC_FAILURE;
+  }
+
+  lexer_set_property_handler(lexer, count_property, &nb_properties);
+  if(lexer_analyze(lexer) != FUNC_SUCCESS || nb_properties != 9 || properties->size != 0) {
+    log_error("Wrong handled properties (%d) !", nb_properties);
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+  if(ret == FUNC_SUCCESS) {
+    log_info("OK !");
+  }
+
+  lexer_free(lexer);
+  properties_free(properties);
+  return ret;
+}
+
+/**
+ * Writes the types and the values of the tokens of a file, scanned by blocks of block_size bytes.
+ * @return the length of the signature, -1 if the file cannot be scanned
+ */
+static int scan_signature(char *filename, int block_size, char *signature, int size) {
+  _scanner_t *scanner;
+  _token_t *tok;
+  int len = 0, type;
+
+  scanner = scanner_new_blocks(filename, block_size, NULL);
+  if(scanner == NULL) {
+    return FUNC_FAILURE;
+  }
+  do {
+    tok = scanner_scan(scanner);
+    if(tok == NULL) {
+      len = FUNC_FAILURE;
+      break;
+    }
+    type = tok->type;
+    if(len < size) {
+      len += snprintf(signature + len, size - len, "%d:%s|", type, tok->value != NULL ? tok->value : "");
+    }
+    token_free_mem(NULL, tok);
+  } while(type != TOK_EOF);
+  if(len != FUNC_FAILURE && scanner_bytes_read(scanner) <= 0) {
+    len = FUNC_FAILURE;
+  }
+  scanner_free(scanner);
+  return len;
+}
+
+int run_reader_tests() {
+  int ret = FUNC_SUCCESS, block_sizes[] = {1, 2, 3, 7, 64}, i, len;
+  char reference[4096], signature[4096];
+
+  log_info("Testing block reader...");
+  /* tokens, escapes and continuation lines spanning blocks are scanned as with a single block */
+  if(scan_signature("tests/good.properties", READER_BLOCK_SIZE, reference, sizeof(reference)) <= 0) {
+    log_error("Unable to scan the reference !");
+    global_nb_errors++;
+    return FUNC_FAILURE;
+  }
+  for(i = 0; i < (int) (sizeof(block_sizes) / sizeof(block_sizes[0])); i++) {
+    len = scan_signature("tests/good.properties", block_sizes[i], signature, sizeof(signature));
+    if(len <= 0 || strcmp(reference, signature) != 0) {
+      log_error("Wrong tokens with blocks of %d bytes !", block_sizes[i]);
+      global_nb_errors++;
+      ret = FUNC_FAILURE;
+    }
+  }
+  if(scanner_new_blocks("tests/good.properties", 0, NULL) != NULL
+     || scanner_new_blocks("tests/_____", 16, NULL) != NULL) {
+    log_error("Wrong scanner creation !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+  if(ret == FUNC_SUCCESS) {
+    log_info("OK !");
+  }
+  return ret;
+}
+
+static int shared_matches(properties_shared_t *shared, char *key, char *value) {
+  char *found = properties_shared_get_value(key, shared);
+  return found != NULL && strcmp(found, value) == 0;
+}
+
+int run_shared_tests() {
+  int ret = FUNC_SUCCESS, i, fd, status;
+  char name[64], key[32], value[32], *put_key, *put_value;
+  properties_t *properties;
+  properties_shared_t *shared, *other;
+  pid_t pid;
+
+  log_info("Testing shared properties...");
+  properties = properties_new();
+  if(properties == NULL) {
+    log_error("Unable to init properties !");
+    global_nb_errors++;
+    return FUNC_FAILURE;
+  }
+  for(i = 0; i < 40; i++) {
+    snprintf(key, sizeof(key), "key%d", i);
+    snprintf(value, sizeof(value), "value%d", i);
+    properties_property_put_string(key, (int) strlen(key), value, (int) strlen(value), properties);
+  }
+
+  snprintf(name, sizeof(name), "/propstest.%ld", (long) getpid());
+  if(properties_publish(name, properties) != 1 || (shared = properties_attach(name)) == NULL) {
+    log_error("Unable to publish properties !");
+    global_nb_errors++;
+    properties_unpublish(name);
+    properties_free(properties);
+    return FUNC_FAILURE;
+  }
+  if(properties_shared_size(shared) != 40 || properties_shared_version(shared) != 1
+     || !shared_matches(shared, "key0", "value0") || !shared_matches(shared, "key39", "value39")
+     || properties_shared_get_value("key40", shared) != NULL || properties_shared_refresh(shared) != 0) {
+    log_error("Wrong shared lookup !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+
+  /* a new version is switched to on refresh, the attached one stays readable until then */
+  properties_property_free("key0", properties);
+  properties_property_put_string("key40", 5, "value40", 7, properties);
+  if(properties_publish(name, properties) != 2 || !shared_matches(shared, "key0", "value0")
+     || properties_shared_refresh(shared) != 1 || properties_shared_version(shared) != 2
+     || properties_shared_get_value("key0", shared) != NULL || !shared_matches(shared, "key40", "value40")) {
+    log_error("Wrong shared version switch !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+  properties_detach(shared);
+  if(properties_unpublish(name) != FUNC_SUCCESS || (other = properties_attach(name)) != NULL) {
+    log_error("Wrong unpublished properties !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+
+  /* a forked worker attaches the inherited descriptor */
+  fd = properties_publish_fd(properties);
+  pid = fd == -1 ? -1 : fork();
+  if(pid == 0) {
+    shared = properties_attach_fd(fd);
+    _exit(shared != NULL && properties_shared_size(shared) == 40 && shared_matches(shared, "key40", "value40") ? 0 : 1);
+  }
+  if(pid == -1 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    log_error("Wrong shared descriptor !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+  if(fd != -1) {
+    close(fd);
+  }
+
+  /* a value which is not a string cannot be shared */
+  put_key = malloc(7);
+  put_value = malloc(2);
+  if(put_key == NULL || put_value == NULL) {
+    free(put_key);
+    free(put_value);
+    log_error("Unable to allocate the property !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  } else {
+    strcpy(put_key, "binary");
+    strcpy(put_value, "b");
+    if(properties_property_put(put_key, put_value, NULL, properties) != FUNC_SUCCESS
+       || properties_publish(name, properties) != 0 || properties_publish_fd(properties) != -1
+       || (other = properties_attach(name)) != NULL) {
+      log_error("Published non string value !");
+      global_nb_errors++;
+      ret = FUNC_FAILURE;
+    }
+  }
+  if(ret == FUNC_SUCCESS) {
+    log_info("OK !");
+  }
+
+  properties_free(properties);
+  return ret;
+}
+
+struct change_counts {
+    int added;
+    int removed;
+    int changed;
+};
+
+static void keep_value(void *value) {
+  (void) value;
+}
+
+/* puts a value which is not a string, left to the caller */
+static int put_blob(char *blob, properties_t *properties) {
+  char *key = malloc(5);
+
+  if(key == NULL) {
+    return FUNC_FAILURE;
+  }
+  strcpy(key, "blob");
+  if(properties_property_put(key, blob, keep_value, properties) != FUNC_SUCCESS) {
+    free(key);
+    return FUNC_FAILURE;
+  }
+  return FUNC_SUCCESS;
+}
+
+static int load_file(char *filename, properties_t *properties) {
+  lexer_t *lexer = lexer_new(filename, properties);
+  int ret;
+
+  if(lexer == NULL) {
+    return FUNC_FAILURE;
+  }
+  ret = lexer_analyze(lexer);
+  lexer_free(lexer);
+  return ret;
+}
+
+static int count_added(char *key, void *old_value, void *new_value, void *ctx) {
+  (void) key;
+  ((struct change_counts *) ctx)->added += old_value == NULL && new_value != NULL;
+  return FUNC_SUCCESS;
+}
+
+static int count_removed(char *key, void *old_value, void *new_value, void *ctx) {
+  (void) key;
+  ((struct change_counts *) ctx)->removed += old_value != NULL && new_value == NULL;
+  return FUNC_SUCCESS;
+}
+
+static int count_changed(char *key, void *old_value, void *new_value, void *ctx) {
+  (void) key;
+  ((struct change_counts *) ctx)->changed += strcmp(old_value, new_value) != 0;
+  return FUNC_SUCCESS;
+}
+
+static int count_change(char *key, void *old_value, void *new_value, void *ctx) {
+  (void) key;
+  (void) old_value;
+  (void) new_value;
+  (*(int *) ctx)++;
+  return FUNC_SUCCESS;
+}
+
+int run_diff_tests() {
+  int ret = FUNC_SUCCESS, i, nb_db = 0, nb_user = 0, nb_all = 0, nb_cancelled = 0, id;
+  char key[32], value[32], blob_a[4] = {'b', 'l', 'o', 'b'}, blob_b[4] = {'b', 'l', 'o', 'b'};
+  properties_t *old_props, *new_props, *blobs[3];
+  properties_subscriptions_t *subs;
+  struct change_counts counts = {0, 0, 0};
+
+  log_info("Testing diff...");
+  old_props = properties_new();
+  new_props = properties_new();
+  subs = properties_subscriptions_new();
+  if(old_props == NULL || new_props == NULL || subs == NULL) {
+    log_error("Unable to init properties !");
+    global_nb_errors++;
+    return FUNC_FAILURE;
+  }
+  for(i = 0; i < 100; i++) {
+    snprintf(key, sizeof(key), "db.key%d", i);
+    snprintf(value, sizeof(value), "value%d", i);
+    properties_property_put_string(key, (int) strlen(key), value, (int) strlen(value), old_props);
+    /* the new version drops the first 10 keys, changes the next 5 and adds 3 */
+    if(i >= 15) {
+      properties_property_put_string(key, (int) strlen(key), value, (int) strlen(value), new_props);
+    } else if(i >= 10) {
+      properties_property_put_string(key, (int) strlen(key), "changed", 7, new_props);
+    }
+  }
+  properties_property_put_string("user", 4, "me", 2, new_props);
+  properties_property_put_string("user.name", 9, "me", 2, new_props);
+  properties_property_put_string("db.key100", 9, "value100", 8, new_props);
+
+  if(properties_diff(old_props, new_props, count_added, count_removed, count_changed, &counts) != 18
+     || counts.added != 3 || counts.removed != 10 || counts.changed != 5
+     || properties_diff(old_props, old_props, count_added, count_removed, count_changed, &counts) != 0) {
+    log_error("Wrong diff (%d added, %d removed, %d changed) !", counts.added, counts.removed, counts.changed);
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+
+  properties_subscribe_prefix("db.", count_change, &nb_db, subs);
+  properties_subscribe("user", count_change, &nb_user, subs);
+  properties_subscribe_prefix("", count_change, &nb_all, subs);
+  id = properties_subscribe("db.key11", count_change, &nb_cancelled, subs);
+  if(properties_unsubscribe(id, subs) != FUNC_SUCCESS || properties_unsubscribe(id, subs) != FUNC_FAILURE
+     || properties_notify(old_props, new_props, subs) != 18 || nb_db != 16 || nb_user != 1 || nb_all != 18
+     || nb_cancelled != 0) {
+    log_error("Wrong notifications (%d db, %d user, %d all) !", nb_db, nb_user, nb_all);
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+  properties_subscriptions_free(subs);
+  properties_free(old_props);
+  properties_free(new_props);
+
+  /* the duplicates hidden by a first occurrence are not compared */
+  old_props = properties_new();
+  new_props = properties_new();
+  if(old_props == NULL || new_props == NULL || load_file("tests/duplicate_keys.properties", old_props) != FUNC_SUCCESS
+     || load_file("tests/duplicate_keys.properties", new_props) != FUNC_SUCCESS || new_props->size != 4) {
+    log_error("Unable to load duplicate keys !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  } else if(properties_diff(old_props, new_props, count_added, count_removed, count_changed, &counts) != 0
+            || properties_diff(old_props, old_props, count_added, count_removed, count_changed, &counts) != 0) {
+    log_error("Wrong diff of duplicate keys (%d added, %d removed, %d changed) !", counts.added, counts.removed,
+              counts.changed);
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+
+  /* values which are not strings are compared by pointer */
+  blobs[0] = properties_new();
+  blobs[1] = properties_new();
+  blobs[2] = properties_new();
+  if(blobs[0] == NULL || blobs[1] == NULL || blobs[2] == NULL || put_blob(blob_a, blobs[0]) != FUNC_SUCCESS
+     || put_blob(blob_a, blobs[1]) != FUNC_SUCCESS || put_blob(blob_b, blobs[2]) != FUNC_SUCCESS) {
+    log_error("Unable to put blobs !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  } else if(properties_diff(blobs[0], blobs[1], NULL, NULL, NULL, NULL) != 0
+            || properties_diff(blobs[0], blobs[2], NULL, NULL, NULL, NULL) != 1) {
+    log_error("Wrong diff of values which are not strings !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+  for(i = 0; i < 3; i++) {
+    if(blobs[i] != NULL) {
+      properties_free(blobs[i]);
+    }
+  }
+  if(ret == FUNC_SUCCESS) {
+    log_info("OK !");
+  }
+
+  if(old_props != NULL) {
+    properties_free(old_props);
+  }
+  if(new_props != NULL) {
+    properties_free(new_props);
+  }
+  return ret;
+}
+
+int run_intern_tests() {
+  int ret = FUNC_SUCCESS, i;
+  char key[32], *url = "https://config.example.com/defaults/feature-flags";
+  properties_t *properties;
+  lexer_t *lexer;
+
+  log_info("Testing value interning...");
+  properties = properties_new();
+  if(properties == NULL || properties_set_value_interning(properties, 1) != FUNC_SUCCESS) {
+    log_error("Unable to init properties !");
+    global_nb_errors++;
+    return FUNC_FAILURE;
+  }
+  for(i = 0; i < 200; i++) {
+    snprintf(key, sizeof(key), "flag%d", i);
+    properties_property_put_string(key, (int) strlen(key), i % 2 ? "true" : "false", i % 2 ? 4 : 5, properties);
+    snprintf(key, sizeof(key), "url%d", i);
+    properties_property_put_string(key, (int) strlen(key), url, (int) strlen(url), properties);
+  }
+  if(properties->values_table->size != 3
+     || properties_get_value("flag1", properties) != properties_get_value("flag199", properties)
+     || properties_get_value("url0", properties) != properties_get_value("url199", properties)
+     || strcmp(properties_get_value("url7", properties), url) != 0
+     || strcmp(properties_get_value("flag0", properties), "false") != 0) {
+    log_error("Wrong interned values !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+
+  /* the last reference of a value removes it */
+  for(i = 0; i < 200; i += 2) {
+    snprintf(key, sizeof(key), "flag%d", i);
+    properties_property_free(key, properties);
+  }
+  if(properties->values_table->size != 2 || strcmp(properties_get_value("flag1", properties), "true") != 0) {
+    log_error("Wrong released values !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+
+  lexer = lexer_new("tests/good.properties", properties);
+  if(lexer == NULL || lexer_analyze(lexer) != FUNC_SUCCESS || strcmp(properties_get_value("test", properties), "2") != 0) {
+    log_error("Wrong interned load !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+  if(lexer != NULL) {
+    lexer_free(lexer);
+  }
+  if(ret == FUNC_SUCCESS) {
+    log_info("OK !");
+  }
+
+  properties_free(properties);
+  return ret;
+}
+
+#define ATOM_TENANTS    4
+#define ATOM_KEYS       300
+
+static void *load_tenant(void *arg) {
+  properties_t *properties = arg;
+  char key[32];
+  int i;
+
+  for(i = 0; i < ATOM_KEYS; i++) {
+    snprintf(key, sizeof(key), "tenant.key%d", i);
+    if(properties_property_put_string(key, (int) strlen(key), "v", 1, properties) != FUNC_SUCCESS) {
+      return properties;
+    }
+  }
+  return NULL;
+}
+
+int run_atom_tests() {
+  int ret = FUNC_SUCCESS, i, nb_atoms = properties_atom_count();
+  properties_t *tenants[ATOM_TENANTS], *plain;
+  pthread_t threads[ATOM_TENANTS];
+  void *failed = NULL, *result;
+  char *atom, **keys_a, **keys_b, *put_key, *put_value;
+
+  log_info("Testing key atoms...");
+  plain = properties_new();
+  for(i = 0; i < ATOM_TENANTS; i++) {
+    tenants[i] = properties_new();
+    if(tenants[i] == NULL || properties_set_key_atoms(tenants[i], 1) != FUNC_SUCCESS) {
+      log_error("Unable to init properties !");
+      global_nb_errors++;
+      return FUNC_FAILURE;
+    }
+  }
+  /* the tenants are loaded concurrently */
+  for(i = 0; i < ATOM_TENANTS; i++) {
+    pthread_create(&(threads[i]), NULL, load_tenant, tenants[i]);
+  }
+  for(i = 0; i < ATOM_TENANTS; i++) {
+    pthread_join(threads[i], &result);
+    failed = result != NULL ? result : failed;
+  }
+  load_tenant(plain);
+
+  atom = properties_atom_acquire("tenant.key42", 12);
+  properties_get_keys(&keys_a, tenants[0]);
+  properties_get_keys(&keys_b, tenants[ATOM_TENANTS - 1]);
+  if(failed != NULL || properties_atom_count() != nb_atoms + ATOM_KEYS || keys_a[7] != keys_b[7]
+     || properties_get_by_atom(atom, tenants[1]) == NULL || properties_get_by_atom(atom, plain) == NULL
+     || properties_set_key_atoms(tenants[0], 0) != FUNC_FAILURE) {
+    log_error("Wrong atoms !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+  free(keys_a);
+  free(keys_b);
+
+  properties_property_free("tenant.key42", tenants[2]);
+  if(properties_get_by_atom(atom, tenants[2]) != NULL
+     || strcmp(properties_get_by_atom(atom, tenants[3]), "v") != 0) {
+    log_error("Wrong atom lookup !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+  properties_atom_release(atom);
+
+  /* a key added as is becomes an atom too */
+  put_key = malloc(11);
+  put_value = malloc(2);
+  if(put_key == NULL || put_value == NULL) {
+    free(put_key);
+    free(put_value);
+    log_error("Unable to allocate the key !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  } else {
+    strcpy(put_key, "tenant.put");
+    strcpy(put_value, "p");
+    atom = properties_atom_acquire("tenant.put", 10);
+    if(properties_property_put(put_key, put_value, NULL, tenants[0]) != FUNC_SUCCESS
+       || properties_get_by_atom(atom, tenants[0]) != put_value
+       || properties_get_value("tenant.put", tenants[0]) != put_value) {
+      log_error("Wrong atom lookup of a put key !");
+      global_nb_errors++;
+      ret = FUNC_FAILURE;
+    }
+    properties_atom_release(atom);
+  }
+
+  for(i = 0; i < ATOM_TENANTS; i++) {
+    properties_free(tenants[i]);
+  }
+  properties_free(plain);
+  if(properties_atom_count() != nb_atoms) {
+    log_error("Atoms not released !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+  if(ret == FUNC_SUCCESS) {
+    log_info("OK !");
+  }
+  return ret;
+}
+
+int run_simple_lines_tests() {
+  int ret = FUNC_SUCCESS, i;
+  properties_t *properties;
+  lexer_t *lexer = NULL;
+  properties_stats_t stats;
+  char *value;
+  char *expected[][2] = {
+    {"name", "value"},
+    {"spaced", ": a value with = inside  "},
+    {"assign", "= value"},
+    {"escaped", "a\\tb"},
+    {"last", "1"}
+  };
+
+  log_info("Testing simple lines...");
+  properties = properties_new();
+  if(properties == NULL) {
+    log_error("Unable to init properties !");
+    global_nb_errors++;
+    return FUNC_FAILURE;
+  }
+
+  /* the file ends with a comment without line terminator */
+  lexer = lexer_new("tests/simple_lines.properties", properties);
+  if(lexer == NULL || lexer_analyze(lexer) != FUNC_SUCCESS || properties->size != 5) {
+    log_error("Analysis failed !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+    goto free_properties;
+  }
+  for(i = 0; i < 5; i++) {
+    value = properties_get_value(expected[i][0], properties);
+    if(value == NULL || strcmp(value, expected[i][1]) != 0) {
+      log_error("Wrong value for %s : '%s' !", expected[i][0], value == NULL ? "(null)" : value);
+      global_nb_errors++;
+      ret = FUNC_FAILURE;
+    }
+  }
+
+  /* every line but the escaped one and the last comment is read at once */
+  lexer_get_stats(lexer, &stats);
+  if(stats.lines != 10 || stats.simple_lines != 9 || stats.escapes_decoded != 1) {
+    log_error("Unexpected statistics : %llu lines, %llu simple !", stats.lines, stats.simple_lines);
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+  if(ret == FUNC_SUCCESS) {
+    log_info("OK !");
+  }
+
+free_properties:
+  if(lexer != NULL) {
+    lexer_free(lexer);
+  }
+  properties_free(properties);
+  return ret;
+}
+
+/**
+ * Checks the values of the generated properties key.0 to key.(nb - 1), and of a property of good.properties.
+ * @return 0 if all values are found, -1 otherwise
+ */
+static int check_generated(properties_t *properties, int nb) {
+  char key[32], value[64];
+  char *found;
+  int i;
+
+  for(i = 0; i < nb; i++) {
+    snprintf(key, sizeof(key), "key.%d", i);
+    snprintf(value, sizeof(value), "a value long enough to be allocated apart %d", i);
+    found = properties_get_value(key, properties);
+    if(found == NULL || strcmp(found, value) != 0) {
+      return FUNC_FAILURE;
+    }
+  }
+  found = properties_get_value("user", properties);
+  return found != NULL && strcmp(found, "Crunchify") == 0 ? FUNC_SUCCESS : FUNC_FAILURE;
+}
+
+int run_compact_tests() {
+  int ret = FUNC_SUCCESS, i;
+  properties_t *properties;
+  properties_memory_t before, after;
+  properties_handle_t handle;
+  lexer_t *lexer;
+  char key[32], value[64];
+
+  log_info("Testing memory usage and compaction...");
+  properties = properties_new();
+  if(properties == NULL) {
+    log_error("Unable to init properties !");
+    global_nb_errors++;
+    return FUNC_FAILURE;
+  }
+  properties_set_bloom_filter(properties, 0.01);
+  lexer = lexer_new("tests/good.properties", properties);
+  if(lexer == NULL || lexer_analyze(lexer) != FUNC_SUCCESS) {
+    log_error("Analysis failed !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+    goto free_lexer;
+  }
+  for(i = 0; i < 40; i++) {
+    snprintf(key, sizeof(key), "key.%d", i);
+    snprintf(value, sizeof(value), "a value long enough to be allocated apart %d", i);
+    properties_property_put_string(key, (int) strlen(key), value, (int) strlen(value), properties);
+  }
+  handle = properties_resolve("key.3", properties);
+
+  properties_memory_usage(properties, &before);
+  if(properties_compact(properties) != FUNC_SUCCESS) {
+    log_error("Compaction failed !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+    goto free_lexer;
+  }
+  properties_memory_usage(properties, &after);
+  log_info("before : index %zu, nodes %zu, keys %zu, values %zu, slack %zu, total %zu", before.index, before.nodes,
+           before.keys, before.values, before.slack, before.total);
+  log_info("after : index %zu, nodes %zu, keys %zu, values %zu, slack %zu, total %zu", after.index, after.nodes,
+           after.keys, after.values, after.slack, after.total);
+  /* the same nodes and strings, only the padding of the nodes left */
+  if(before.total != before.index + before.nodes + before.keys + before.values + before.slack || before.slack == 0
+     || after.nodes != before.nodes || after.keys != before.keys || after.values != before.values
+     || after.slack >= sizeof(void *) * properties->size || after.total >= before.total) {
+    log_error("Unexpected memory usage !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+  if(check_generated(properties, 40) != FUNC_SUCCESS || handle.generation == properties->generation
+     || strcmp(properties_get_by_handle(&handle, properties), "a value long enough to be allocated apart 3") != 0) {
+    log_error("Wrong values once compacted !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+
+  /* still modifiable : the arrays move out of the block, a removal leaves room in it */
+  properties_property_put_string("added", 5, "after compaction", 16, properties);
+  properties_property_free("key.39", properties);
+  if(check_generated(properties, 39) != FUNC_SUCCESS || properties_get_value("key.39", properties) != NULL
+     || strcmp(properties_get_value("added", properties), "after compaction") != 0) {
+    log_error("Wrong values once modified !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+  properties_memory_usage(properties, &after);
+  if(after.slack < before.slack / 2 || properties_compact(properties) != FUNC_SUCCESS
+     || check_generated(properties, 39) != FUNC_SUCCESS
+     || strcmp(properties_get_value("added", properties), "after compaction") != 0) {
+    log_error("Wrong values once compacted again !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+  if(ret == FUNC_SUCCESS) {
+    log_info("OK !");
+  }
+
+free_lexer:
+  if(lexer != NULL) {
+    lexer_free(lexer);
+  }
+  properties_free(properties);
+  return ret;
+}
+
+/**
+ * Replaces the content of a file.
+ * @return 0 if succeeded, -1 otherwise
+ */
+static int write_file(char *filename, char *content) {
+  FILE *file = fopen(filename, "w");
+
+  if(file == NULL) {
+    return FUNC_FAILURE;
+  }
+  fputs(content, file);
+  return fclose(file) == 0 ? FUNC_SUCCESS : FUNC_FAILURE;
+}
+
+int run_cache_tests() {
+  int ret = FUNC_SUCCESS;
+  properties_t *first, *second, *old, *new;
+  char filename[64];
+
+  log_info("Testing parse cache...");
+  first = properties_cache_load("tests/good.properties");
+  second = properties_cache_load("tests/good.properties");
+  if(first == NULL || second != first || properties_cache_count() != 1
+     || strcmp(properties_get_value("user", first), "Crunchify") != 0
+     || properties_property_put_string("other", 5, "1", 1, first) != FUNC_FAILURE) {
+    log_error("Wrong shared snapshot !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+  /* still cached once released */
+  properties_cache_release(first);
+  properties_cache_release(second);
+  second = properties_cache_load("tests/good.properties");
+  if(second != first || properties_cache_load("tests/no_value.properties") != NULL) {
+    log_error("Wrong cached snapshot !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+
+  /* a modified file is parsed again, the old snapshot staying valid until released */
+  snprintf(filename, sizeof(filename), "/tmp/propscache.%d", (int) getpid());
+  if(write_file(filename, "a=1\n") != FUNC_SUCCESS) {
+    log_error("Unable to create %s !", filename);
+    global_nb_errors++;
+    properties_cache_release(second);
+    return FUNC_FAILURE;
+  }
+  old = properties_cache_load(filename);
+  write_file(filename, "a=22\n");
+  new = properties_cache_load(filename);
+  if(old == NULL || new == NULL || new == old || properties_cache_count() != 2
+     || strcmp(properties_get_value("a", old), "1") != 0 || strcmp(properties_get_value("a", new), "22") != 0) {
+    log_error("Wrong snapshot of a modified file !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+  if(old != NULL) {
+    properties_cache_release(old);
+  }
+  if(new != NULL) {
+    properties_cache_release(new);
+  }
+  properties_cache_release(second);
+  properties_cache_clear();
+  if(properties_cache_count() != 0) {
+    log_error("Cache not cleared !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+  unlink(filename);
+  if(ret == FUNC_SUCCESS) {
+    log_info("OK !");
+  }
+  return ret;
+}
+
+int run_iter_tests() {
+  int ret = FUNC_SUCCESS, nb = 0, key_len, status;
+  properties_t *properties;
+  properties_iter_t iter;
+  char *key;
+  void *value;
+  struct counting_allocator counter = {0, 0};
+  properties_allocator_t allocator = {counting_alloc, counting_realloc, counting_free, NULL};
+
+  log_info("Testing iterator...");
+  allocator.ctx = &counter;
+  properties = properties_new_with_allocator(&allocator);
+  if(properties == NULL) {
+    log_error("Unable to init properties !");
+    global_nb_errors++;
+    return FUNC_FAILURE;
+  }
+  properties_property_put_string("first", 5, "1", 1, properties);
+  properties_property_put_string("second", 6, "2", 1, properties);
+  properties_property_put_string("third", 5, "3", 1, properties);
+
+  /* in insertion order, without allocation */
+  counter.nb_alloc = 0;
+  properties_iter_begin(&iter, properties);
+  while((status = properties_iter_next(&iter, &key, &key_len, &value, properties)) == 1) {
+    if(key != properties->keys[nb] || key_len != (int) strlen(key) || value != properties_get_value(key, properties)) {
+      break;
+    }
+    nb++;
+  }
+  if(status != 0 || nb != 3 || counter.nb_alloc != 0) {
+    log_error("Wrong iteration (%d properties) !", nb);
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+
+  /* a modification ends the iteration */
+  properties_iter_begin(&iter, properties);
+  properties_iter_next(&iter, NULL, NULL, NULL, properties);
+  properties_property_free("first", properties);
+  if(properties_iter_next(&iter, &key, NULL, NULL, properties) != FUNC_FAILURE) {
+    log_error("Iteration not stopped by a modification !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  }
+  if(ret == FUNC_SUCCESS) {
+    log_info("OK !");
+  }
+
+  properties_free(properties);
+  return ret;
+}
+
+int run_step_tests() {
+  int ret = FUNC_SUCCESS, status, nb_steps = 0;
+  properties_t *properties;
+  lexer_t *lexer;
+  properties_stats_t stats;
+
+  log_info("Testing analysis by steps...");
+  properties = properties_new();
+  if(properties == NULL) {
+    log_error("Unable to init properties !");
+    global_nb_errors++;
+    return FUNC_FAILURE;
+  }
+  lexer = lexer_new("tests/good.properties", properties);
+  if(lexer == NULL) {
+    log_error("Unable to init lexer !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+    goto free_properties;
+  }
+
+  /* a step ends with the line or token reaching its size */
+  while((status = lexer_analyze_step(lexer, 16)) == 1) {
+    nb_steps++;
+  }
+  lexer_get_stats(lexer, &stats);
+  if(status != FUNC_SUCCESS || nb_steps < 5 || properties->size != 9
+     || strcmp(properties_get_value("test", properties), "2") != 0) {
+    log_error("Analysis by steps failed (%d steps) !", nb_steps);
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  } else if(stats.loads != 1 || stats.lines != 13 || properties->stats.loads != 1) {
+    log_error("Wrong statistics after %d steps !", nb_steps);
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+  } else {
+    log_info("OK !");
+  }
+  lexer_free(lexer);
+
+free_properties:
+  properties_free(properties);
+  return ret;
+}
+
+static int lookup_times(char *key, int nb, properties_t *properties) {
+  int i, nb_found = 0;
+
+  for(i = 0; i < nb; i++) {
+    nb_found += properties_get_value(key, properties) != NULL;
+  }
+  return nb_found;
+}
+
+int run_layout_tests() {
+  int ret = FUNC_SUCCESS, i;
+  properties_t *properties;
+  properties_access_t accesses[3];
+  properties_handle_t handle;
+  char key[32], value[32];
+
+  log_info("Testing access counts and layout...");
+  properties = properties_new();
+  if(properties == NULL) {
+    log_error("Unable to init properties !");
+    global_nb_errors++;
+    return FUNC_FAILURE;
+  }
+  for(i = 0; i < 100; i++) {
+    snprintf(key, sizeof(key), "key%d", i);
+    snprintf(value, sizeof(value), "value %d", i);
+    if(properties_property_put_string(key, strlen(key), value, strlen(value), properties) != FUNC_SUCCESS) {
+      log_error("Unable to add %s !", key);
+      global_nb_errors++;
+      ret = FUNC_FAILURE;
+      goto free_properties;
+    }
+  }
+  /* a duplicate, hidden by the first key3 */
+  properties_property_put_string("key3", 4, "hidden", 6, properties);
+
+  if(properties_optimize_layout(properties) != FUNC_FAILURE || properties_set_access_sampling(properties, 3) != FUNC_FAILURE
+     || properties_set_access_sampling(properties, 1) != FUNC_SUCCESS) {
+    log_error("Wrong sampling settings !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+    goto free_properties;
+  }
+  handle = properties_resolve("key99", properties);
+  lookup_times("key57", 1000, properties);
+  lookup_times("key3", 500, properties);
+  for(i = 0; i < 10; i++) {
+    properties_get_by_handle(&handle, properties);
+  }
+  lookup_times("missing", 100, properties);
+
+  if(properties_hot_keys(accesses, 3, properties) != 3 || strcmp(accesses[0].key, "key57") != 0
+     || accesses[0].count != 1000 || strcmp(accesses[1].key, "key3") != 0 || accesses[1].count != 500
+     || strcmp(accesses[2].key, "key99") != 0 || accesses[2].count != 10) {
+    log_error("Wrong access counts !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+    goto free_properties;
+  }
+
+  /* the hot keys move first, the counts with them, the compacted nodes too */
+  if(properties_compact(properties) != FUNC_SUCCESS || properties_optimize_layout(properties) != FUNC_SUCCESS
+     || properties_find_slot("key57", 5, hash_bytes("key57", 5), properties) != 0
+     || properties_find_slot("key3", 4, hash_bytes("key3", 4), properties) != 1
+     || properties_hot_keys(accesses, 3, properties) != 3 || accesses[2].count != 10
+     || (char *) properties->contents[0] > (char *) properties->contents[1]
+     || (char *) properties->contents[1] > (char *) properties->contents[2]
+     || (char *) properties->contents[0] < properties->packed) {
+    log_error("Wrong optimized layout !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+    goto free_properties;
+  }
+  for(i = 0; i < 100; i++) {
+    snprintf(key, sizeof(key), "key%d", i);
+    snprintf(value, sizeof(value), "value %d", i);
+    if(properties_get_value(key, properties) == NULL || strcmp(properties_get_value(key, properties), value) != 0) {
+      log_error("Wrong value for %s after optimizing !", key);
+      global_nb_errors++;
+      ret = FUNC_FAILURE;
+      goto free_properties;
+    }
+  }
+  if(strcmp(properties_get_by_handle(&handle, properties), "value 99") != 0) {
+    log_error("Wrong handle after optimizing !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+    goto free_properties;
+  }
+
+  /* the removed key takes its count away, the sampled lookups are estimated */
+  properties_property_free("key57", properties);
+  properties_set_access_sampling(properties, 16);
+  lookup_times("key42", 16000, properties);
+  if(properties_hot_keys(accesses, 1, properties) != 1 || strcmp(accesses[0].key, "key42") != 0
+     || accesses[0].count < 12000 || accesses[0].count > 20000) {
+    log_error("Wrong sampled counts !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+    goto free_properties;
+  }
+  properties_freeze(properties);
+  if(properties_optimize_layout(properties) != FUNC_FAILURE) {
+    log_error("Frozen properties optimized !");
+    global_nb_errors++;
+    ret = FUNC_FAILURE;
+    goto free_properties;
+  }
+  log_info("OK !");
+
+free_properties:
+  properties_free(properties);
+  return ret;
+}
+
 int main() {
   int ret = 0;
   ret = prepare();
   if(ret == FUNC_SUCCESS) {
     ret = run_tests();
   }
+  if(ret == FUNC_SUCCESS) {
+    ret = run_recovery_tests();
+  }
+  if(ret == FUNC_SUCCESS) {
+    ret = run_profile_tests();
+  }
+  if(ret == FUNC_SUCCESS) {
+    ret = run_stats_tests();
+  }
+  if(ret == FUNC_SUCCESS) {
+    ret = run_allocator_tests();
+  }
+  if(ret == FUNC_SUCCESS) {
+    ret = run_oom_tests();
+  }
+  if(ret == FUNC_SUCCESS) {
+    ret = run_index_tests();
+  }
+  if(ret == FUNC_SUCCESS) {
+    ret = run_sorted_tests();
+  }
+  if(ret == FUNC_SUCCESS) {
+    ret = run_bloom_tests();
+  }
+  if(ret == FUNC_SUCCESS) {
+    ret = run_handler_tests();
+  }
+  if(ret == FUNC_SUCCESS) {
+    ret = run_handle_tests();
+  }
+  if(ret == FUNC_SUCCESS) {
+    ret = run_async_tests();
+  }
+  if(ret == FUNC_SUCCESS) {
+    ret = run_reader_tests();
+  }
+  if(ret == FUNC_SUCCESS) {
+    ret = run_shared_tests();
+  }
+  if(ret == FUNC_SUCCESS) {
+    ret = run_diff_tests();
+  }
+  if(ret == FUNC_SUCCESS) {
+    ret = run_intern_tests();
+  }
+  if(ret == FUNC_SUCCESS) {
+    ret = run_atom_tests();
+  }
+  if(ret == FUNC_SUCCESS) {
+    ret = run_simple_lines_tests();
+  }
+  if(ret == FUNC_SUCCESS) {
+    ret = run_compact_tests();
+  }
+  if(ret == FUNC_SUCCESS) {
+    ret = run_cache_tests();
+  }
+  if(ret == FUNC_SUCCESS) {
+    ret = run_iter_tests();
+  }
+  if(ret == FUNC_SUCCESS) {
+    ret = run_step_tests();
+  }
+  if(ret == FUNC_SUCCESS) {
+    ret = run_layout_tests();
+  }
   return ret;
 }
@@ -0,0 +1,307 @@
+/*
+ * Filename:  test.cpp
+ *
+ * Description:  Tests of the C++ interface.
+ *
+ * Copyright (c) 2017 Erwann Miriel, erwann.miriel@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <coroutine>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "include/properties.hpp"
+#include "include/properties_static.hpp"
+#include "include/properties_async.hpp"
+
+extern "C" {
+#include <unistd.h>
+
+#include "include/logging.h"
+}
+
+static int global_nb_errors = 0;
+
+static void info(const char *message) {
+  log_info(const_cast<char *>("%s"), message);
+}
+
+static int fail(const char *message) {
+  log_error(const_cast<char *>("%s"), message);
+  global_nb_errors++;
+  return -1;
+}
+
+int run_hpp_tests() {
+  props::Properties properties;
+  std::string key = "company1.suffix";
+  int nb = 0;
+
+  info("Testing C++ interface...");
+  if(!properties || !properties.load("tests/good.properties") || properties.size() != 9) {
+    return fail("Analysis failed !");
+  }
+
+  /* a key taken from a larger string, without terminating NUL */
+  if(properties.get<std::string_view>(std::string_view(key).substr(0, 8)) != std::string_view("Google")
+     || properties.find(std::string_view(key).substr(0, 9)) != nullptr || !properties.contains("test")) {
+    return fail("Wrong string_view lookups !");
+  }
+
+  if(properties.get<int>("test") != 2 || properties.get<double>("test") != 2.0 || properties.get<bool>("user")
+     || properties.get<int>("user") || properties.get<long>("missing", 7L) != 7
+     || properties.get<std::string>("company2") != std::string("eBay")) {
+    return fail("Wrong converted values !");
+  }
+
+  for(auto [name, value] : properties) {
+    if(properties.find(name) != value) {
+      return fail("Wrong iteration !");
+    }
+    nb++;
+  }
+  if(nb != 9) {
+    return fail("Wrong number of iterated properties !");
+  }
+
+  /* the ownership moves, the moved-from holder is empty */
+  props::Properties moved = std::move(properties);
+  if(properties || !moved || !moved.put("added", "yes") || moved.get<bool>("added").value_or(false)) {
+    return fail("Wrong moved holder !");
+  }
+  if(moved.get<std::string_view>("added") != std::string_view("yes")) {
+    return fail("Wrong added value !");
+  }
+
+  props::Properties failing;
+  props::Lexer lexer("tests/no_value.properties", failing);
+  if(!lexer || lexer.analyze()) {
+    return fail("Wrong failing analysis !");
+  }
+
+  info("OK !");
+  return 0;
+}
+
+/* the text of tests/good.properties */
+static constexpr auto good = props::parse<"#Crunchify properties_t\n"
+                                          "user=Crunchify\n"
+                                          "company1=Google\n"
+                                          "company2=eBay\n"
+                                          "company3=Yahoo\\u25631589 dsf\n"
+                                          "#Fri Jan 17 22:37:45 MYT 2014\n"
+                                          "dbpassword=password\n"
+                                          "database=localhost\\v\n"
+                                          "dbuser=mkyong\\u4561\\u451\\u781\\u789456\n"
+                                          "\n"
+                                          "patate12338- = sdgfjkhdskfjghfdsfkqsnfkdsjfnjn \\\n"
+                                          "dgkjh\t\tfdkjdflksdjfklj\t\t\\\n"
+                                          "dfjdsfldjksfmlj\n"
+                                          "test=2">();
+
+/* separators, comments, CRLF, a duplicate key and a value ending the text */
+static constexpr auto defaults = props::parse<"  host : localhost\r\n"
+                                              "port 8080\n"
+                                              "! a comment\n"
+                                              "spaced = = value # kept\n"
+                                              "port=9090\n"
+                                              "ratio=0.5">();
+
+static_assert(good.size() == 9 && defaults.size() == 4);
+static_assert(good.contains("patate12338-") && !good.contains("patate12338") && !good.contains(""));
+static_assert(std::string_view(defaults.find("port")) == "8080");
+static_assert(std::string_view(defaults.find("spaced")) == "= = value  kept");
+static_assert(props::parse<"">().size() == 0 && props::parse<"# only a comment">().find("a") == nullptr);
+
+int run_static_tests() {
+  props::Properties properties;
+  props::Properties merged;
+  int nb = 0;
+
+  info("Testing compile-time parsing...");
+  if(!properties || !properties.load("tests/good.properties") || properties.size() != good.size()) {
+    return fail("Analysis failed !");
+  }
+
+  /* the same values as the lexer */
+  for(auto [name, value] : properties) {
+    if(good.find(name) == nullptr || std::strcmp(good.find(name), value) != 0) {
+      return fail("Wrong compile-time value !");
+    }
+  }
+  for(auto [name, value] : good) {
+    if(good.find(name) != value || !properties.contains(name)) {
+      return fail("Wrong iteration !");
+    }
+    nb++;
+  }
+  if(nb != 9) {
+    return fail("Wrong number of iterated properties !");
+  }
+
+  if(defaults.get<std::string_view>("host") != std::string_view(": localhost") || defaults.get<int>("port") != 8080
+     || defaults.get<double>("ratio") != 0.5 || defaults.get<int>("missing", 3) != 3) {
+    return fail("Wrong converted values !");
+  }
+
+  if(!merged || !defaults.put_into(merged) || merged.size() != 4 || merged.get<int>("port") != 8080) {
+    return fail("Wrong copied defaults !");
+  }
+
+  info("OK !");
+  return 0;
+}
+
+/* single threaded executor : runs the scheduled coroutines in turn */
+struct RunLoop {
+    std::deque<std::coroutine_handle<>> ready;
+    int nb_scheduled = 0;
+
+    struct awaiter {
+        RunLoop &loop;
+
+        bool await_ready() const noexcept {
+          return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle) {
+          loop.ready.push_back(handle);
+          loop.nb_scheduled++;
+        }
+
+        void await_resume() const noexcept {
+        }
+    };
+
+    awaiter schedule() {
+      return awaiter{*this};
+    }
+
+    /* runs at most nb coroutines, -1 for all */
+    void run(int nb = -1) {
+      while(!ready.empty() && nb-- != 0) {
+        std::coroutine_handle<> handle = ready.front();
+        ready.pop_front();
+        handle.resume();
+      }
+    }
+};
+
+/* coroutine started at once, and never awaited */
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() noexcept {
+          return {};
+        }
+
+        std::suspend_never initial_suspend() const noexcept {
+          return {};
+        }
+
+        std::suspend_never final_suspend() const noexcept {
+          return {};
+        }
+
+        void return_void() const noexcept {
+        }
+
+        void unhandled_exception() const noexcept {
+          std::terminate();
+        }
+    };
+};
+
+static Detached load_into(const char *filename, RunLoop &loop, props::load_options options,
+                          props::load_result &result) {
+  result = co_await props::load_async(filename, loop, std::move(options));
+}
+
+static bool write_lines(const char *filename, int nb) {
+  FILE *file = std::fopen(filename, "w");
+
+  if(file == nullptr) {
+    return false;
+  }
+  for(int i = 0; i < nb; i++) {
+    std::fprintf(file, "key%d=value %d\n", i, i);
+  }
+  return std::fclose(file) == 0;
+}
+
+int run_async_tests() {
+  RunLoop loop;
+  props::load_result good, many, missing, failing, cancelled;
+  props::load_options options;
+  std::stop_source stop;
+  std::string filename = "/tmp/propsasync." + std::to_string(getpid());
+
+  info("Testing coroutine loads...");
+  if(!write_lines(filename.c_str(), 1000)) {
+    return fail("Unable to write the file !");
+  }
+
+  /* the loads run in turn on the loop, by steps of about a line */
+  options.step_size = 16;
+  load_into("tests/good.properties", loop, options, good);
+  load_into(filename.c_str(), loop, options, many);
+  load_into("tests/missing.properties", loop, options, missing);
+  load_into("tests/no_value.properties", loop, options, failing);
+  loop.run();
+  std::remove(filename.c_str());
+  if(!good || good.properties.size() != 9 || good.properties.get<int>("test") != 2) {
+    return fail("Wrong coroutine load !");
+  }
+  if(!many || many.properties.size() != 1000 || many.properties.get<std::string_view>("key999") != "value 999") {
+    return fail("Wrong concurrent load !");
+  }
+  if(missing || missing.properties.size() != 0 || failing.status != props::load_status::failed || !failing.properties) {
+    return fail("Wrong failed loads !");
+  }
+  if(loop.nb_scheduled < 100) {
+    return fail("Loads not interleaved !");
+  }
+
+  /* cancelled between two steps */
+  options.stop = stop.get_token();
+  load_into("tests/good.properties", loop, options, cancelled);
+  loop.run(2);
+  stop.request_stop();
+  loop.run();
+  if(cancelled.status != props::load_status::cancelled || cancelled.properties) {
+    return fail("Wrong cancelled load !");
+  }
+
+  info("OK !");
+  return 0;
+}
+
+int main() {
+  run_hpp_tests();
+  run_static_tests();
+  run_async_tests();
+  if(global_nb_errors > 0) {
+    log_error(const_cast<char *>("%d errors"), global_nb_errors);
+    return 1;
+  }
+  info("All C++ tests succeeded !");
+  return 0;
+}
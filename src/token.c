@@ -25,12 +25,12 @@
 #include "include/scanner.h"
 #include "include/utils.h"
 
-static int copy_tok_value(char **p_dest, int *p_dest_size, _token_t *tok) {
+static int copy_tok_value(_memctx_t *mem, char **p_dest, int *p_dest_size, _token_t *tok) {
   int deref_dest_size;
   char * dest;
 
   deref_dest_size = tok->size;
-  dest = malloc(deref_dest_size * sizeof(dest));
+  dest = mem_malloc(mem, deref_dest_size * sizeof(*dest));
   if(dest == NULL) {
     return FUNC_FAILURE;
   }
@@ -41,7 +41,7 @@ static int copy_tok_value(char **p_dest, int *p_dest_size, _token_t *tok) {
   return FUNC_SUCCESS;
 }
 
-static int append_tok_value(char **p_dest, int *p_dest_size, _token_t *tok) {
+static int append_tok_value(_memctx_t *mem, char **p_dest, int *p_dest_size, _token_t *tok) {
   int deref_dest_size;
 
   int cur_size;
@@ -52,7 +52,7 @@ static int append_tok_value(char **p_dest, int *p_dest_size, _token_t *tok) {
   cur_size = deref_dest_size - 1;/* because of '\0' at the end of EACH string */
   deref_dest_size += tok->size - 1; /* because of '\0' at the end of EACH string */
 
-  new_dest = realloc(*p_dest, deref_dest_size * sizeof(**p_dest));
+  new_dest = mem_realloc(mem, *p_dest, deref_dest_size * sizeof(**p_dest));
   if(new_dest == NULL) {
     return FUNC_FAILURE;
   }
@@ -63,19 +63,20 @@ static int append_tok_value(char **p_dest, int *p_dest_size, _token_t *tok) {
   return FUNC_SUCCESS;
 }
 
-_token_t * token_new(int nb_chars) {
+_token_t * token_new_mem(_memctx_t *mem, int nb_chars) {
   int size = 0;
 
-  _token_t *tok = malloc(sizeof(_token_t));
+  _token_t *tok = mem_malloc(mem, sizeof(_token_t));
   if (tok == NULL) {
     return NULL;
   }
 
+  tok->value = NULL;
   if (nb_chars > 0) {
     size = nb_chars + NULL_CHAR_OFFSET;
-    tok->value = malloc(sizeof(char) * size);
+    tok->value = mem_malloc(mem, sizeof(char) * size);
     if (tok->value == NULL) {
-      free(tok);
+      mem_free(mem, tok);
       return NULL;
     }
   }
@@ -84,11 +85,19 @@ _token_t * token_new(int nb_chars) {
   return tok;
 }
 
-void token_free(_token_t * tok) {
+_token_t * token_new(int nb_chars) {
+  return token_new_mem(NULL, nb_chars);
+}
+
+void token_free_mem(_memctx_t *mem, _token_t * tok) {
   if(tok->value != NULL) {
-    free(tok->value);
+    mem_free(mem, tok->value);
   }
-  free(tok);
+  mem_free(mem, tok);
+}
+
+void token_free(_token_t * tok) {
+  token_free_mem(NULL, tok);
 }
 
 int token_print(char *str, _token_t token) {
@@ -110,9 +119,13 @@ int token_print(char *str, _token_t token) {
   return ret;
 }
 
-int copy_or_append_token(char **p_element_value, int *p_element_size, _token_t *p_tok) {
+int copy_or_append_token_mem(_memctx_t *mem, char **p_element_value, int *p_element_size, _token_t *p_tok) {
   if((*p_element_size) == 0) {
-    return copy_tok_value(p_element_value, p_element_size, p_tok);
+    return copy_tok_value(mem, p_element_value, p_element_size, p_tok);
   }
-  return append_tok_value(p_element_value, p_element_size, p_tok);
+  return append_tok_value(mem, p_element_value, p_element_size, p_tok);
+}
+
+int copy_or_append_token(char **p_element_value, int *p_element_size, _token_t *p_tok) {
+  return copy_or_append_token_mem(NULL, p_element_value, p_element_size, p_tok);
 }
\ No newline at end of file
@@ -19,11 +19,15 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
  
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdarg.h>
 #include <stddef.h>
 #include <malloc.h>
+#include <time.h>
 
 #include "include/utils.h"
+#include "include/memctx.h"
 #include "include/logging.h"
 
 int check_null(int nb_args, ...) {
@@ -44,7 +48,7 @@ int check_null(int nb_args, ...) {
 
 int inflate(void **inflatable, int new_size, size_t ptrsize) {
   void * new_inflatable;
-  new_inflatable = realloc(*inflatable, new_size * ptrsize);
+  new_inflatable = mem_realloc(NULL, *inflatable, new_size * ptrsize);
   if(new_inflatable == NULL) {
     log_error("inflate");
     return FUNC_FAILURE;
@@ -54,16 +58,36 @@ int inflate(void **inflatable, int new_size, size_t ptrsize) {
 }
 
 int manage_size(void ** inflatable, int cur_size, int *p_max_size, int step, size_t ptrsize) {
-  int ret = FUNC_SUCCESS;
-  int max_size;
+  return mem_manage_size(NULL, inflatable, cur_size, p_max_size, step, ptrsize);
+}
 
-  max_size = *p_max_size;
-  if(cur_size == max_size) {
-    ret = inflate(inflatable, max_size + step, ptrsize) != FUNC_SUCCESS;
-    if(ret == FUNC_SUCCESS) {
-      max_size += step;
-    }
+#define FNV_OFFSET  2166136261u
+#define FNV_PRIME   16777619u
+
+unsigned int hash_string(const char *str, int *p_len) {
+  unsigned int hash = FNV_OFFSET;
+  const char *cur = str;
+
+  while(*cur != '\0') {
+    hash = (hash ^ (unsigned char) *cur) * FNV_PRIME;
+    cur++;
+  }
+  *p_len = (int) (cur - str);
+  return hash;
+}
+
+unsigned int hash_bytes(const char *bytes, int len) {
+  unsigned int hash = FNV_OFFSET;
+  int i;
+
+  for(i = 0; i < len; i++) {
+    hash = (hash ^ (unsigned char) bytes[i]) * FNV_PRIME;
   }
-  *p_max_size = max_size;
-  return ret;
+  return hash;
+}
+
+long long time_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
 }
@@ -0,0 +1,336 @@
+/*
+ * Filename:  bench.c
+ *
+ * Description:  Benchmark tool.
+ * Loads a properties file (a generated one by default), then times lookups of present keys (one by one,
+ * by batches and by resolved handles) and of absent keys.
+ * With -p, the profiler reports the counters of each phase.
+ * With -b, the properties have a bloom filter of the given false positive rate.
+ * With -s, the lookups of the frozen (Eytzinger ordered) properties are compared with a binary search
+ * of a plain sorted array of the keys.
+ *
+ * Copyright (c) 2017 Erwann Miriel, erwann.miriel@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "lexer.h"
+#include "profile.h"
+#include "utils.h"
+#include "logging.h"
+
+#define DEFAULT_NB_KEYS     2000
+#define DEFAULT_NB_LOOKUPS  100000
+#define KEY_SIZE            64
+#define NB_MISSING          1024
+#define BATCH_SIZE          32
+
+/* spreads the lookups over the keys */
+#define LOOKUP_KEY(keys, i, nb_keys)    ((keys)[(long long) (i) * 7919 % (nb_keys)])
+
+static char generated[] = "/tmp/propsbench_XXXXXX";
+
+/**
+ * Writes a properties file of nb_keys keys.
+ * @param nb_keys number of keys
+ * @return the name of the file if succeeded, NULL otherwise
+ */
+static char *generate_file(int nb_keys) {
+  int fd, i;
+  FILE *file;
+
+  fd = mkstemp(generated);
+  if(fd == -1) {
+    log_error("mkstemp");
+    return NULL;
+  }
+  file = fdopen(fd, "w");
+  if(file == NULL) {
+    close(fd);
+    log_error("fdopen");
+    return NULL;
+  }
+
+  fprintf(file, "# generated by propsbench\n");
+  for(i = 0; i < nb_keys; i++) {
+    fprintf(file, "section%d.option%d=value_%d\n", i % 97, i, i * 7);
+  }
+  fclose(file);
+  return generated;
+}
+
+static int compare_keys(const void *a, const void *b) {
+  return strcmp(*(char * const *) a, *(char * const *) b);
+}
+
+/**
+ * Times the lookups of the frozen properties against bsearch on a sorted copy of the keys.
+ * @param properties the properties
+ * @param keys the keys
+ * @param nb_keys number of keys
+ * @param nb_lookups number of lookups
+ */
+static void bench_sorted(properties_t *properties, char **keys, int nb_keys, int nb_lookups) {
+  char **sorted, *key;
+  long long start, plain_ns, eytzinger_ns;
+  int i, nb_found = 0;
+
+  sorted = malloc(nb_keys * sizeof(*sorted));
+  if(sorted == NULL || properties_freeze(properties) != FUNC_SUCCESS) {
+    log_error("cannot sort the keys");
+    free(sorted);
+    return;
+  }
+  memcpy(sorted, keys, nb_keys * sizeof(*sorted));
+  qsort(sorted, nb_keys, sizeof(*sorted), compare_keys);
+
+  start = time_ns();
+  for(i = 0; i < nb_lookups; i++) {
+    key = LOOKUP_KEY(keys, i, nb_keys);
+    nb_found += bsearch(&key, sorted, nb_keys, sizeof(*sorted), compare_keys) != NULL;
+  }
+  plain_ns = time_ns() - start;
+
+  start = time_ns();
+  for(i = 0; i < nb_lookups; i++) {
+    nb_found += properties_get_value(LOOKUP_KEY(keys, i, nb_keys), properties) != NULL;
+  }
+  eytzinger_ns = time_ns() - start;
+
+  properties_unfreeze(properties);
+  printf("sorted array: %12lld ns (%.1f ns/lookup)\n", plain_ns, (double) plain_ns / nb_lookups);
+  printf("eytzinger:    %12lld ns (%.1f ns/lookup, found %d)\n", eytzinger_ns, (double) eytzinger_ns / nb_lookups,
+         nb_found);
+  free(sorted);
+}
+
+/**
+ * Times skewed lookups, most of them on a few keys spread over the slots, before and after optimizing the layout
+ * of the compacted properties. The hot keys are copied, as the compaction moves the keys of the properties.
+ * @param properties the properties, whose lookups are counted
+ * @param keys the keys
+ * @param nb_keys number of keys
+ * @param nb_lookups number of lookups
+ */
+static void bench_hot(properties_t *properties, char **keys, int nb_keys, int nb_lookups) {
+  properties_access_t hottest;
+  long long start, before_ns, after_ns;
+  int i, nb_hot = nb_keys / 64 + 1, nb_found = 0;
+  char *hot;
+
+  hot = malloc((size_t) nb_hot * KEY_SIZE);
+  if(hot == NULL) {
+    log_error("hot keys allocation");
+    return;
+  }
+  for(i = 0; i < nb_hot; i++) {
+    snprintf(hot + (size_t) i * KEY_SIZE, KEY_SIZE, "%s", LOOKUP_KEY(keys, i, nb_keys));
+  }
+  if(properties_compact(properties) != FUNC_SUCCESS) {
+    log_error("cannot compact the properties");
+    free(hot);
+    return;
+  }
+
+  start = time_ns();
+  for(i = 0; i < nb_lookups; i++) {
+    nb_found += properties_get_value(hot + (size_t) (i * 31 % nb_hot) * KEY_SIZE, properties) != NULL;
+  }
+  before_ns = time_ns() - start;
+
+  if(properties_optimize_layout(properties) != FUNC_SUCCESS) {
+    log_error("cannot optimize the layout");
+    free(hot);
+    return;
+  }
+  start = time_ns();
+  for(i = 0; i < nb_lookups; i++) {
+    nb_found += properties_get_value(hot + (size_t) (i * 31 % nb_hot) * KEY_SIZE, properties) != NULL;
+  }
+  after_ns = time_ns() - start;
+  free(hot);
+
+  printf("skewed:   %10lld ns (%.1f ns/lookup, %d hot keys)\n", before_ns, (double) before_ns / nb_lookups, nb_hot);
+  printf("hot first: %9lld ns (%.1f ns/lookup, found %d)\n", after_ns, (double) after_ns / nb_lookups, nb_found);
+  if(properties_hot_keys(&hottest, 1, properties) == 1) {
+    printf("hottest:  %s (%u lookups)\n", hottest.key, hottest.count);
+  }
+}
+
+static void print_profile() {
+  properties_profile_t profile;
+  properties_phase_counters_t *phase;
+  int i;
+
+  properties_profile_read(&profile);
+  printf("\n%-8s %10s %14s %14s %14s %14s %14s\n", "phase", "calls", "wall ns", "cycles", "instructions",
+         "branch misses", "LLC misses");
+  for(i = 0; i < PROFILE_NB_PHASES; i++) {
+    phase = &(profile.phases[i]);
+    printf("%-8s %10llu %14llu", properties_profile_phase_name((properties_profile_phase) i), phase->calls,
+           phase->wall_ns);
+    if(profile.hardware != 0) {
+      printf(" %14llu %14llu %14llu %14llu", phase->cycles, phase->instructions, phase->branch_misses,
+             phase->llc_misses);
+    } else {
+      printf(" %14s %14s %14s %14s", "-", "-", "-", "-");
+    }
+    printf("\n");
+  }
+}
+
+static void usage(char *name) {
+  fprintf(stderr, "usage: %s [-n keys] [-l lookups] [-b rate] [-a period] [-p] [-s] [file]\n", name);
+}
+
+int main(int argc, char **argv) {
+  int opt, i, j, nb_keys = DEFAULT_NB_KEYS, nb_lookups = DEFAULT_NB_LOOKUPS, profile = 0, sorted = 0, nb_found = 0;
+  char *filename = NULL, **keys = NULL, missing[NB_MISSING][KEY_SIZE];
+  properties_t *properties;
+  lexer_t *lexer;
+  char *batch[BATCH_SIZE];
+  void *values[BATCH_SIZE];
+  properties_handle_t *handles;
+  properties_iter_t iter;
+  void *value;
+  long long start, load_ns, hit_ns, batch_ns, handle_ns, miss_ns, iter_ns;
+  unsigned int period = 0;
+  double fp_rate = 0;
+
+  while((opt = getopt(argc, argv, "n:l:b:a:ps")) != -1) {
+    switch(opt) {
+      case 'n': nb_keys = atoi(optarg); break;
+      case 'l': nb_lookups = atoi(optarg); break;
+      case 'b': fp_rate = atof(optarg); break;
+      case 'a': period = (unsigned int) atoi(optarg); break;
+      case 'p': profile = 1; break;
+      case 's': sorted = 1; break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  if(optind < argc) {
+    filename = argv[optind];
+  } else {
+    filename = generate_file(nb_keys);
+    if(filename == NULL) {
+      return 2;
+    }
+  }
+
+  if(profile) {
+    properties_profile_start();
+  }
+
+  properties = properties_new();
+  if(properties == NULL || properties_set_bloom_filter(properties, fp_rate) != FUNC_SUCCESS
+     || properties_set_access_sampling(properties, period) != FUNC_SUCCESS) {
+    return 2;
+  }
+  start = time_ns();
+  lexer = lexer_new(filename, properties);
+  if(lexer == NULL || lexer_analyze(lexer) != FUNC_SUCCESS) {
+    log_error("cannot load %s", filename);
+    return 2;
+  }
+  load_ns = time_ns() - start;
+  lexer_free(lexer);
+
+  nb_keys = properties_get_keys(&keys, properties);
+  if(nb_keys <= 0) {
+    log_error("no keys in %s", filename);
+    return 2;
+  }
+
+  start = time_ns();
+  for(i = 0; i < nb_lookups; i++) {
+    nb_found += properties_get_value(LOOKUP_KEY(keys, i, nb_keys), properties) != NULL;
+  }
+  hit_ns = time_ns() - start;
+
+  start = time_ns();
+  for(i = 0; i + BATCH_SIZE <= nb_lookups; i += BATCH_SIZE) {
+    for(j = 0; j < BATCH_SIZE; j++) {
+      batch[j] = LOOKUP_KEY(keys, i + j, nb_keys);
+    }
+    nb_found += properties_get_values(batch, BATCH_SIZE, values, properties);
+  }
+  batch_ns = time_ns() - start;
+
+  handles = malloc(nb_keys * sizeof(*handles));
+  if(handles == NULL) {
+    log_error("handles allocation");
+    return 2;
+  }
+  for(i = 0; i < nb_keys; i++) {
+    handles[i] = properties_resolve(keys[i], properties);
+  }
+  start = time_ns();
+  for(i = 0; i < nb_lookups; i++) {
+    nb_found += properties_get_by_handle(&LOOKUP_KEY(handles, i, nb_keys), properties) != NULL;
+  }
+  handle_ns = time_ns() - start;
+
+  for(i = 0; i < NB_MISSING; i++) {
+    snprintf(missing[i], KEY_SIZE, "section%d.missing%d", i % 97, i);
+  }
+  start = time_ns();
+  for(i = 0; i < nb_lookups; i++) {
+    nb_found += properties_get_value(missing[i % NB_MISSING], properties) != NULL;
+  }
+  miss_ns = time_ns() - start;
+
+  start = time_ns();
+  properties_iter_begin(&iter, properties);
+  while(properties_iter_next(&iter, NULL, NULL, &value, properties) == 1) {
+    nb_found += value != NULL;
+  }
+  iter_ns = time_ns() - start;
+
+  if(profile) {
+    properties_profile_stop();
+  }
+
+  printf("keys: %d, lookups: %d (found %d)\n", nb_keys, nb_lookups, nb_found);
+  printf("load:   %12lld ns (%.1f ns/key)\n", load_ns, (double) load_ns / nb_keys);
+  printf("hits:   %12lld ns (%.1f ns/lookup)\n", hit_ns, (double) hit_ns / nb_lookups);
+  printf("batch:  %12lld ns (%.1f ns/lookup, by %d)\n", batch_ns, (double) batch_ns / nb_lookups, BATCH_SIZE);
+  printf("handle: %12lld ns (%.1f ns/lookup)\n", handle_ns, (double) handle_ns / nb_lookups);
+  printf("misses: %12lld ns (%.1f ns/lookup)\n", miss_ns, (double) miss_ns / nb_lookups);
+  printf("iterate: %11lld ns (%.1f ns/key)\n", iter_ns, (double) iter_ns / nb_keys);
+  if(sorted) {
+    bench_sorted(properties, keys, nb_keys, nb_lookups);
+  }
+  /* last, as the compaction moves the keys */
+  if(period > 0) {
+    bench_hot(properties, keys, nb_keys, nb_lookups);
+  }
+  if(profile) {
+    print_profile();
+  }
+
+  free(handles);
+  free(keys);
+  properties_free(properties);
+  if(filename == generated) {
+    unlink(generated);
+  }
+  return 0;
+}
@@ -0,0 +1,489 @@
+/*
+ * Filename:  gen.c
+ *
+ * Description:  Code generator tool.
+ * Reads a reference properties file and writes a C header binding its keys to a struct :
+ * a field per key, typed from its reference value (integer, floating point, boolean or string),
+ * an enum of the key ids, and a loader filling the struct while the file is analysed,
+ * resolving each key with a perfect hash switch.
+ * The definitions are compiled where <PREFIX>_IMPLEMENTATION is defined before including the header.
+ *
+ * Copyright (c) 2017 Erwann Miriel, erwann.miriel@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include "lexer.h"
+#include "utils.h"
+#include "logging.h"
+
+#define DEFAULT_PREFIX  "config"
+#define NAME_SIZE       128
+#define MAX_SEEDS       100000
+
+#define FNV_PRIME       16777619u
+
+typedef enum {
+    TYPE_LONG,
+    TYPE_DOUBLE,
+    TYPE_BOOL,
+    TYPE_STRING
+} _field_type;
+
+static char *type_names[] = {"long", "double", "int", "char *"};
+
+/* names a field cannot take : the keywords of C, and the member added to the struct */
+static char *reserved_names[] = {
+    "auto", "break", "case", "char", "const", "continue", "default", "do", "double", "else", "enum", "extern",
+    "float", "for", "goto", "if", "inline", "int", "long", "register", "restrict", "return", "short", "signed",
+    "sizeof", "static", "struct", "switch", "typedef", "union", "unsigned", "void", "volatile", "while",
+    "_Alignas", "_Alignof", "_Atomic", "_Bool", "_Complex", "_Generic", "_Imaginary", "_Noreturn",
+    "_Static_assert", "_Thread_local", "present", NULL
+};
+
+/**
+ * A key of the reference file and the field it is bound to.
+ */
+typedef struct _field _field_t;
+
+struct _field {
+    char *key;
+    int key_len;
+    char *value;
+    char name[NAME_SIZE];
+    char id[NAME_SIZE];
+    _field_type type;
+};
+
+/**
+ * Perfect hash of the keys : FNV-1a from the seed, modulo the size.
+ */
+typedef struct _perfect_hash _perfect_hash_t;
+
+struct _perfect_hash {
+    unsigned int seed;
+    unsigned int size;
+};
+
+static int is_bool(char *value) {
+  return strcasecmp(value, "true") == 0 || strcasecmp(value, "false") == 0 || strcasecmp(value, "yes") == 0
+         || strcasecmp(value, "no") == 0 || strcasecmp(value, "on") == 0 || strcasecmp(value, "off") == 0;
+}
+
+static _field_type infer_type(char *value) {
+  char *end;
+
+  if(*value == '\0' || isspace((unsigned char) *value)) {
+    return TYPE_STRING;
+  }
+  if(is_bool(value)) {
+    return TYPE_BOOL;
+  }
+  strtol(value, &end, 0);
+  if(*end == '\0') {
+    return TYPE_LONG;
+  }
+  strtod(value, &end);
+  if(*end == '\0') {
+    return TYPE_DOUBLE;
+  }
+  return TYPE_STRING;
+}
+
+/**
+ * Turns a key into a C identifier : other characters than letters and digits become '_',
+ * and a leading digit is preceded by '_'.
+ * @param dest the identifier
+ * @param prefix the prefix of the identifier, upper case, NULL for none
+ * @param key the key
+ * @param upper 1 for an upper case identifier
+ */
+static void make_identifier(char *dest, char *prefix, char *key, int upper) {
+  int len = 0;
+
+  if(prefix != NULL) {
+    while(*prefix != '\0' && len < NAME_SIZE - 2) {
+      dest[len++] = (char) toupper((unsigned char) *prefix++);
+    }
+    dest[len++] = '_';
+  } else if(isdigit((unsigned char) *key)) {
+    dest[len++] = '_';
+  }
+  for(; *key != '\0' && len < NAME_SIZE - 1; key++) {
+    if(isalnum((unsigned char) *key)) {
+      dest[len++] = upper ? (char) toupper((unsigned char) *key) : *key;
+    } else {
+      dest[len++] = '_';
+    }
+  }
+  dest[len] = '\0';
+}
+
+static unsigned int seeded_hash(unsigned int seed, char *key, int len) {
+  unsigned int hash = seed;
+  int i;
+
+  for(i = 0; i < len; i++) {
+    hash = (hash ^ (unsigned char) key[i]) * FNV_PRIME;
+  }
+  return hash;
+}
+
+/**
+ * Searches the smallest table (from the number of keys up to 4 times more) and a seed
+ * giving a different position to each key.
+ * @return 0 if found, -1 otherwise
+ */
+static int find_perfect_hash(_field_t *fields, int nb_fields, _perfect_hash_t *perfect) {
+  unsigned char *used;
+  unsigned int size, seed, pos;
+  int i;
+
+  used = malloc(4 * nb_fields + 1);
+  if(used == NULL) {
+    return FUNC_FAILURE;
+  }
+  for(size = nb_fields > 0 ? nb_fields : 1; size <= 4 * (unsigned int) nb_fields + 1; size++) {
+    for(seed = 0; seed < MAX_SEEDS / size + 1; seed++) {
+      memset(used, 0, size);
+      for(i = 0; i < nb_fields; i++) {
+        pos = seeded_hash(seed, fields[i].key, fields[i].key_len) % size;
+        if(used[pos]) {
+          break;
+        }
+        used[pos] = 1;
+      }
+      if(i == nb_fields) {
+        perfect->seed = seed;
+        perfect->size = size;
+        free(used);
+        return FUNC_SUCCESS;
+      }
+    }
+  }
+  free(used);
+  return FUNC_FAILURE;
+}
+
+/**
+ * Writes a string as a C literal.
+ */
+static void write_literal(FILE *out, char *str) {
+  fputc('"', out);
+  for(; *str != '\0'; str++) {
+    if(*str == '"' || *str == '\\' || *str == '?') {
+      fprintf(out, "\\%c", *str);
+    } else if(isprint((unsigned char) *str)) {
+      fputc(*str, out);
+    } else {
+      fprintf(out, "\\%03o", (unsigned char) *str);
+    }
+  }
+  fputc('"', out);
+}
+
+static void write_declarations(FILE *out, char *prefix, char *upper, _field_t *fields, int nb_fields) {
+  int i;
+
+  fprintf(out, "#ifndef %s_H\n#define %s_H\n\n", upper, upper);
+  fprintf(out, "#include \"lexer.h\"\n\n");
+
+  fprintf(out, "typedef enum {\n");
+  for(i = 0; i < nb_fields; i++) {
+    fprintf(out, "    %s = %d,\n", fields[i].id, i);
+  }
+  fprintf(out, "    %s_NB_KEYS = %d,\n    %s_UNKNOWN_KEY = -1\n} %s_key;\n\n", upper, nb_fields, upper, prefix);
+
+  fprintf(out, "typedef struct _%s %s_t;\n\n", prefix, prefix);
+  fprintf(out, "/* present[id] is 1 when the key was found by the last load */\n");
+  fprintf(out, "struct _%s {\n", prefix);
+  for(i = 0; i < nb_fields; i++) {
+    fprintf(out, "    %s%s%s;\n", type_names[fields[i].type], fields[i].type == TYPE_STRING ? "" : " ", fields[i].name);
+  }
+  fprintf(out, "    char present[%d];\n};\n\n", nb_fields > 0 ? nb_fields : 1);
+
+  fprintf(out, "/* gets the id of a key, %s_UNKNOWN_KEY if it is not bound */\n", upper);
+  fprintf(out, "%s_key %s_key_id(const char *key, int len);\n\n", prefix, prefix);
+  fprintf(out, "/* sets the reference values, 0 if succeeded, -1 otherwise */\n");
+  fprintf(out, "int %s_init(%s_t *cfg);\n\n", prefix, prefix);
+  fprintf(out, "/* sets the reference values, then the values of a file, 0 if succeeded, -1 otherwise */\n");
+  fprintf(out, "int %s_load(char *filename, %s_t *cfg);\n\n", prefix, prefix);
+  fprintf(out, "/* frees the strings of the struct */\n");
+  fprintf(out, "void %s_free(%s_t *cfg);\n\n", prefix, prefix);
+}
+
+static void write_key_id(FILE *out, char *prefix, char *upper, _field_t *fields, int nb_fields,
+                         _perfect_hash_t *perfect) {
+  int i;
+
+  fprintf(out, "%s_key %s_key_id(const char *key, int len) {\n", prefix, prefix);
+  fprintf(out, "  unsigned int hash = %uu;\n  int i;\n\n", perfect->seed);
+  fprintf(out, "  for(i = 0; i < len; i++) {\n");
+  fprintf(out, "    hash = (hash ^ (unsigned char) key[i]) * %uu;\n  }\n", FNV_PRIME);
+  fprintf(out, "  switch(hash %% %uu) {\n", perfect->size);
+  for(i = 0; i < nb_fields; i++) {
+    fprintf(out, "    case %u:\n", seeded_hash(perfect->seed, fields[i].key, fields[i].key_len) % perfect->size);
+    fprintf(out, "      return len == %d && memcmp(key, ", fields[i].key_len);
+    write_literal(out, fields[i].key);
+    fprintf(out, ", %d) == 0 ? %s : %s_UNKNOWN_KEY;\n", fields[i].key_len, fields[i].id, upper);
+  }
+  fprintf(out, "    default:\n      return %s_UNKNOWN_KEY;\n  }\n}\n\n", upper);
+}
+
+static void write_set_value(FILE *out, char *prefix, char *upper, _field_t *fields, int nb_fields) {
+  int i;
+
+  fprintf(out, "static int %s_parse_bool(const char *value, int *p_bool) {\n", prefix);
+  fprintf(out, "  *p_bool = strcasecmp(value, \"true\") == 0 || strcasecmp(value, \"yes\") == 0"
+               " || strcasecmp(value, \"on\") == 0 || strcmp(value, \"1\") == 0;\n");
+  fprintf(out, "  return *p_bool || strcasecmp(value, \"false\") == 0 || strcasecmp(value, \"no\") == 0"
+               " || strcasecmp(value, \"off\") == 0 || strcmp(value, \"0\") == 0 ? 0 : -1;\n}\n\n");
+
+  fprintf(out, "static int %s_set_value(%s_t *cfg, %s_key id, const char *value, int len) {\n",
+          prefix, prefix, prefix);
+  fprintf(out, "  char *end = NULL, *copy = NULL;\n  long parsed_long = 0;\n  double parsed_double = 0;\n"
+               "  int parsed_bool = 0;\n\n");
+  fprintf(out, "  switch(id) {\n");
+  for(i = 0; i < nb_fields; i++) {
+    fprintf(out, "    case %s:\n", fields[i].id);
+    switch(fields[i].type) {
+      case TYPE_LONG:
+        fprintf(out, "      parsed_long = strtol(value, &end, 0);\n");
+        fprintf(out, "      if(*value == '\\0' || *end != '\\0') {\n        return -1;\n      }\n");
+        fprintf(out, "      cfg->%s = parsed_long;\n", fields[i].name);
+        break;
+      case TYPE_DOUBLE:
+        fprintf(out, "      parsed_double = strtod(value, &end);\n");
+        fprintf(out, "      if(*value == '\\0' || *end != '\\0') {\n        return -1;\n      }\n");
+        fprintf(out, "      cfg->%s = parsed_double;\n", fields[i].name);
+        break;
+      case TYPE_BOOL:
+        fprintf(out, "      if(%s_parse_bool(value, &parsed_bool) != 0) {\n        return -1;\n      }\n", prefix);
+        fprintf(out, "      cfg->%s = parsed_bool;\n", fields[i].name);
+        break;
+      case TYPE_STRING:
+        fprintf(out, "      copy = malloc(len + 1);\n      if(copy == NULL) {\n        return -1;\n      }\n");
+        fprintf(out, "      memcpy(copy, value, len + 1);\n");
+        fprintf(out, "      free(cfg->%s);\n      cfg->%s = copy;\n", fields[i].name, fields[i].name);
+        break;
+    }
+    fprintf(out, "      break;\n");
+  }
+  fprintf(out, "    default:\n      return 0;\n  }\n");
+  fprintf(out, "  cfg->present[id] = 1;\n  (void) end;\n  (void) copy;\n  (void) parsed_long;\n"
+               "  (void) parsed_double;\n  (void) parsed_bool;\n  return 0;\n}\n\n");
+  (void) upper;
+}
+
+static void write_definitions(FILE *out, char *prefix, char *upper, _field_t *fields, int nb_fields,
+                              _perfect_hash_t *perfect) {
+  int i;
+
+  fprintf(out, "#ifdef %s_IMPLEMENTATION\n\n", upper);
+  fprintf(out, "#include <stdlib.h>\n#include <string.h>\n#include <strings.h>\n\n");
+
+  write_key_id(out, prefix, upper, fields, nb_fields, perfect);
+  write_set_value(out, prefix, upper, fields, nb_fields);
+
+  fprintf(out, "int %s_init(%s_t *cfg) {\n", prefix, prefix);
+  fprintf(out, "  memset(cfg, 0, sizeof(*cfg));\n");
+  for(i = 0; i < nb_fields; i++) {
+    fprintf(out, "  if(%s_set_value(cfg, %s, ", prefix, fields[i].id);
+    write_literal(out, fields[i].value);
+    fprintf(out, ", %d) != 0) {\n    %s_free(cfg);\n    return -1;\n  }\n", (int) strlen(fields[i].value), prefix);
+  }
+  fprintf(out, "  memset(cfg->present, 0, sizeof(cfg->present));\n  return 0;\n}\n\n");
+
+  fprintf(out, "static int %s_on_property(char *key, int key_len, char *value, int value_len, void *ctx) {\n",
+          prefix);
+  fprintf(out, "  return %s_set_value(ctx, %s_key_id(key, key_len), value, value_len);\n}\n\n", prefix, prefix);
+
+  fprintf(out, "int %s_load(char *filename, %s_t *cfg) {\n", prefix, prefix);
+  fprintf(out, "  properties_t *properties;\n  lexer_t *lexer;\n  int ret = -1;\n\n");
+  fprintf(out, "  if(%s_init(cfg) != 0) {\n    return -1;\n  }\n", prefix);
+  fprintf(out, "  properties = properties_new();\n  if(properties == NULL) {\n    return -1;\n  }\n");
+  fprintf(out, "  lexer = lexer_new(filename, properties);\n  if(lexer != NULL) {\n");
+  fprintf(out, "    lexer_set_property_handler(lexer, %s_on_property, cfg);\n", prefix);
+  fprintf(out, "    ret = lexer_analyze(lexer);\n    lexer_free(lexer);\n  }\n");
+  fprintf(out, "  properties_free(properties);\n  return ret;\n}\n\n");
+
+  fprintf(out, "void %s_free(%s_t *cfg) {\n", prefix, prefix);
+  for(i = 0; i < nb_fields; i++) {
+    if(fields[i].type == TYPE_STRING) {
+      fprintf(out, "  free(cfg->%s);\n  cfg->%s = NULL;\n", fields[i].name, fields[i].name);
+    }
+  }
+  fprintf(out, "  (void) cfg;\n}\n\n");
+  fprintf(out, "#endif\n\n#endif\n");
+}
+
+/**
+ * Reads the keys of the reference file, in order, the first occurrence of a key only.
+ * @return the number of fields, -1 if failed
+ */
+static int read_fields(char *filename, properties_t *properties, _field_t **p_fields) {
+  lexer_t *lexer;
+  properties_iter_t iter;
+  char *key;
+  void *value;
+  _field_t *fields;
+  int key_len, nb_fields = 0, j;
+
+  lexer = lexer_new(filename, properties);
+  if(lexer == NULL || lexer_analyze(lexer) != FUNC_SUCCESS) {
+    log_error("cannot analyse %s", filename);
+    if(lexer != NULL) {
+      lexer_free(lexer);
+    }
+    return FUNC_FAILURE;
+  }
+  lexer_free(lexer);
+
+  fields = malloc((properties->size + 1) * sizeof(*fields));
+  if(fields == NULL) {
+    return FUNC_FAILURE;
+  }
+
+  properties_iter_begin(&iter, properties);
+  while(properties_iter_next(&iter, &key, &key_len, &value, properties) == 1) {
+    for(j = 0; j < nb_fields && strcmp(fields[j].key, key) != 0; j++);
+    if(j < nb_fields) {
+      continue;
+    }
+    fields[nb_fields].key = key;
+    fields[nb_fields].key_len = key_len;
+    fields[nb_fields].value = value;
+    fields[nb_fields].type = infer_type(fields[nb_fields].value);
+    nb_fields++;
+  }
+  *p_fields = fields;
+  return nb_fields;
+}
+
+/**
+ * Checks that the fields and their ids are valid and distinct identifiers,
+ * which do not clash with the keywords nor with the generated names.
+ * @return 0 if succeeded, -1 otherwise
+ */
+static int check_names(_field_t *fields, int nb_fields, char *prefix) {
+  char nb_keys[NAME_SIZE], unknown_key[NAME_SIZE];
+  int i, j;
+
+  make_identifier(nb_keys, prefix, "NB_KEYS", 1);
+  make_identifier(unknown_key, prefix, "UNKNOWN_KEY", 1);
+  for(i = 0; i < nb_fields; i++) {
+    make_identifier(fields[i].name, NULL, fields[i].key, 0);
+    make_identifier(fields[i].id, prefix, fields[i].key, 1);
+    for(j = 0; reserved_names[j] != NULL && strcmp(fields[i].name, reserved_names[j]) != 0; j++);
+    if(reserved_names[j] != NULL) {
+      log_error("key %s gives the reserved field %s", fields[i].key, fields[i].name);
+      return FUNC_FAILURE;
+    }
+    if(strcmp(fields[i].id, nb_keys) == 0 || strcmp(fields[i].id, unknown_key) == 0) {
+      log_error("key %s gives the reserved id %s", fields[i].key, fields[i].id);
+      return FUNC_FAILURE;
+    }
+    for(j = 0; j < i; j++) {
+      if(strcmp(fields[i].name, fields[j].name) == 0 || strcmp(fields[i].id, fields[j].id) == 0) {
+        log_error("keys %s and %s give the same field %s", fields[j].key, fields[i].key, fields[i].name);
+        return FUNC_FAILURE;
+      }
+    }
+  }
+  return FUNC_SUCCESS;
+}
+
+static int is_identifier(char *str) {
+  if(*str == '\0' || isdigit((unsigned char) *str) || strlen(str) >= NAME_SIZE / 2) {
+    return 0;
+  }
+  for(; *str != '\0'; str++) {
+    if(!isalnum((unsigned char) *str) && *str != '_') {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static void usage(char *name) {
+  fprintf(stderr, "usage: %s [-p prefix] [-o header] reference\n", name);
+}
+
+int main(int argc, char **argv) {
+  int opt, nb_fields, ret = 2;
+  char *prefix = DEFAULT_PREFIX, *output = NULL, upper[NAME_SIZE];
+  properties_t *properties;
+  _field_t *fields = NULL;
+  _perfect_hash_t perfect;
+  FILE *out = stdout;
+
+  while((opt = getopt(argc, argv, "p:o:")) != -1) {
+    switch(opt) {
+      case 'p': prefix = optarg; break;
+      case 'o': output = optarg; break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  if(optind != argc - 1) {
+    usage(argv[0]);
+    return 2;
+  }
+  if(!is_identifier(prefix)) {
+    log_error("prefix %s is not an identifier", prefix);
+    return 2;
+  }
+  make_identifier(upper, NULL, prefix, 1);
+
+  properties = properties_new();
+  if(properties == NULL) {
+    return 2;
+  }
+  nb_fields = read_fields(argv[optind], properties, &fields);
+  if(nb_fields < 0 || check_names(fields, nb_fields, prefix) != FUNC_SUCCESS) {
+    goto free_properties;
+  }
+  if(find_perfect_hash(fields, nb_fields, &perfect) != FUNC_SUCCESS) {
+    log_error("no perfect hash found");
+    goto free_properties;
+  }
+
+  if(output != NULL) {
+    out = fopen(output, "w");
+    if(out == NULL) {
+      log_error("cannot open %s", output);
+      goto free_properties;
+    }
+  }
+  fprintf(out, "/*\n * Generated by propsgen from %s, do not edit.\n */\n\n", argv[optind]);
+  write_declarations(out, prefix, upper, fields, nb_fields);
+  write_definitions(out, prefix, upper, fields, nb_fields, &perfect);
+  if(out != stdout) {
+    fclose(out);
+  }
+  ret = 0;
+
+free_properties:
+  free(fields);
+  properties_free(properties);
+  return ret;
+}
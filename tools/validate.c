@@ -0,0 +1,261 @@
+/*
+ * Filename:  validate.c
+ *
+ * Description:  Bulk validation tool.
+ * Walks the given files and directory trees, analyses every properties file in recovery mode
+ * on all available cores, and prints every diagnostic found.
+ *
+ * Copyright (c) 2017 Erwann Miriel, erwann.miriel@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ftw.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "lexer.h"
+#include "utils.h"
+#include "logging.h"
+
+#define FILES_STEP      64
+#define MAX_OPEN_FDS    32
+#define DEFAULT_EXT     ".properties"
+
+/**
+ * Result of the validation of one file.
+ */
+typedef struct _file_result _file_result_t;
+
+struct _file_result {
+    char *filename;
+    char *report;
+    int nb_diagnostics;
+};
+
+/**
+ * Files to validate, shared by all workers.
+ */
+typedef struct _job _job_t;
+
+struct _job {
+    int size;
+    int capacity;
+    _file_result_t *files;
+    int next;
+    pthread_mutex_t lock;
+};
+
+static _job_t job;
+static char *extension = DEFAULT_EXT;
+
+static int has_extension(const char *path) {
+  size_t path_len = strlen(path), ext_len = strlen(extension);
+  return path_len >= ext_len && strcmp(path + path_len - ext_len, extension) == 0;
+}
+
+static int add_file(const char *path) {
+  _file_result_t *file;
+
+  if(manage_size((void **) &(job.files), job.size, &(job.capacity), FILES_STEP, sizeof(*(job.files))) != FUNC_SUCCESS) {
+    return FUNC_FAILURE;
+  }
+
+  file = &(job.files[job.size]);
+  file->filename = malloc(strlen(path) + NULL_CHAR_OFFSET);
+  if(file->filename == NULL) {
+    return FUNC_FAILURE;
+  }
+  strcpy(file->filename, path);
+  file->report = NULL;
+  file->nb_diagnostics = 0;
+  job.size++;
+
+  return FUNC_SUCCESS;
+}
+
+static int walk_entry(const char *path, const struct stat *st, int flag, struct FTW *ftw) {
+  (void) st;
+  (void) ftw;
+
+  if(flag == FTW_F && has_extension(path)) {
+    return add_file(path);
+  }
+  if(flag == FTW_DNR || flag == FTW_NS) {
+    log_warning("cannot read %s", path);
+  }
+  return 0;
+}
+
+/**
+ * Appends a formatted line to a report.
+ * @param p_report the report to grow
+ * @param line the line to append
+ * @return 0 if succeeded, -1 otherwise
+ */
+static int report_append(char **p_report, const char *line) {
+  size_t cur_len = *p_report == NULL ? 0 : strlen(*p_report);
+  char *report;
+
+  report = realloc(*p_report, cur_len + strlen(line) + NULL_CHAR_OFFSET);
+  if(report == NULL) {
+    return FUNC_FAILURE;
+  }
+  strcpy(report + cur_len, line);
+  *p_report = report;
+  return FUNC_SUCCESS;
+}
+
+static void validate_file(_file_result_t *file) {
+  char line[1024];
+  properties_t *properties;
+  lexer_t *lexer;
+  lexer_diagnostic_t *diagnostics;
+  int i, nb_diagnostics;
+
+  properties = properties_new();
+  if(properties == NULL) {
+    snprintf(line, sizeof(line), "%s: out of memory\n", file->filename);
+    report_append(&(file->report), line);
+    file->nb_diagnostics = 1;
+    return;
+  }
+
+  lexer = lexer_new(file->filename, properties);
+  if(lexer == NULL) {
+    snprintf(line, sizeof(line), "%s: cannot open file\n", file->filename);
+    report_append(&(file->report), line);
+    file->nb_diagnostics = 1;
+    properties_free(properties);
+    return;
+  }
+
+  lexer_set_recovery(lexer, 1);
+  if(lexer_analyze(lexer) != FUNC_SUCCESS) {
+    nb_diagnostics = lexer_get_diagnostics(lexer, &diagnostics);
+    for(i = 0; i < nb_diagnostics; i++) {
+      snprintf(line, sizeof(line), "%s:%d:%d: %s near %s\n", diagnostics[i].filename, diagnostics[i].line,
+               diagnostics[i].column, diagnostics[i].message, diagnostics[i].token);
+      report_append(&(file->report), line);
+    }
+    if(nb_diagnostics == 0) {
+      snprintf(line, sizeof(line), "%s: analysis aborted\n", file->filename);
+      report_append(&(file->report), line);
+      nb_diagnostics = 1;
+    }
+    file->nb_diagnostics = nb_diagnostics;
+  }
+
+  lexer_free(lexer);
+  properties_free(properties);
+}
+
+static void *worker(void *arg) {
+  int idx;
+  (void) arg;
+
+  for(;;) {
+    pthread_mutex_lock(&(job.lock));
+    idx = job.next++;
+    pthread_mutex_unlock(&(job.lock));
+
+    if(idx >= job.size) {
+      return NULL;
+    }
+    validate_file(&(job.files[idx]));
+  }
+}
+
+static void usage(char *name) {
+  fprintf(stderr, "usage: %s [-j jobs] [-e extension] path...\n", name);
+}
+
+int main(int argc, char **argv) {
+  int opt, i, nb_threads = 0, nb_files_ko = 0, nb_diagnostics = 0;
+  pthread_t *threads;
+
+  while((opt = getopt(argc, argv, "j:e:")) != -1) {
+    switch(opt) {
+      case 'j': nb_threads = atoi(optarg); break;
+      case 'e': extension = optarg; break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  if(optind >= argc) {
+    usage(argv[0]);
+    return 2;
+  }
+  if(nb_threads <= 0) {
+    nb_threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if(nb_threads <= 0) {
+      nb_threads = 1;
+    }
+  }
+
+  job.size = 0;
+  job.capacity = 0;
+  job.files = NULL;
+  job.next = 0;
+  pthread_mutex_init(&(job.lock), NULL);
+
+  for(i = optind; i < argc; i++) {
+    if(nftw(argv[i], walk_entry, MAX_OPEN_FDS, FTW_PHYS) != 0) {
+      log_error("cannot walk %s", argv[i]);
+      return 2;
+    }
+  }
+
+  if(nb_threads > job.size) {
+    nb_threads = job.size > 0 ? job.size : 1;
+  }
+  threads = malloc(nb_threads * sizeof(*threads));
+  if(threads == NULL) {
+    log_error("threads allocation");
+    return 2;
+  }
+  for(i = 0; i < nb_threads; i++) {
+    if(pthread_create(&(threads[i]), NULL, worker, NULL) != 0) {
+      log_error("pthread_create");
+      return 2;
+    }
+  }
+  for(i = 0; i < nb_threads; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  /* reports are printed in walk order, whatever the order of completion */
+  for(i = 0; i < job.size; i++) {
+    if(job.files[i].nb_diagnostics > 0) {
+      if(job.files[i].report != NULL) {
+        fputs(job.files[i].report, stdout);
+      }
+      nb_diagnostics += job.files[i].nb_diagnostics;
+      nb_files_ko++;
+    }
+    free(job.files[i].report);
+    free(job.files[i].filename);
+  }
+  printf("%d files checked, %d with errors, %d diagnostics\n", job.size, nb_files_ko, nb_diagnostics);
+
+  free(threads);
+  free(job.files);
+  pthread_mutex_destroy(&(job.lock));
+
+  return nb_files_ko > 0 ? 1 : 0;
+}